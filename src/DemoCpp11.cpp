@@ -1,9 +1,18 @@
 #include <iostream> // for cerr
 #include <cstdlib> // for EXIT_SUCCESS
-#include <functional> // for std::function
 #include <limits>
+#include <stdexcept> // for invalid_argument
 #include "constexpr.h"
 #include "bit_manipulation.h"
+#include "dynamic_bitset.h"
+#include "rank_select.h"
+#include "roaring_bitmap.h"
+#include "packed_fields.h"
+#include "ascii.h"
+#include "int_format.h"
+#include "bloom_filter.h"
+#include "int_codec.h"
+#include "radix_sort.h"
 #include "scoped_enum.h"
 #include "smart_pointers.h"
 #include "type_support.h"
@@ -14,36 +23,49 @@
 #include "lambdas.h"
 #include "casts.h"
 #include "rvalues.h"
+#include "demo_runner.h"
 
 using namespace std;
 
-typedef function<void()> DemoFunction;
-
-static const DemoFunction demos[] =
+static const Demo demos[] =
 {
-    demo_constexpr,
-    demo_bit_manipulation,
-    demo_scoped_enum,
-    demo_smart_pointers,
-    demo_type_support,
-    demo_range_based_loops,
-    demo_initialization,
-    demo_default_and_deleted_functions,
-    demo_lambdas,
-    demo_rvalues,
-    demo_casts,
-    demo_pitfalls
+    {"constexpr", demo_constexpr},
+    {"bit_manipulation", demo_bit_manipulation},
+    {"dynamic_bitset", demo_dynamic_bitset},
+    {"rank_select", demo_rank_select},
+    {"roaring_bitmap", demo_roaring_bitmap},
+    {"packed_fields", demo_packed_fields},
+    {"ascii", demo_ascii},
+    {"int_format", demo_int_format},
+    {"bloom_filter", demo_bloom_filter},
+    {"int_codec", demo_int_codec},
+    {"radix_sort", demo_radix_sort},
+    {"scoped_enum", demo_scoped_enum},
+    {"smart_pointers", demo_smart_pointers},
+    {"type_support", demo_type_support},
+    {"range_based_loops", demo_range_based_loops},
+    {"initialization", demo_initialization},
+    {"default_and_deleted_functions", demo_default_and_deleted_functions},
+    {"lambdas", demo_lambdas},
+    {"rvalues", demo_rvalues},
+    {"casts", demo_casts},
+    {"pitfalls", demo_pitfalls}
 };
 
-int main(void)
+int main(int argc, char* argv[])
 {
     try
     {
+        // Any argument selects the batch mode; see print_usage
+        if(argc > 1)
+            return run_batch(demos, sizeof(demos)/sizeof(demos[0]),
+                parse_runner_options(argc, argv));
+
         char c;
         // Can use for instance for(auto const& f : {demo_rvalues})
-        for(auto const& f : demos)
+        for(auto const& demo : demos)
         {
-            f();
+            demo.run();
             cout << "======= Press any to continue, q to end =======" << endl;
             cin.get(c);
             if(c == 'q')
@@ -51,6 +73,12 @@ int main(void)
             cin.ignore(1);
         }
 
+    } catch(invalid_argument const& e) {
+
+        cerr << e.what() << endl;
+        print_usage(cerr, argv[0]);
+        return EXIT_FAILURE;
+
     } catch(...) {
 
         cerr << "Something bad happened." << endl;
@@ -0,0 +1,240 @@
+#include "alloc_tracker.h"
+#include "symbols.h"
+#include <algorithm> // for sort, min
+#include <atomic>
+#include <cstdlib> // for malloc, free
+#include <cstring> // for strcmp
+#include <map>
+#include <new> // for bad_alloc, new_handler, nothrow_t
+#include <utility> // for pair
+#include <execinfo.h> // for backtrace
+#include <malloc.h> // for malloc_usable_size
+
+using namespace std;
+
+// Counters of one thread. Plain data with static storage, so that it is
+// usable from operator new at any time, even while a thread starts or ends.
+struct ThreadAllocCounters
+{
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytes;
+    int64_t live_bytes;
+    int64_t peak_live_bytes;
+    const char* site_tag;   // see AllocSiteTag
+    bool in_tracker;        // guards against allocations made while recording
+};
+
+static thread_local ThreadAllocCounters thread_counters;
+
+static atomic<bool> tracking_enabled(false);
+static atomic<bool> sites_enabled(false);
+
+// Call sites: a fixed-size open-addressing table shared by all threads,
+// filled lock-free by operator new. A slot is claimed by setting its key,
+// then published by setting ready once its stack is written.
+static const size_t site_depth = 24;
+static const size_t site_capacity = 4096;
+
+struct SiteSlot
+{
+    atomic<uint64_t> key;
+    atomic<bool> ready;
+    const char* tag;
+    int depth;
+    void* frames[site_depth];
+    atomic<uint64_t> allocations;
+    atomic<uint64_t> bytes;
+};
+
+static SiteSlot site_table[site_capacity];
+
+static uint64_t hash_stack(void* const* frames, int depth, const char* tag)
+{
+    // FNV-1a over the return addresses and the tag
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](uint64_t v) { h = (h ^ v) * 1099511628211ull; };
+    for(int i = 0; i < depth; ++i)
+        mix(reinterpret_cast<uintptr_t>(frames[i]));
+    mix(reinterpret_cast<uintptr_t>(tag));
+    return h | 1; // 0 marks a free slot
+}
+
+static void record_site(size_t size)
+{
+    void* frames[site_depth];
+    int depth = backtrace(frames, site_depth);
+    const char* tag = thread_counters.site_tag;
+    uint64_t key = hash_stack(frames, depth, tag);
+    for(size_t probe = 0; probe < site_capacity; ++probe)
+    {
+        SiteSlot& slot = site_table[(key + probe) % site_capacity];
+        uint64_t current = slot.key.load(memory_order_acquire);
+        if(current == 0)
+        {
+            if(slot.key.compare_exchange_strong(current, key, memory_order_acq_rel))
+            {
+                slot.tag = tag;
+                slot.depth = depth;
+                copy(frames, frames + depth, slot.frames);
+                slot.ready.store(true, memory_order_release);
+                current = key;
+            }
+        }
+        if(current == key)
+        {
+            slot.allocations.fetch_add(1, memory_order_relaxed);
+            slot.bytes.fetch_add(size, memory_order_relaxed);
+            return;
+        }
+    }
+    // Table full: the allocation is counted, its site is not
+}
+
+// Inlined into each operator new, so that frame 0 of the recorded
+// stack is operator new itself and frame 1 is its caller
+__attribute__((always_inline)) static inline void* tracked_malloc(size_t size)
+{
+    if(size == 0)
+        size = 1;
+    void* p;
+    while((p = malloc(size)) == nullptr)
+    {
+        new_handler handler = get_new_handler();
+        if(!handler)
+            throw bad_alloc();
+        handler();
+    }
+    if(tracking_enabled.load(memory_order_relaxed) && !thread_counters.in_tracker)
+    {
+        ThreadAllocCounters& c = thread_counters;
+        c.in_tracker = true;
+        ++c.allocations;
+        c.bytes += size;
+        c.live_bytes += malloc_usable_size(p);
+        c.peak_live_bytes = max(c.peak_live_bytes, c.live_bytes);
+        if(sites_enabled.load(memory_order_relaxed))
+            record_site(size);
+        c.in_tracker = false;
+    }
+    return p;
+}
+
+static void tracked_free(void* p)
+{
+    if(p && tracking_enabled.load(memory_order_relaxed))
+    {
+        ++thread_counters.frees;
+        thread_counters.live_bytes -= malloc_usable_size(p);
+    }
+    free(p);
+}
+
+void* operator new(size_t size)
+{
+    return tracked_malloc(size);
+}
+
+void* operator new[](size_t size)
+{
+    return tracked_malloc(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    try { return tracked_malloc(size); } catch(...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    try { return tracked_malloc(size); } catch(...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { tracked_free(p); }
+void operator delete[](void* p) noexcept { tracked_free(p); }
+void operator delete(void* p, size_t) noexcept { tracked_free(p); }
+void operator delete[](void* p, size_t) noexcept { tracked_free(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { tracked_free(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { tracked_free(p); }
+
+void enable_alloc_tracking(bool with_sites)
+{
+    if(with_sites)
+    {
+        // backtrace loads its unwinder on first use: do it before tracking
+        void* frame;
+        backtrace(&frame, 1);
+        sites_enabled = true;
+    }
+    tracking_enabled = true;
+}
+
+bool alloc_tracking_enabled()
+{
+    return tracking_enabled.load(memory_order_relaxed);
+}
+
+AllocStats alloc_stats_now()
+{
+    const ThreadAllocCounters& c = thread_counters;
+    AllocStats stats;
+    stats.allocations = c.allocations;
+    stats.frees = c.frees;
+    stats.bytes = c.bytes;
+    stats.live_bytes = c.live_bytes;
+    stats.peak_live_bytes = c.peak_live_bytes;
+    return stats;
+}
+
+void alloc_reset_peak()
+{
+    thread_counters.peak_live_bytes = thread_counters.live_bytes;
+}
+
+AllocSiteTag::AllocSiteTag(const char* tag)
+:_previous(thread_counters.site_tag)
+{
+    thread_counters.site_tag = tag;
+}
+
+AllocSiteTag::~AllocSiteTag()
+{
+    thread_counters.site_tag = _previous;
+}
+
+vector<AllocSite> alloc_top_sites(const char* tag, size_t count)
+{
+    // Stacks that differ only below the first user frame are merged
+    map<pair<string, string>, AllocSite> sites;
+    for(const SiteSlot& slot : site_table)
+    {
+        if(!slot.ready.load(memory_order_acquire) || !slot.tag || strcmp(slot.tag, tag) != 0)
+            continue;
+        string function, via;
+        for(int i = 1; i < slot.depth; ++i) // frame 0 is operator new
+        {
+            string name = symbol_name(slot.frames[i]);
+            if(!is_library_symbol(name))
+            {
+                function = name;
+                break;
+            }
+            via = name;
+        }
+        if(function.empty())
+            function = "(beyond the recorded stack)";
+        AllocSite& site = sites[make_pair(function, via)];
+        site.function = function;
+        site.via = via;
+        site.allocations += slot.allocations.load(memory_order_relaxed);
+        site.bytes += slot.bytes.load(memory_order_relaxed);
+    }
+    vector<AllocSite> top;
+    for(const auto& s : sites)
+        top.push_back(s.second);
+    sort(top.begin(), top.end(), [](const AllocSite& a, const AllocSite& b) {
+        return a.bytes > b.bytes;
+    });
+    top.resize(min(count, top.size()));
+    return top;
+}
@@ -0,0 +1,62 @@
+#ifndef _ALLOC_TRACKER_H_
+#define _ALLOC_TRACKER_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t, int64_t
+#include <string>
+#include <vector>
+
+// Heap allocation tracker, built on the replacement of the global
+// operator new and operator delete (see alloc_tracker.cpp).
+// Only what goes through operator new is seen: containers, std::function,
+// std::string, new and new[]. Direct calls to malloc are not.
+
+/// Allocations of the calling thread since it started
+struct AllocStats
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;             ///< requested bytes, over all allocations
+    int64_t live_bytes = 0;         ///< usable size of the blocks not freed yet
+    int64_t peak_live_bytes = 0;    ///< highest live_bytes since alloc_reset_peak
+};
+
+/// Switches the tracker on for the whole program. Off by default, in which
+/// case operator new costs a predictable branch on top of malloc.
+/// With sites, each allocation also records its call stack (see alloc_top_sites).
+void enable_alloc_tracking(bool with_sites);
+bool alloc_tracking_enabled();
+
+/// Allocations of the calling thread so far
+AllocStats alloc_stats_now();
+
+/// Restarts the peak of the calling thread from its current live bytes
+void alloc_reset_peak();
+
+/// Attributes the call sites of the allocations made by the calling thread
+/// to the given tag (e.g. a demo name) for the lifetime of the object.
+/// The tag must outlive the program, e.g. a literal.
+class AllocSiteTag
+{
+public:
+    explicit AllocSiteTag(const char* tag);
+    ~AllocSiteTag();
+    AllocSiteTag(const AllocSiteTag&) = delete;
+    AllocSiteTag& operator=(const AllocSiteTag&) = delete;
+private:
+    const char* _previous;
+};
+
+/// Allocations made from one call site, since the tracking started
+struct AllocSite
+{
+    std::string function;   ///< first caller outside operator new and the standard library
+    std::string via;        ///< the standard library function it called, if any
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+/// Call sites with the most allocated bytes under the given tag (compared by content)
+std::vector<AllocSite> alloc_top_sites(const char* tag, size_t count);
+
+#endif /* _ALLOC_TRACKER_H_ */
@@ -0,0 +1,363 @@
+#include <algorithm> // for min
+#include <cstring> // for memcpy
+#include <iostream>
+#include <map>
+#include <string>
+#include "ascii.h"
+#include "bit_ops.h" // for byte_swap
+#include "cpu_features.h"
+#include "demo_output.h"
+
+using namespace std;
+
+// Letters a conversion changes: flipping their 0x20 bit changes their case
+// (the & 0xDF and | 0x20 of demo_bit_manipulation, restricted to letters)
+template<AsciiCase to> struct Letters;
+template<> struct Letters<AsciiCase::Upper> { static const char first = 'a', last = 'z'; };
+template<> struct Letters<AsciiCase::Lower> { static const char first = 'A', last = 'Z'; };
+
+// Characters of a class: those in [first, last] once or-ed with fold
+template<AsciiClass cls> struct ClassRange;
+template<> struct ClassRange<AsciiClass::Alpha> { static const char fold = 0x20, first = 'a', last = 'z'; };
+template<> struct ClassRange<AsciiClass::Digit> { static const char fold = 0, first = '0', last = '9'; };
+
+// Calls Loop<to>::run(args...)
+template<template<AsciiCase> class Loop, typename... Args>
+static void dispatch_case(AsciiCase to, Args... args)
+{
+    if(to == AsciiCase::Upper)
+        Loop<AsciiCase::Upper>::run(args...);
+    else
+        Loop<AsciiCase::Lower>::run(args...);
+}
+
+// Calls Loop<cls>::run(args...)
+template<template<AsciiClass> class Loop, typename... Args>
+static void dispatch_class(AsciiClass cls, Args... args)
+{
+    if(cls == AsciiClass::Alpha)
+        Loop<AsciiClass::Alpha>::run(args...);
+    else
+        Loop<AsciiClass::Digit>::run(args...);
+}
+
+// One character. The bytes above 0x7f are negative if char is signed,
+// above 'z' otherwise: out of the ranges either way.
+template<AsciiCase to>
+static inline char convert_char(char c)
+{
+    return c >= Letters<to>::first && c <= Letters<to>::last ? char(c ^ 0x20) : c;
+}
+
+template<AsciiClass cls>
+static inline bool in_class(char c)
+{
+    char folded = char(c | ClassRange<cls>::fold);
+    return folded >= ClassRange<cls>::first && folded <= ClassRange<cls>::last;
+}
+
+// SWAR: 8 characters in a 64-bit word
+static const uint64_t byte_ones = 0x0101010101010101ull;
+static const uint64_t byte_high_bits = 0x8080808080808080ull;
+
+// High bit of each byte of w that is an ASCII character in [first, last].
+// The bytes without their high bit are compared by additions that carry
+// into it, never into the next byte.
+static inline uint64_t bytes_in_range(uint64_t w, char first, char last)
+{
+    uint64_t low_bits = w & ~byte_high_bits;
+    uint64_t from_first = low_bits + byte_ones * uint64_t(0x80 - first);
+    uint64_t past_last = low_bits + byte_ones * uint64_t(0x7f - last);
+    return from_first & ~past_last & ~w & byte_high_bits;
+}
+
+template<AsciiCase to>
+static inline uint64_t convert_word(uint64_t w)
+{
+    // The high bit of each letter, moved to its 0x20 bit
+    return w ^ (bytes_in_range(w, Letters<to>::first, Letters<to>::last) >> 2);
+}
+
+// The fold leaves the high bits, hence the non-ASCII bytes, as they are
+template<AsciiClass cls>
+static inline uint64_t class_bytes(uint64_t w)
+{
+    return bytes_in_range(w | byte_ones * uint64_t(ClassRange<cls>::fold), ClassRange<cls>::first, ClassRange<cls>::last);
+}
+
+// Character i of the text in byte i of the word, whatever the byte order
+static inline uint64_t load_text_word(const char* text)
+{
+    uint64_t w;
+    memcpy(&w, text, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = byte_swap(w);
+#endif
+    return w;
+}
+
+// The high bits of the 8 bytes, in the 8 low bits: the multiplication
+// adds up the shifted copies of the word without any carry
+static inline uint64_t gather_high_bits(uint64_t high_bits)
+{
+    return ((high_bits >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+// Bits of up to 64 characters
+template<AsciiClass cls>
+static uint64_t classify_word_swar(const char* text, size_t size)
+{
+    uint64_t word = 0;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+        word |= gather_high_bits(class_bytes<cls>(load_text_word(text + i))) << i;
+    for(; i < size; ++i)
+        word |= uint64_t(in_class<cls>(text[i])) << i;
+    return word;
+}
+
+// Kernels, one variant per instruction set
+
+template<AsciiCase to>
+struct ConvertScalar
+{
+    static void run(const char* in, size_t size, char* out)
+    {
+        size_t i = 0;
+        for(; i + 8 <= size; i += 8)
+        {
+            uint64_t w;
+            memcpy(&w, in + i, sizeof(w));
+            w = convert_word<to>(w);
+            memcpy(out + i, &w, sizeof(w));
+        }
+        for(; i < size; ++i)
+            out[i] = convert_char<to>(in[i]);
+    }
+};
+
+template<AsciiClass cls>
+struct ClassifyScalar
+{
+    static void run(const char* text, size_t size, uint64_t* bits)
+    {
+        for(size_t w = 0; w * 64 < size; ++w)
+            bits[w] = classify_word_swar<cls>(text + w * 64, min<size_t>(64, size - w * 64));
+    }
+};
+
+static void convert_scalar(AsciiCase to, const char* in, size_t size, char* out)
+{
+    dispatch_case<ConvertScalar>(to, in, size, out);
+}
+
+static void classify_scalar(AsciiClass cls, const char* text, size_t size, uint64_t* bits)
+{
+    dispatch_class<ClassifyScalar>(cls, text, size, bits);
+}
+
+#ifdef HAS_X86_KERNELS
+// The vector variants compare signed bytes: those above 0x7f are negative,
+// out of every range. The last vector of a conversion overlaps the one
+// before it rather than leaving a tail: converting twice changes nothing.
+
+// 16 bytes at a time with SSE2
+static inline __m128i in_range_sse2(__m128i v, char first, char last)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(char(first - 1))),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(char(last + 1))));
+}
+
+template<AsciiCase to>
+static inline __m128i convert_sse2(__m128i v)
+{
+    __m128i letters = in_range_sse2(v, Letters<to>::first, Letters<to>::last);
+    return _mm_xor_si128(v, _mm_and_si128(letters, _mm_set1_epi8(0x20)));
+}
+
+// One bit per character of the 16 at text
+template<AsciiClass cls>
+static inline uint64_t class_mask_sse2(const char* text)
+{
+    __m128i v = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text)),
+                             _mm_set1_epi8(ClassRange<cls>::fold));
+    return uint16_t(_mm_movemask_epi8(in_range_sse2(v, ClassRange<cls>::first, ClassRange<cls>::last)));
+}
+
+template<AsciiCase to>
+struct ConvertSSE42
+{
+    static void run(const char* in, size_t size, char* out)
+    {
+        if(size < 16)
+            return ConvertScalar<to>::run(in, size, out);
+        for(size_t i = 0; ; i += 16)
+        {
+            i = min(i, size - 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                             convert_sse2<to>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+            if(i == size - 16)
+                break;
+        }
+    }
+};
+
+template<AsciiClass cls>
+struct ClassifySSE42
+{
+    static void run(const char* text, size_t size, uint64_t* bits)
+    {
+        size_t w = 0;
+        for(; (w + 1) * 64 <= size; ++w, text += 64)
+            bits[w] = class_mask_sse2<cls>(text) | class_mask_sse2<cls>(text + 16) << 16
+                    | class_mask_sse2<cls>(text + 32) << 32 | class_mask_sse2<cls>(text + 48) << 48;
+        if(w * 64 < size)
+            bits[w] = classify_word_swar<cls>(text, size - w * 64);
+    }
+};
+
+static void convert_sse42(AsciiCase to, const char* in, size_t size, char* out)
+{
+    dispatch_case<ConvertSSE42>(to, in, size, out);
+}
+
+static void classify_sse42(AsciiClass cls, const char* text, size_t size, uint64_t* bits)
+{
+    dispatch_class<ClassifySSE42>(cls, text, size, bits);
+}
+
+// 32 bytes at a time
+__attribute__((target("avx2")))
+static inline __m256i in_range_avx2(__m256i v, char first, char last)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(char(first - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(char(last + 1)), v));
+}
+
+template<AsciiCase to>
+__attribute__((target("avx2")))
+static inline __m256i convert_avx2(__m256i v)
+{
+    __m256i letters = in_range_avx2(v, Letters<to>::first, Letters<to>::last);
+    return _mm256_xor_si256(v, _mm256_and_si256(letters, _mm256_set1_epi8(0x20)));
+}
+
+template<AsciiClass cls>
+__attribute__((target("avx2")))
+static inline uint64_t class_mask_avx2(const char* text)
+{
+    __m256i v = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text)),
+                                _mm256_set1_epi8(ClassRange<cls>::fold));
+    return uint32_t(_mm256_movemask_epi8(in_range_avx2(v, ClassRange<cls>::first, ClassRange<cls>::last)));
+}
+
+template<AsciiCase to>
+struct ConvertAVX2
+{
+    __attribute__((target("avx2")))
+    static void run(const char* in, size_t size, char* out)
+    {
+        if(size < 32)
+            return ConvertSSE42<to>::run(in, size, out);
+        for(size_t i = 0; ; i += 32)
+        {
+            i = min(i, size - 32);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                                convert_avx2<to>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i))));
+            if(i == size - 32)
+                break;
+        }
+    }
+};
+
+template<AsciiClass cls>
+struct ClassifyAVX2
+{
+    __attribute__((target("avx2")))
+    static void run(const char* text, size_t size, uint64_t* bits)
+    {
+        size_t w = 0;
+        for(; (w + 1) * 64 <= size; ++w, text += 64)
+            bits[w] = class_mask_avx2<cls>(text) | class_mask_avx2<cls>(text + 32) << 32;
+        if(w * 64 < size)
+            bits[w] = classify_word_swar<cls>(text, size - w * 64);
+    }
+};
+
+__attribute__((target("avx2")))
+static void convert_avx2(AsciiCase to, const char* in, size_t size, char* out)
+{
+    dispatch_case<ConvertAVX2>(to, in, size, out);
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(AsciiClass cls, const char* text, size_t size, uint64_t* bits)
+{
+    dispatch_class<ClassifyAVX2>(cls, text, size, bits);
+}
+#endif
+
+static const Kernel<void (*)(AsciiCase, const char*, size_t, char*)> convert_kernel(
+    "ascii.convert", convert_scalar, X86_KERNEL(convert_sse42), X86_KERNEL(convert_avx2), nullptr);
+
+static const Kernel<void (*)(AsciiClass, const char*, size_t, uint64_t*)> classify_kernel(
+    "ascii.classify", classify_scalar, X86_KERNEL(classify_sse42), X86_KERNEL(classify_avx2), nullptr);
+
+void ascii_convert(AsciiCase to, const char* in, size_t size, char* out)
+{
+    convert_kernel(to, in, size, out);
+}
+
+string ascii_folded(const string& text)
+{
+    string folded(text.size(), '\0');
+    ascii_fold(text.data(), text.size(), &folded[0]);
+    return folded;
+}
+
+void ascii_classify(AsciiClass cls, const char* text, size_t size, uint64_t* bits)
+{
+    classify_kernel(cls, text, size, bits);
+}
+
+DynamicBitset ascii_classify(AsciiClass cls, const string& text)
+{
+    // The padding words stay clear, as well as the bits past the text
+    DynamicBitset bits(text.size());
+    ascii_classify(cls, text.data(), text.size(), bits.data());
+    return bits;
+}
+
+void demo_ascii()
+{
+    demo_out() << endl << "****************** ASCII *****************" << endl;
+
+    // Case-insensitive keys: folded once when stored, once per lookup
+    map<string, string> headers;
+    for(const char* name : {"Content-Type", "Content-Length", "X-Request-ID"})
+        headers[ascii_folded(name)] = name;
+    for(const char* name : {"content-type", "CONTENT-LENGTH", "x-request-id", "Accept"})
+    {
+        auto found = headers.find(ascii_folded(name));
+        demo_out() << name << " -> " << (found == headers.end() ? "not found" : found->second) << endl;
+    }
+
+    // Only the ASCII letters change: the bytes of UTF-8 sequences never do
+    string text = "Größe: 42 Äpfel, straße 7";
+    ascii_to_upper(text);
+    demo_out() << "Upper case : " << text << endl;
+    ascii_to_lower(text);
+    demo_out() << "Lower case : " << text << endl;
+
+    // One bit per character
+    string order = "Order 66 shipped on 2024-05-17";
+    DynamicBitset digits = ascii_classify(AsciiClass::Digit, order);
+    DynamicBitset letters = ascii_classify(AsciiClass::Alpha, order);
+    demo_out() << "Text    : " << order << endl;
+    demo_out() << "Digits  : ";
+    for(size_t i = 0; i < digits.size(); ++i)
+        demo_out() << (digits[i] ? '^' : ' ');
+    demo_out() << endl;
+    demo_out() << "Letters : " << letters.count() << ", digits : " << digits.count()
+               << ", others : " << order.size() - letters.count() - digits.count() << endl;
+}
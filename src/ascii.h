@@ -0,0 +1,55 @@
+#ifndef _ASCII_H_
+#define _ASCII_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <string>
+#include "dynamic_bitset.h"
+
+/// ASCII demo: case-insensitive keys and character classes of buffers
+void demo_ascii();
+
+/// Case of the letters after a conversion
+enum class AsciiCase : unsigned int
+{
+    Upper,
+    Lower
+};
+
+/// Character classes, ASCII only
+enum class AsciiClass : unsigned int
+{
+    Alpha,  ///< A-Z, a-z
+    Digit   ///< 0-9
+};
+
+// Buffer kernels, independent of the locale, with the fastest instructions
+// of the host (see cpu_features.h): 8 bytes at a time with 64-bit integer
+// operations (SWAR), 16 with SSE2, 32 with AVX2. The bytes that are not
+// ASCII letters, those of UTF-8 sequences included, are never changed.
+
+/// Converts the ASCII letters of the size bytes at in and writes the result
+/// to out, which is either in itself or does not overlap it
+void ascii_convert(AsciiCase to, const char* in, size_t size, char* out);
+
+inline void ascii_to_upper(const char* in, size_t size, char* out) { ascii_convert(AsciiCase::Upper, in, size, out); }
+inline void ascii_to_lower(const char* in, size_t size, char* out) { ascii_convert(AsciiCase::Lower, in, size, out); }
+/// Case folding, for case-insensitive comparisons and keys: the folded
+/// ASCII letters are the lower case ones
+inline void ascii_fold(const char* in, size_t size, char* out) { ascii_convert(AsciiCase::Lower, in, size, out); }
+
+/// In place
+inline void ascii_to_upper(std::string& text) { ascii_to_upper(&text[0], text.size(), &text[0]); }
+inline void ascii_to_lower(std::string& text) { ascii_to_lower(&text[0], text.size(), &text[0]); }
+inline void ascii_fold(std::string& text) { ascii_fold(&text[0], text.size(), &text[0]); }
+
+/// Folded copy, e.g. as the key of a case-insensitive map
+std::string ascii_folded(const std::string& text);
+
+/// Sets bit i%64 of bits[i/64] if byte i is in the class, and clears it
+/// otherwise, for the (size + 63) / 64 words
+void ascii_classify(AsciiClass cls, const char* text, size_t size, uint64_t* bits);
+/// One bit per character of the text
+DynamicBitset ascii_classify(AsciiClass cls, const std::string& text);
+
+#endif /* _ASCII_H_ */
@@ -0,0 +1,273 @@
+#include "bench.h"
+#include <algorithm> // for sort, min, max
+#include <chrono> // for steady_clock
+#include <cmath> // for fabs
+#include <cstdlib> // for EXIT_SUCCESS
+#include <fstream>
+#include <iomanip> // for setw, setprecision
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept> // for invalid_argument, runtime_error
+
+using namespace std;
+
+// Wall-clock duration of one batch of iterations, in nanoseconds
+static double time_batch(const BenchKernel& kernel, uint64_t iterations)
+{
+    auto start = chrono::steady_clock::now();
+    kernel(iterations);
+    clobber_memory();
+    auto stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count();
+}
+
+static double median_of(vector<double> values)
+{
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n/2] : (values[n/2 - 1] + values[n/2]) / 2;
+}
+
+BenchResult run_benchmark(const Benchmark& benchmark, const BenchOptions& options)
+{
+    const double target_ns = options.min_sample_ms * 1e6;
+    const uint64_t max_iterations = uint64_t(1) << 40;
+
+    // Untimed first call: builds the static inputs of the kernel and
+    // faults their pages in, which would otherwise end the calibration
+    benchmark.kernel(1);
+
+    // Grow the batch until it lasts long enough for the clock resolution
+    // and the timing overhead to be negligible
+    uint64_t iterations = 1;
+    for(;;)
+    {
+        double elapsed = time_batch(benchmark.kernel, iterations);
+        if(elapsed >= target_ns || iterations >= max_iterations)
+            break;
+        double scale = elapsed > 0 ? 1.4 * target_ns / elapsed : 10.0;
+        uint64_t next = uint64_t(iterations * min(scale, 10.0));
+        iterations = min(max_iterations, max(next, iterations + 1));
+    }
+
+    vector<double> per_iteration;
+    for(unsigned int i = 0; i < options.samples; ++i)
+        per_iteration.push_back(time_batch(benchmark.kernel, iterations) / iterations);
+
+    BenchResult result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.samples = options.samples;
+    result.median_ns = median_of(per_iteration);
+    vector<double> deviations;
+    for(double t : per_iteration)
+        deviations.push_back(fabs(t - result.median_ns));
+    result.mad_ns = median_of(deviations);
+    if(result.median_ns > 0)
+    {
+        result.items_per_second = benchmark.items_per_iteration * 1e9 / result.median_ns;
+        result.bytes_per_second = benchmark.bytes_per_iteration * 1e9 / result.median_ns;
+    }
+    return result;
+}
+
+static unsigned int parse_count(const string& option, const char* value)
+{
+    istringstream in(value);
+    unsigned int count = 0;
+    if(!(in >> count) || !in.eof() || count == 0)
+        throw invalid_argument(option + ": expected a positive integer, got '" + value + "'");
+    return count;
+}
+
+static double parse_number(const string& option, const char* value)
+{
+    istringstream in(value);
+    double number = 0;
+    if(!(in >> number) || !in.eof() || number < 0)
+        throw invalid_argument(option + ": expected a non-negative number, got '" + value + "'");
+    return number;
+}
+
+BenchOptions parse_bench_options(int argc, char* argv[])
+{
+    BenchOptions options;
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        // Options taking a value read it from the next argument
+        auto value = [&]() -> const char* {
+            if(i + 1 >= argc)
+                throw invalid_argument(arg + ": missing value");
+            return argv[++i];
+        };
+        if(arg == "--samples")
+            options.samples = parse_count(arg, value());
+        else if(arg == "--min-time")
+            options.min_sample_ms = parse_number(arg, value());
+        else if(arg == "--json")
+            options.json_file = value();
+        else if(arg == "--baseline")
+            options.baseline_file = value();
+        else if(arg == "--threshold")
+            options.threshold_pct = parse_number(arg, value());
+        else if(arg == "--list")
+            options.list = true;
+        else if(arg == "--help" || arg == "-h")
+            options.help = true;
+        else if(arg.compare(0, 1, "-") == 0)
+            throw invalid_argument("unknown option " + arg);
+        else
+            options.filters.push_back(arg);
+    }
+    return options;
+}
+
+void print_bench_usage(ostream& out, const char* program)
+{
+    out << "Usage: " << program << " [options] [filter ...]\n"
+        << "Runs the benchmarks whose name contains one of the filters (default: all).\n"
+        << "  --samples N      timed batches per benchmark (default 15)\n"
+        << "  --min-time MS    duration of one batch, in milliseconds (default 5)\n"
+        << "  --json FILE      write the results to FILE\n"
+        << "  --baseline FILE  compare with the --json output of a previous run\n"
+        << "  --threshold PCT  slowdown reported as a regression (default 5)\n"
+        << "  --list           list the benchmark names\n"
+        << "  --help           show this help\n";
+}
+
+// Writes one benchmark per line, so that two outputs can be compared with diff
+static void write_json(ostream& out, const vector<BenchResult>& results)
+{
+    out << "{\n  \"benchmarks\": [";
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& r = results[i];
+        out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\""
+            << ", \"iterations\": " << r.iterations
+            << ", \"samples\": " << r.samples
+            << ", \"median_ns\": " << r.median_ns
+            << ", \"mad_ns\": " << r.mad_ns
+            << ", \"items_per_second\": " << r.items_per_second
+            << ", \"bytes_per_second\": " << r.bytes_per_second << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Reads the median of each benchmark from the output of write_json
+static map<string, double> read_baseline(const string& file_name)
+{
+    ifstream in(file_name);
+    if(!in)
+        throw runtime_error("cannot read baseline " + file_name);
+    map<string, double> medians;
+    string line;
+    const string name_key = "\"name\": \"";
+    const string median_key = "\"median_ns\": ";
+    while(getline(in, line))
+    {
+        size_t name_pos = line.find(name_key);
+        size_t median_pos = line.find(median_key);
+        if(name_pos == string::npos || median_pos == string::npos)
+            continue;
+        name_pos += name_key.size();
+        string name = line.substr(name_pos, line.find('"', name_pos) - name_pos);
+        medians[name] = atof(line.c_str() + median_pos + median_key.size());
+    }
+    return medians;
+}
+
+// Formats a rate with a metric prefix, e.g. 1.25G
+static string human_rate(double rate)
+{
+    const char* prefixes[] = {"", "k", "M", "G", "T"};
+    size_t p = 0;
+    while(rate >= 1000 && p + 1 < sizeof(prefixes)/sizeof(prefixes[0]))
+    {
+        rate /= 1000;
+        ++p;
+    }
+    ostringstream out;
+    out << fixed << setprecision(2) << rate << prefixes[p];
+    return out.str();
+}
+
+static bool matches(const string& name, const vector<string>& filters)
+{
+    if(filters.empty())
+        return true;
+    for(const auto& f : filters)
+        if(name.find(f) != string::npos)
+            return true;
+    return false;
+}
+
+int run_benchmarks(const Benchmark* benchmarks, size_t count, const BenchOptions& options)
+{
+    if(options.help)
+    {
+        print_bench_usage(cout, "bench");
+        return EXIT_SUCCESS;
+    }
+    if(options.list)
+    {
+        for(size_t i = 0; i < count; ++i)
+            cout << benchmarks[i].name << '\n';
+        return EXIT_SUCCESS;
+    }
+
+    map<string, double> baseline;
+    if(!options.baseline_file.empty())
+        baseline = read_baseline(options.baseline_file);
+
+    cout << left << setw(36) << "benchmark" << right << setw(14) << "iterations"
+         << setw(14) << "median ns" << setw(10) << "MAD ns"
+         << setw(12) << "items/s" << setw(12) << "bytes/s";
+    if(!baseline.empty())
+        cout << setw(14) << "vs baseline";
+    cout << endl;
+
+    vector<BenchResult> results;
+    size_t regressions = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(!matches(benchmarks[i].name, options.filters))
+            continue;
+        BenchResult r = run_benchmark(benchmarks[i], options);
+        cout << left << setw(36) << r.name << right << setw(14) << r.iterations
+             << fixed << setprecision(2) << setw(14) << r.median_ns << setw(10) << r.mad_ns
+             << setw(12) << (r.items_per_second > 0 ? human_rate(r.items_per_second) : "-")
+             << setw(12) << (r.bytes_per_second > 0 ? human_rate(r.bytes_per_second) : "-");
+        auto base = baseline.find(r.name);
+        if(base != baseline.end() && base->second > 0)
+        {
+            double change_pct = 100.0 * (r.median_ns - base->second) / base->second;
+            ostringstream change;
+            change << showpos << fixed << setprecision(1) << change_pct << '%';
+            cout << setw(14) << change.str();
+            if(change_pct > options.threshold_pct)
+            {
+                cout << "  REGRESSION";
+                ++regressions;
+            }
+        }
+        cout << endl;
+        results.push_back(r);
+    }
+
+    if(!options.json_file.empty())
+    {
+        ofstream json(options.json_file);
+        if(!json)
+            throw runtime_error("cannot write " + options.json_file);
+        write_json(json, results);
+    }
+    if(regressions)
+    {
+        cout << regressions << " benchmark(s) slower than the baseline by more than "
+             << options.threshold_pct << '%' << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
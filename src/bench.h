@@ -0,0 +1,77 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <cstdint> // for uint64_t
+#include <functional> // for std::function
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// Prevents the compiler from optimizing away the computation of value,
+/// by pretending that its storage is read by an opaque instruction
+template<typename T>
+inline void do_not_optimize(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Prevents the compiler from assuming anything about the content of memory:
+/// pending stores are performed and later loads are not hoisted above the barrier
+inline void clobber_memory()
+{
+    asm volatile("" : : : "memory");
+}
+
+/// Code under test: runs the kernel the given number of times
+typedef std::function<void(uint64_t iterations)> BenchKernel;
+
+/// Entry of the benchmark table
+struct Benchmark
+{
+    const char* name;                 ///< module.kernel, matched by the filter arguments
+    BenchKernel kernel;
+    uint64_t items_per_iteration;     ///< for the items/s throughput; 0 if meaningless
+    uint64_t bytes_per_iteration;     ///< for the bytes/s throughput; 0 if meaningless
+};
+
+/// Settings of a benchmark run, parsed from the command line
+struct BenchOptions
+{
+    std::vector<std::string> filters;   ///< substrings of the names to run; empty for all
+    unsigned int samples = 15;          ///< timed batches per benchmark
+    double min_sample_ms = 5.0;         ///< calibrated duration of one batch
+    std::string json_file;              ///< empty for no JSON output
+    std::string baseline_file;          ///< JSON output of a previous run to compare to
+    double threshold_pct = 5.0;         ///< slowdown, in percent, reported as a regression
+    bool list = false;                  ///< only list the benchmark names
+    bool help = false;                  ///< only print the usage
+};
+
+/// Measures of one benchmark; times are per iteration
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations = 0;            ///< iterations per batch, after calibration
+    unsigned int samples = 0;
+    double median_ns = 0;
+    double mad_ns = 0;                  ///< median absolute deviation
+    double items_per_second = 0;
+    double bytes_per_second = 0;
+};
+
+/// Parses the command line. Throws std::invalid_argument on bad usage.
+BenchOptions parse_bench_options(int argc, char* argv[]);
+
+/// Describes the command line options
+void print_bench_usage(std::ostream& out, const char* program);
+
+/// Calibrates the number of iterations so that a batch lasts about
+/// min_sample_ms, then times the requested number of batches
+BenchResult run_benchmark(const Benchmark& benchmark, const BenchOptions& options);
+
+/// Runs the selected benchmarks, prints a table, writes the JSON output and
+/// compares with the baseline. Returns the process exit code: failure
+/// when a benchmark regressed by more than the threshold.
+int run_benchmarks(const Benchmark* benchmarks, size_t count, const BenchOptions& options);
+
+#endif /* _BENCH_H_ */
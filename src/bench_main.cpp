@@ -0,0 +1,677 @@
+#include <algorithm> // for set_intersection, sort, lower_bound
+#include <array>
+#include <bitset>
+#include <cstdint> // for uint64_t
+#include <cstdlib> // for EXIT_SUCCESS
+#include <cstring> // for strcmp
+#include <iomanip> // for setw, setfill
+#include <iostream> // for cerr
+#include <iterator> // for inserter
+#include <list>
+#include <locale> // for toupper
+#include <new> // for placement new
+#include <set>
+#include <sstream>
+#include <stdexcept> // for invalid_argument
+#include <string>
+#include <utility> // for std::move
+#include <vector>
+#include "bench.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+#include "constexpr.h"
+#include "bit_manipulation.h"
+#include "bit_ops.h"
+#include "dynamic_bitset.h"
+#include "rank_select.h"
+#include "roaring_bitmap.h"
+#include "packed_fields.h"
+#include "ascii.h"
+#include "int_format.h"
+#include "bloom_filter.h"
+#include "int_codec.h"
+#include "radix_sort.h"
+#include "perfect_hash.h"
+#include "frozen.h"
+#include "lookup_tables.h"
+#include "lambdas.h"
+#include "rvalues.h"
+#include "stats_counters.h"
+
+using namespace std;
+
+// Inputs are kept in memory, out of sight of the optimizer, so that
+// the constexpr kernels are evaluated at run time like with real data
+static vector<unsigned int> make_inputs(size_t n, unsigned int seed)
+{
+    vector<unsigned int> values(n);
+    for(auto& v : values)
+    {
+        seed = seed * 1103515245u + 12345u;
+        v = (seed >> 8) & 0xffff;
+    }
+    return values;
+}
+
+static const vector<unsigned int> inputs = make_inputs(1024, 42);
+static const string text(64, 'x');
+static const string long_text(4096, 'x');
+static const vector<uint64_t> words = [] {
+    vector<uint64_t> w;
+    for(auto v : inputs)
+        w.push_back(v * 0x9E3779B97F4A7C15ull); // spread the bits over the word
+    return w;
+}();
+static const size_t array_size = 1024;
+// 2 MiB per bitset: the bulk operations stream from memory or the last cache level
+static const size_t bitset_size = size_t(1) << 24;
+
+// Bits set with probability 1/2
+static DynamicBitset random_bitset(size_t size, uint64_t seed)
+{
+    DynamicBitset bits(size);
+    for(size_t i = 0; i < size; ++i)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        bits.set(i, seed >> 63);
+    }
+    return bits;
+}
+
+// About one value in every `one_in` below the limit
+static RoaringBitmap random_roaring(uint32_t limit, uint32_t one_in, uint64_t seed)
+{
+    RoaringBitmap values;
+    for(uint32_t v = 0; v < limit; ++v)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        if((seed >> 33) % one_in == 0)
+            values.add(v);
+    }
+    return values;
+}
+
+// The order of the packed_fields demo: 2 flags and 4 small integers
+typedef PackedFields<Field<1>, Field<1>, Field<3>, Field<5>, Field<12>, Field<5>> PackedOrder;
+static const size_t record_count = 4096;
+
+static vector<PackedOrder::Record> random_records(size_t n, uint64_t seed)
+{
+    vector<PackedOrder::Record> records(n);
+    for(auto& record : records)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        record = PackedOrder::unpack(seed >> 20);
+    }
+    return records;
+}
+
+// Keys of mixed case, some UTF-8 in them
+static string mixed_text(size_t size)
+{
+    static const string sample = "Content-Type: Text/HTML; charset=UTF-8, Größe 42\n";
+    string text;
+    while(text.size() < size)
+        text += sample;
+    text.resize(size);
+    return text;
+}
+
+// 2^20 keys at 1%: about 1.2 MiB of filter, past the L2 cache. Half the
+// probes are keys, in random order.
+static const size_t bloom_keys = size_t(1) << 20;
+static const size_t probe_count = 4096;
+
+static BlockedBloomFilter keys_filter(BloomBlock block)
+{
+    BlockedBloomFilter filter(bloom_keys, 0.01, block);
+    for(size_t i = 0; i < bloom_keys; ++i)
+        filter.add(bloom_hash(uint64_t(i)));
+    return filter;
+}
+
+static const vector<uint64_t> probes = [] {
+    vector<uint64_t> hashes(probe_count);
+    uint64_t seed = 7;
+    for(auto& h : hashes)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        h = bloom_hash((seed >> 33) % (2 * bloom_keys));
+    }
+    return hashes;
+}();
+
+// 2^20 sorted IDs, 1 to 16 apart: 4 MiB raw, past the L2 cache
+static const size_t id_count = size_t(1) << 20;
+static const vector<uint32_t> sorted_ids = [] {
+    vector<uint32_t> ids(id_count);
+    uint64_t seed = 11;
+    uint32_t id = 0;
+    for(auto& v : ids)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        v = id += 1 + uint32_t(seed >> 60);
+    }
+    return ids;
+}();
+
+// 2^20 unsigned IDs in random order, below 2^24: the high byte is skipped
+static const size_t sort_count = size_t(1) << 20;
+static const vector<uint32_t> shuffled_ids = [] {
+    vector<uint32_t> ids(sort_count);
+    uint64_t seed = 13;
+    for(auto& v : ids)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        v = uint32_t(seed >> 40);
+    }
+    return ids;
+}();
+
+// The keywords of C++14: a table of the size the perfect hash replaces
+// linear scans for. Half the queries are keywords, half are not.
+static constexpr const char* keywords[] = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor",
+    "bool", "break", "case", "catch", "char", "char16_t", "char32_t", "class",
+    "compl", "const", "constexpr", "const_cast", "continue", "decltype",
+    "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+    "explicit", "export", "extern", "false", "float", "for", "friend", "goto",
+    "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+    "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private",
+    "protected", "public", "register", "reinterpret_cast", "return", "short",
+    "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+    "switch", "template", "this", "thread_local", "throw", "true", "try",
+    "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual",
+    "void", "volatile", "wchar_t", "while", "xor", "xor_eq"};
+static constexpr auto keyword_set = make_perfect_hash_set(keywords);
+static const vector<string> keyword_queries = [] {
+    vector<string> queries;
+    for(auto keyword : keywords)
+    {
+        queries.push_back(keyword);
+        queries.push_back(string(keyword) + "_");
+    }
+    return queries;
+}();
+
+// A static lookup table of a few thousand keys, and keys to look up in it,
+// half of them present. The searches return whether a key is not after
+// them all, the end of the table being a valid result.
+static const size_t table_size = 4096;
+static const array<uint32_t, table_size> table_keys = [] {
+    array<uint32_t, table_size> keys;
+    for(size_t i = 0; i < table_size; ++i)
+        keys[i] = uint32_t(i * 2654435761u); // distinct: an odd multiplier
+    return keys;
+}();
+static const FrozenSet<uint32_t, table_size> frozen_table(table_keys);
+static const set<uint32_t> set_table(table_keys.begin(), table_keys.end());
+static const vector<uint32_t> table_queries = [] {
+    vector<uint32_t> queries(probe_count);
+    uint64_t seed = 17;
+    for(auto& q : queries)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        q = table_keys[(seed >> 33) % table_size] + uint32_t(seed >> 63);
+    }
+    return queries;
+}();
+
+// Applies f to the inputs in turn, one per iteration
+template<typename F>
+static void over_inputs(uint64_t iterations, F f)
+{
+    for(uint64_t i = 0; i < iterations; ++i)
+        do_not_optimize(f(inputs[i % inputs.size()]));
+}
+
+static const Benchmark benchmarks[] =
+{
+    {"constexpr.gcd", [](uint64_t n) {
+        // Subtraction-based: cost depends on the ratio of the operands
+        over_inputs(n, [](unsigned int v) { return gcd(v | 1, 1440); });
+    }, 1, 0},
+    {"constexpr.csqrt", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return csqrt(uint64_t(v) * v + v); });
+    }, 1, 0},
+    {"constexpr.csqrt_small", [](uint64_t n) {
+        // Below LookupTables::isqrt_size: the table
+        over_inputs(n, [](unsigned int v) { return csqrt(v & 4095); });
+    }, 1, 0},
+    {"constexpr.cx_strlen", [](uint64_t n) {
+        const char* str = text.c_str();
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            do_not_optimize(str);
+            do_not_optimize(cx_strlen(str));
+        }
+    }, 1, 64},
+    {"constexpr.fast_strlen", [](uint64_t n) {
+        const char* str = long_text.c_str();
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            do_not_optimize(str);
+            do_not_optimize(fast_strlen(str));
+        }
+    }, 1, 4096},
+    {"perfect_hash.index_of", [](uint64_t n) {
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            const string& query = keyword_queries[i % keyword_queries.size()];
+            do_not_optimize(keyword_set.index_of(query.c_str(), query.size()));
+        }
+    }, 1, 0},
+    {"perfect_hash.linear_strcmp", [](uint64_t n) {
+        // The scan is_one_of did, with the library strcmp
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            const char* query = keyword_queries[i % keyword_queries.size()].c_str();
+            size_t index = 0;
+            while(index < sizeof(keywords)/sizeof(keywords[0]) && strcmp(query, keywords[index]) != 0)
+                ++index;
+            do_not_optimize(index);
+        }
+    }, 1, 0},
+    {"frozen.set_lower_bound", [](uint64_t n) {
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize(frozen_table.lower_bound(table_queries[i % table_queries.size()]) != frozen_table.end());
+    }, 1, 0},
+    {"frozen.std_set_lower_bound", [](uint64_t n) {
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize(set_table.lower_bound(table_queries[i % table_queries.size()]) != set_table.end());
+    }, 1, 0},
+    {"frozen.std_lower_bound", [](uint64_t n) {
+        // Binary search of the sorted array
+        static const array<uint32_t, table_size> sorted = [] {
+            array<uint32_t, table_size> keys = table_keys;
+            sort(keys.begin(), keys.end());
+            return keys;
+        }();
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize(std::lower_bound(sorted.begin(), sorted.end(),
+                table_queries[i % table_queries.size()]) != sorted.end());
+    }, 1, 0},
+    {"bit_manipulation.lowest_set_bit", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return lowest_set_bit(v); });
+    }, 1, 0},
+    {"bit_manipulation.strip_lowest_set_bit", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return strip_lowest_set_bit(v); });
+    }, 1, 0},
+    {"bit_manipulation.count_set_bits", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return count_set_bits(v * 0x9E3779B9u); });
+    }, 1, 0},
+    {"bit_manipulation.popcount_words", [](uint64_t n) {
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize(popcount_words(words.data(), words.size()));
+    }, 1024, 1024 * sizeof(uint64_t)},
+    {"bit_ops.bit_count", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return bit_count(v * 0x9E3779B9u); });
+    }, 1, 0},
+    {"bit_ops.count_trailing_zeros", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return count_trailing_zeros(uint64_t(v) << 20); });
+    }, 1, 0},
+    {"bit_ops.bit_reverse", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return bit_reverse(uint64_t(v)); });
+    }, 1, 0},
+    {"bit_ops.next_power_of_two", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return next_power_of_two(v); });
+    }, 1, 0},
+    {"lookup_tables.bit_reverse", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return table_bit_reverse(uint8_t(v)); });
+    }, 1, 0},
+    {"lookup_tables.bit_ops_bit_reverse", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return bit_reverse(uint8_t(v)); });
+    }, 1, 0},
+    {"bit_manipulation.as_binary", [](uint64_t n) {
+        // As printed by the demo: through the bitset text representation
+        over_inputs(n, [](unsigned int v) { return as_binary(v).to_string(); });
+    }, 1, 0},
+    {"dynamic_bitset.and", [](uint64_t n) {
+        static DynamicBitset a = random_bitset(bitset_size, 1), b = random_bitset(bitset_size, 2);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            a &= b;
+            clobber_memory();
+        }
+    }, 1, bitset_size / 8},
+    {"dynamic_bitset.count_of_and", [](uint64_t n) {
+        static const DynamicBitset a = random_bitset(bitset_size, 1), b = random_bitset(bitset_size, 2);
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize(count_of(BitOp::And, a, b));
+    }, 1, bitset_size / 8},
+    {"dynamic_bitset.copy", [](uint64_t n) {
+        // The memcpy speed the bulk operations are compared with
+        static const DynamicBitset a = random_bitset(bitset_size, 1);
+        static DynamicBitset b(bitset_size);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            b = a;
+            clobber_memory();
+        }
+    }, 1, bitset_size / 8},
+    {"dynamic_bitset.for_each_set", [](uint64_t n) {
+        // 1 bit in 64 set: the iteration cost is per set bit, not per word
+        static DynamicBitset sparse(65536);
+        for(size_t i = 0; i < sparse.size(); i += 64)
+            sparse.set(i + (i / 64) % 64);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            size_t sum = 0;
+            sparse.for_each_set([&sum](size_t pos) { sum += pos; });
+            do_not_optimize(sum);
+        }
+    }, 1024, 0},
+    {"rank_select.rank1", [](uint64_t n) {
+        static const RankSelect index(random_bitset(bitset_size, 3));
+        uint64_t position = 1;
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            position = position * 6364136223846793005ull + 1442695040888963407ull;
+            do_not_optimize(index.rank1((position >> 16) % bitset_size));
+        }
+    }, 1, 0},
+    {"rank_select.select1", [](uint64_t n) {
+        static const RankSelect index(random_bitset(bitset_size, 3));
+        uint64_t k = 1;
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            k = k * 6364136223846793005ull + 1442695040888963407ull;
+            do_not_optimize(index.select1((k >> 16) % index.count()));
+        }
+    }, 1, 0},
+    {"roaring_bitmap.and_arrays", [](uint64_t n) {
+        // 1 value in 256: arrays of 256 values per chunk
+        static const RoaringBitmap a = random_roaring(1u << 24, 256, 1), b = random_roaring(1u << 24, 256, 2);
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize((a & b).cardinality());
+    }, 1, 0},
+    {"roaring_bitmap.and_bitmaps", [](uint64_t n) {
+        // 1 value in 2: bitmaps
+        static const RoaringBitmap a = random_roaring(1u << 24, 2, 1), b = random_roaring(1u << 24, 2, 2);
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize((a & b).cardinality());
+    }, 1, 0},
+    {"roaring_bitmap.std_set_intersection", [](uint64_t n) {
+        // The values of and_arrays, in the std::set they replace
+        static const vector<uint32_t> va = random_roaring(1u << 24, 256, 1).to_vector();
+        static const vector<uint32_t> vb = random_roaring(1u << 24, 256, 2).to_vector();
+        static const set<uint32_t> a(va.begin(), va.end()), b(vb.begin(), vb.end());
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            set<uint32_t> both;
+            set_intersection(a.begin(), a.end(), b.begin(), b.end(), inserter(both, both.end()));
+            do_not_optimize(both.size());
+        }
+    }, 1, 0},
+    {"packed_fields.pack", [](uint64_t n) {
+        // One PEXT per 8 bytes of record with BMI2, 6 shifts and masks otherwise
+        static const vector<PackedOrder::Record> records = random_records(record_count, 1);
+        static vector<uint64_t> packed(record_count);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            PackedOrder::pack(records.data(), record_count, packed.data());
+            clobber_memory();
+        }
+    }, record_count, record_count * sizeof(uint64_t)},
+    {"packed_fields.unpack", [](uint64_t n) {
+        static vector<uint64_t> packed(record_count);
+        static vector<PackedOrder::Record> records = random_records(record_count, 1);
+        PackedOrder::pack(records.data(), record_count, packed.data());
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            PackedOrder::unpack(packed.data(), record_count, records.data());
+            clobber_memory();
+        }
+    }, record_count, record_count * sizeof(uint64_t)},
+    {"packed_fields.unpack_columns", [](uint64_t n) {
+        // All 6 columns
+        static vector<uint64_t> packed(record_count);
+        static vector<PackedOrder::value_type> columns(record_count * PackedOrder::field_count);
+        static const vector<PackedOrder::Record> records = random_records(record_count, 1);
+        PackedOrder::pack(records.data(), record_count, packed.data());
+        std::array<PackedOrder::value_type*, PackedOrder::field_count> column_pointers;
+        for(size_t f = 0; f < PackedOrder::field_count; ++f)
+            column_pointers[f] = columns.data() + f * record_count;
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            PackedOrder::unpack_columns(packed.data(), record_count, column_pointers);
+            clobber_memory();
+        }
+    }, record_count, record_count * sizeof(uint64_t)},
+    {"ascii.to_upper", [](uint64_t n) {
+        static const string text = mixed_text(4096);
+        static string upper(text.size(), '\0');
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ascii_to_upper(text.data(), text.size(), &upper[0]);
+            clobber_memory();
+        }
+    }, 4096, 4096},
+    {"ascii.std_toupper", [](uint64_t n) {
+        // What ascii_to_upper replaces: one call per character, through the locale
+        static const string text = mixed_text(4096);
+        static string upper(text.size(), '\0');
+        static const locale loc;
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            for(size_t c = 0; c < text.size(); ++c)
+                upper[c] = toupper(text[c], loc);
+            clobber_memory();
+        }
+    }, 4096, 4096},
+    {"ascii.classify", [](uint64_t n) {
+        static const string text = mixed_text(4096);
+        static vector<uint64_t> bits(4096 / 64);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ascii_classify(AsciiClass::Alpha, text.data(), text.size(), bits.data());
+            clobber_memory();
+        }
+    }, 4096, 4096},
+    {"int_format.binary", [](uint64_t n) {
+        // The 1024 words in binary, one per line
+        static string text(words.size() * 65, '\0');
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            format_binary(words.data(), words.size(), '\n', &text[0]);
+            clobber_memory();
+        }
+    }, 1024, 1024 * 65},
+    {"int_format.bitset_to_string", [](uint64_t n) {
+        // What format_binary replaces: a bitset and a string per word
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ostringstream text;
+            for(uint64_t w : words)
+                text << bitset<64>(w) << '\n';
+            do_not_optimize(text.tellp());
+        }
+    }, 1024, 1024 * 65},
+    {"int_format.hex", [](uint64_t n) {
+        static string text(words.size() * 17, '\0');
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            format_hex(words.data(), words.size(), '\n', &text[0]);
+            clobber_memory();
+        }
+    }, 1024, 1024 * 17},
+    {"int_format.ostream_hex", [](uint64_t n) {
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ostringstream text;
+            text << hex << setfill('0');
+            for(uint64_t w : words)
+                text << setw(16) << w << '\n';
+            do_not_optimize(text.tellp());
+        }
+    }, 1024, 1024 * 17},
+    {"bloom_filter.contains", [](uint64_t n) {
+        static const BlockedBloomFilter filter = keys_filter(BloomBlock::CacheLine);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            size_t present = 0;
+            for(uint64_t h : probes)
+                present += filter.contains(h);
+            do_not_optimize(present);
+        }
+    }, probe_count, 0},
+    {"bloom_filter.contains_batch", [](uint64_t n) {
+        static const BlockedBloomFilter filter = keys_filter(BloomBlock::CacheLine);
+        static vector<uint64_t> found(probe_count / 64);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            filter.contains(probes.data(), probes.size(), found.data());
+            clobber_memory();
+        }
+    }, probe_count, 0},
+    {"bloom_filter.register_batch", [](uint64_t n) {
+        static const BlockedBloomFilter filter = keys_filter(BloomBlock::Register);
+        static vector<uint64_t> found(probe_count / 64);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            filter.contains(probes.data(), probes.size(), found.data());
+            clobber_memory();
+        }
+    }, probe_count, 0},
+    {"int_codec.decode_delta", [](uint64_t n) {
+        static const BitPackedSequence packed(sorted_ids, IntTransform::Delta);
+        static vector<uint32_t> ids(id_count);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            packed.decode(ids.data());
+            clobber_memory();
+        }
+    }, id_count, id_count * sizeof(uint32_t)},
+    {"int_codec.decode_for", [](uint64_t n) {
+        static const BitPackedSequence packed(sorted_ids, IntTransform::FrameOfReference);
+        static vector<uint32_t> ids(id_count);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            packed.decode(ids.data());
+            clobber_memory();
+        }
+    }, id_count, id_count * sizeof(uint32_t)},
+    {"int_codec.copy", [](uint64_t n) {
+        // Reading the IDs uncompressed, which decoding should beat
+        static vector<uint32_t> ids(id_count);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            copy(sorted_ids.begin(), sorted_ids.end(), ids.begin());
+            clobber_memory();
+        }
+    }, id_count, id_count * sizeof(uint32_t)},
+    {"int_codec.encode_delta", [](uint64_t n) {
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            BitPackedSequence packed(sorted_ids, IntTransform::Delta);
+            do_not_optimize(packed.size_in_bytes());
+        }
+    }, id_count, id_count * sizeof(uint32_t)},
+    {"radix_sort.uint32", [](uint64_t n) {
+        static vector<uint32_t> ids;
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ids = shuffled_ids;
+            radix_sort(ids);
+            clobber_memory();
+        }
+    }, sort_count, sort_count * sizeof(uint32_t)},
+    {"radix_sort.std_sort", [](uint64_t n) {
+        // What radix_sort replaces
+        static vector<uint32_t> ids;
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ids = shuffled_ids;
+            sort(ids.begin(), ids.end());
+            clobber_memory();
+        }
+    }, sort_count, sort_count * sizeof(uint32_t)},
+    {"radix_sort.uint64_pairs", [](uint64_t n) {
+        // 64-bit keys of 24 bits, with their index: 3 passes of 8
+        static vector<uint64_t> keys;
+        static vector<uint32_t> indexes(sort_count);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            keys.assign(shuffled_ids.begin(), shuffled_ids.end());
+            for(size_t k = 0; k < sort_count; ++k)
+                indexes[k] = uint32_t(k);
+            radix_sort(keys, indexes);
+            clobber_memory();
+        }
+    }, sort_count, sort_count * (sizeof(uint64_t) + sizeof(uint32_t))},
+    {"radix_sort.parallel", [](uint64_t n) {
+        static vector<uint32_t> ids;
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ids = shuffled_ids;
+            parallel_radix_sort(ids);
+            clobber_memory();
+        }
+    }, sort_count, sort_count * sizeof(uint32_t)},
+    {"lambdas.is_prime", [](uint64_t n) {
+        over_inputs(n, [](unsigned int v) { return is_prime(v); });
+    }, 1, 0},
+    {"lambdas.count_in_list", [](uint64_t n) {
+        static const list<unsigned int> numbers(inputs.begin(), inputs.begin() + 40);
+        for(uint64_t i = 0; i < n; ++i)
+            do_not_optimize(count_in_list<unsigned int>(is_prime, numbers));
+    }, 40, 0},
+    {"rvalues.ArrayWrapper_copy", [](uint64_t n) {
+        ArrayWrapper source = makeArray(array_size, 7);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ArrayWrapper copy(source);
+            do_not_optimize(copy.at(0));
+        }
+    }, 1, array_size * sizeof(int)},
+    {"rvalues.ArrayWrapper_move", [](uint64_t n) {
+        ArrayWrapper source = makeArray(array_size, 7);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            ArrayWrapper moved(std::move(source));
+            do_not_optimize(moved.at(0));
+            // ArrayWrapper has no move assignment: rebuild the moved-from
+            // source in place, its destructor having nothing to release
+            new (&source) ArrayWrapper(std::move(moved));
+        }
+    }, 1, array_size * sizeof(int)},
+    {"rvalues.copy_ints", [](uint64_t n) {
+        static vector<int> source(array_size, 7), destination(array_size);
+        for(uint64_t i = 0; i < n; ++i)
+        {
+            copy_ints(destination.data(), source.data(), source.size());
+            clobber_memory();
+        }
+    }, 1, array_size * sizeof(int)},
+    {"stats_counters.add", [](uint64_t n) {
+        static StatCounter& counter = stat_counter("bench.add");
+        for(uint64_t i = 0; i < n; ++i)
+            counter.add();
+        do_not_optimize(counter.local());
+    }, 1, 0},
+};
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        // Some kernels print, like in the demos: measure them without the terminal
+        ScopedOutputSink quiet(OutputSink::Null);
+        // The dispatched kernels run their variant for this level (see DEMO_CPU_LEVEL)
+        cerr << "CPU level: " << to_string(cpu_level()) << endl;
+        return run_benchmarks(benchmarks, sizeof(benchmarks)/sizeof(benchmarks[0]),
+            parse_bench_options(argc, argv));
+
+    } catch(invalid_argument const& e) {
+
+        cerr << e.what() << endl;
+        print_bench_usage(cerr, argv[0]);
+        return EXIT_FAILURE;
+
+    } catch(exception const& e) {
+
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+
+    }
+}
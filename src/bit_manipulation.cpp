@@ -1,60 +1,110 @@
 #include <array>
-#include <cstdio> // for printf
 #include <cstdint> // for uint8_t, uint64_t etc.
-#include <type_traits> // for is_integral
-#include <bitset>
 #include <iostream>
+#include "bit_manipulation.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+#include "int_format.h"
 
 using namespace std;
 
-// Create the bitmask for the K-th bit of the given value
-// Usage: int i=13; int bit4_mask = make_bitmask<4>(i);
-// Note: the value of the mask will be 2^K except for a 
-// signed integer, the value of mask of bit N-1 is -2^(N-1)
-template<size_t K, typename T>
-T make_bitmask(T int_variable)
+// C-style display base2 representation of an integer
+// Note: works for both signed and unsigned
+// Note: format_binary writes the 8 digits with one table lookup, for any integer type
+void print_binary(unsigned char int_value)
 {
-    static_assert(K < 8*sizeof(T), 
-        "bit mask: No such bit position in given type");
-    return T(1 << K);
+    char digits[8];
+    demo_out().write(digits, format_binary(int_value, digits) - digits);
 }
 
-// Create the bitset of the appropriate size from a given integer
-// Usage: int i = 13; auto bi = as_binary(i); // bi will be of type bitset<32>
-template<typename T>
-bitset<8*sizeof(T)> as_binary(T int_value)
+// Population count of an array, one variant per instruction set
+
+// Baseline: the builtin is a call to a bit-twiddling routine of libgcc
+static size_t popcount_words_scalar(const uint64_t* words, size_t count)
 {
-    static_assert(is_integral<T>::value, 
-        "binary representation: non-integer types not supported ");
-    return bitset<8*sizeof(T)>(int_value);
+    size_t total = 0;
+    for(size_t i = 0; i < count; ++i)
+        total += __builtin_popcountll(words[i]);
+    return total;
 }
 
-// C-style display base2 representation of an integer
-// Note: works for both signed and unsigned
-// Note: can be generalized to the other integer types
-void print_binary(unsigned char int_value)
+#ifdef HAS_X86_KERNELS
+// Same code, where the builtin is the POPCNT instruction
+__attribute__((target("popcnt")))
+static size_t popcount_words_sse42(const uint64_t* words, size_t count)
+{
+    size_t total = 0;
+    for(size_t i = 0; i < count; ++i)
+        total += __builtin_popcountll(words[i]);
+    return total;
+}
+
+// Nibble lookup with a byte shuffle (W. Mula): counts the bits of each byte,
+// then sums the bytes of each 64-bit lane with SAD
+__attribute__((target("avx2,popcnt")))
+static size_t popcount_words_avx2(const uint64_t* words, size_t count)
 {
-    for(unsigned char i = 1 << (8*sizeof(unsigned char)-1); i > 0; i >>= 1)
-        (int_value & i) ? printf("1") : printf("0");
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i sums = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        __m256i low = _mm256_and_si256(v, low_nibbles);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+        __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                        _mm256_shuffle_epi8(lookup, high));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+    size_t total = _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+                 + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    for(; i < count; ++i)
+        total += __builtin_popcountll(words[i]);
+    return total;
 }
 
-// C-style : keep only lowest set bit
-// Note this is based on 1's complement: -n = ~n + 1
-int lowest_set_bit(int int_value)
+BEGIN_AVX512_KERNELS
+// Same as AVX2, over 512-bit vectors. Does not need the VPOPCNTQ extension.
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static size_t popcount_words_avx512(const uint64_t* words, size_t count)
 {
-    return int_value & (-int_value);
+    const __m512i lookup = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                                                1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low_nibbles = _mm512_set1_epi8(0x0f);
+    __m512i sums = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(words + i);
+        __m512i low = _mm512_and_si512(v, low_nibbles);
+        __m512i high = _mm512_and_si512(_mm512_srli_epi16(v, 4), low_nibbles);
+        __m512i bytes = _mm512_add_epi8(_mm512_shuffle_epi8(lookup, low),
+                                        _mm512_shuffle_epi8(lookup, high));
+        sums = _mm512_add_epi64(sums, _mm512_sad_epu8(bytes, _mm512_setzero_si512()));
+    }
+    size_t total = _mm512_reduce_add_epi64(sums);
+    for(; i < count; ++i)
+        total += __builtin_popcountll(words[i]);
+    return total;
 }
+END_AVX512_KERNELS
+#endif
 
-// C-style : strip the lowest set bit
-int strip_lowest_set_bit(int int_value)
+static const Kernel<size_t (*)(const uint64_t*, size_t)> popcount_words_kernel(
+    "bit_manipulation.popcount_words", popcount_words_scalar,
+    X86_KERNEL(popcount_words_sse42), X86_KERNEL(popcount_words_avx2), X86_KERNEL(popcount_words_avx512));
+
+size_t popcount_words(const uint64_t* words, size_t count)
 {
-    return int_value & (int_value-1);
+    return popcount_words_kernel(words, count);
 }
 
 
 void demo_bit_manipulation()
 {
-    cout << endl << "************* Bit manipulation *************" << endl;
+    demo_out() << endl << "************* Bit manipulation *************" << endl;
 
     // Masks for a single bit in a 1-byte unsigned integer
     constexpr uint_fast8_t BIT0{ 1 << 0 }; // 0000 0001
@@ -73,149 +123,161 @@ void demo_bit_manipulation()
     // Display as decimal and as base2
     // Note: uint_fast_8 has char as underlying type, so without the "+",
     // cout displays a character j which is the ASCII for 106
-    cout << "Number: " << int_number << " = " << +int_number << " = 0b" << number << endl;
+    demo_out() << "Number: " << int_number << " = " << +int_number << " = 0b" << number << endl;
     // Combine single-bit masks
     auto bit_mask = BIT0 | BIT3 | BIT6;
     // Display resulting mask as decimal and as base2
-    cout << "Bit mask: " << bit_mask << " = 0b" << bitset<8>(bit_mask) << endl;
+    demo_out() << "Bit mask: " << bit_mask << " = 0b" << bitset<8>(bit_mask) << endl;
     // Display as base2 using C-style
-    printf("C-style : 106 = 0b"); print_binary(106); printf("\n");
-    printf("C-style : -73 = 0b"); print_binary(-73); printf("\n");
+    demo_out() << "C-style : 106 = 0b"; print_binary(106); demo_out() << '\n';
+    demo_out() << "C-style : -73 = 0b"; print_binary(-73); demo_out() << '\n';
     // Convert lower case to upper case - actually the AND mask just sets the 6th bit to zero
     char c1 = 'r';
     char lower_to_upper_mask = 0xDF; // 0b1101'1111
-    cout << c1 << " & 0xDF  = " << char(c1 & lower_to_upper_mask) << endl;
-    cout << bitset<8>(c1) << " & " << bitset<8>(lower_to_upper_mask) << " = " << bitset<8>(c1 & lower_to_upper_mask) << endl;
+    demo_out() << c1 << " & 0xDF  = " << char(c1 & lower_to_upper_mask) << endl;
+    demo_out() << bitset<8>(c1) << " & " << bitset<8>(lower_to_upper_mask) << " = " << bitset<8>(c1 & lower_to_upper_mask) << endl;
     // Convert upper case to lower case - use the complemented OR mask to set the 6th bit to one
     char c2 = 'R';
     char upper_to_lower_mask = 1 << 5; // 0b0010'0000
-    cout << c2 << " | 0x" << hex << +upper_to_lower_mask << dec << " = " << char(c2 | upper_to_lower_mask) << endl;
-    cout << bitset<8>(c2) << " | " << bitset<8>(upper_to_lower_mask) << " = " << bitset<8>(c2 | upper_to_lower_mask) << endl;
+    demo_out() << c2 << " | 0x" << hex << +upper_to_lower_mask << dec << " = " << char(c2 | upper_to_lower_mask) << endl;
+    demo_out() << bitset<8>(c2) << " | " << bitset<8>(upper_to_lower_mask) << " = " << bitset<8>(c2 | upper_to_lower_mask) << endl;
 
     char c3 = 'a';
     short s3 = 257;
     short s4 = -s3;
     int i3 = 1E5;
     // as_binary converts integer to the corresponding bitset - required for binary representation
-    cout << c3 << " = " << as_binary(c3) << endl;
-    cout << s3 << " = " << as_binary(s3) << endl;
-    cout << s4 << " = " << as_binary(s4) << endl;
-    cout << i3 << " = " << as_binary(i3) << endl;
+    demo_out() << c3 << " = " << as_binary(c3) << endl;
+    demo_out() << s3 << " = " << as_binary(s3) << endl;
+    demo_out() << s4 << " = " << as_binary(s4) << endl;
+    demo_out() << i3 << " = " << as_binary(i3) << endl;
     // Does not compile: not an integral type
     // float f3 = 3.14;
-    // cout << f3 << " = " << as_binary(f3) << endl;
+    // demo_out() << f3 << " = " << as_binary(f3) << endl;
 
     // make_bitmask
-    cout << "0th bit mask for a char  : " << as_binary(make_bitmask<0>('r')) << endl;
-    cout << "5th bit mask for a short : " << as_binary(make_bitmask<5>(s4)) << endl;
-    cout << "3rd bit mask for a int   : " << as_binary(make_bitmask<3>(int())) << endl;
+    demo_out() << "0th bit mask for a char  : " << as_binary(make_bitmask<0>('r')) << endl;
+    demo_out() << "5th bit mask for a short : " << as_binary(make_bitmask<5>(s4)) << endl;
+    demo_out() << "3rd bit mask for a int   : " << as_binary(make_bitmask<3>(int())) << endl;
     // Does not compile: 8th bit of char does not exist
-    // cout << "8th bit mask for a char  : " << as_binary(make_bitmask<8>('r')) << endl;
+    // demo_out() << "8th bit mask for a char  : " << as_binary(make_bitmask<8>('r')) << endl;
 
     // **** C-style manipulations (integer types) ****
-    cout << endl << "*** C-style bit manipulation ***" << endl;
-    cout << "Number        : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << endl << "*** C-style bit manipulation ***" << endl;
+    demo_out() << "Number        : " << +int_number << "\t= " << as_binary(int_number) << endl;
     int_number |= BIT2;
-    cout << "Set bit 2     : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Set bit 2     : " << +int_number << "\t= " << as_binary(int_number) << endl;
     int_number &= ~BIT5;
-    cout << "Cleared bit 5 : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Cleared bit 5 : " << +int_number << "\t= " << as_binary(int_number) << endl;
     int_number ^= BIT7;
-    cout << "Flipped bit 7 : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Flipped bit 7 : " << +int_number << "\t= " << as_binary(int_number) << endl;
     bool is_bit1_set = int_number & BIT1;
-    cout << "Is bit1 set ? : " << (is_bit1_set ? "true" : "false") << endl;
+    demo_out() << "Is bit1 set ? : " << (is_bit1_set ? "true" : "false") << endl;
     bool is_bit4_set = (int_number >> 4 ) & 1;
-    cout << "Is bit4 set ? : " << (is_bit4_set ? "true" : "false") << endl;
+    demo_out() << "Is bit4 set ? : " << (is_bit4_set ? "true" : "false") << endl;
     // This next trick works if x is either 0 or 1
     int x = 1;
     int_number ^= (-x ^ int_number) & BIT4;
-    cout << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
     int_number ^= (-x ^ int_number) & BIT4;
-    cout << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
     x = 0;
     int_number ^= (-x ^ int_number) & BIT4;
-    cout << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
     int_number ^= (-x ^ int_number) & BIT4;
-    cout << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << +int_number << "\t= " << as_binary(int_number) << endl;
 
-    uint bit_count = 0;
-    for (uint_fast8_t int_copy = int_number; int_copy; ++bit_count)
-    {
-        int_copy &= int_copy - 1;
-    }
-    cout << "Number of set bits            : " << bit_count << endl;
+    uint set_bits = count_set_bits(int_number);
+    demo_out() << "Number of set bits            : " << set_bits << endl;
 
     unsigned int u1 = 256u;
     unsigned int is_power_of_2 = u1 && !(u1 & (u1 - 1));
-    cout << u1 << " is a power of two ?    : " << (is_power_of_2 ? "true" : "false") << endl;
+    demo_out() << u1 << " is a power of two ?    : " << (is_power_of_2 ? "true" : "false") << endl;
     char c5 = -67;
-    #define IS_POWER_OF_TWO(x) (x && !(x & (x-1)))
-    cout << +c5 << " is a power of two ?    : " << (IS_POWER_OF_TWO(c5) ? "true" : "false") << endl;
-    #undef IS_POWER_OF_TWO
+    demo_out() << +c5 << " is a power of two ?    : " << (is_power_of_two(c5) ? "true" : "false") << endl;
     
     int_number = -1;
-    cout << "Set all bits (uint_fast8_t)   : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Set all bits (uint_fast8_t)   : " << +int_number << "\t= " << as_binary(int_number) << endl;
     int_number = 0;
-    cout << "Clear all bits (uint_fast8_t) : " << +int_number << "\t= " << as_binary(int_number) << endl;
+    demo_out() << "Clear all bits (uint_fast8_t) : " << +int_number << "\t= " << as_binary(int_number) << endl;
     unsigned short s5 = -1;
-    cout << "Set all bits (unsigned short) : " << +s5 << "\t= " << as_binary(s5) << endl;
+    demo_out() << "Set all bits (unsigned short) : " << +s5 << "\t= " << as_binary(s5) << endl;
     int i4 = ~int(0);
-    cout << "Set all bits (signed int)     : " << +i4 << "\t= " << as_binary(i4) << endl;
+    demo_out() << "Set all bits (signed int)     : " << +i4 << "\t= " << as_binary(i4) << endl;
     // Note: the -1 technique works for signed and unsigned and is more portable than
     // int_type x = ~int_type(0)
 
     // **** C++-style manipulations (bitest) ****
-    cout << endl << "*** C++-style bit manipulation ***" << endl;
-    cout << "Number        : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << endl << "*** C++-style bit manipulation ***" << endl;
+    demo_out() << "Number        : " << number.to_ulong() << "\t= " << number << endl;
     number.set(2);
-    cout << "Set bit 2     : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Set bit 2     : " << number.to_ulong() << "\t= " << number << endl;
     number.reset(5);
-    cout << "Cleared bit 5 : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Cleared bit 5 : " << number.to_ulong() << "\t= " << number << endl;
     number.flip(7);
-    cout << "Flipped bit 7 : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Flipped bit 7 : " << number.to_ulong() << "\t= " << number << endl;
     is_bit1_set = number.test(1);
-    cout << "Is bit1 set ? : " << (is_bit1_set ? "true" : "false") << endl;
+    demo_out() << "Is bit1 set ? : " << (is_bit1_set ? "true" : "false") << endl;
     is_bit4_set = number.test(4);
-    cout << "Is bit4 set ? : " << (is_bit4_set ? "true" : "false") << endl;
-    cout << "Number of set bits            : " << number.count() << endl;
+    demo_out() << "Is bit4 set ? : " << (is_bit4_set ? "true" : "false") << endl;
+    demo_out() << "Number of set bits            : " << number.count() << endl;
     // This next trick works if x is either 0 or 1
     x = 1;
     number.set(4, x > 0);
-    cout << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
     number[4] = (x > 0);
-    cout << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
     x = 0;
     number.set(4, x > 0);
-    cout << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
     number[4] = (x > 0);
-    cout << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Set bit 4 to x=" << x << " : " << number.to_ulong() << "\t= " << number << endl;
     auto bu1 = as_binary(u1);
-    cout << u1 << " is a power of two ?    : " << (bu1.count() == 1 ? "true" : "false") << endl;
+    demo_out() << u1 << " is a power of two ?    : " << (bu1.count() == 1 ? "true" : "false") << endl;
     auto bc5 = as_binary(c5);
-    cout << +c5 << " is a power of two ?    : " << (bc5.count() == 1 ? "true" : "false") << endl;
+    demo_out() << +c5 << " is a power of two ?    : " << (bc5.count() == 1 ? "true" : "false") << endl;
     number.set();
-    cout << "Set all bits (bitset<8>)      : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Set all bits (bitset<8>)      : " << number.to_ulong() << "\t= " << number << endl;
     number.reset();
-    cout << "Clear all bits (bitset<8>)    : " << number.to_ulong() << "\t= " << number << endl;
+    demo_out() << "Clear all bits (bitset<8>)    : " << number.to_ulong() << "\t= " << number << endl;
     auto us6 = ushort(-1);
-    cout << "Set all bits (unsigned short) : " << +us6 << "\t= " << as_binary(us6) << endl;
+    demo_out() << "Set all bits (unsigned short) : " << +us6 << "\t= " << as_binary(us6) << endl;
     auto i6 = ~int(0);
-    cout << "Set all bits (signed int)     : " << +i6 << "\t= " << as_binary(i6) << endl;
+    demo_out() << "Set all bits (signed int)     : " << +i6 << "\t= " << as_binary(i6) << endl;
 
-    cout << endl << "*** Byte masks ***" << endl;
+    demo_out() << endl << "*** Byte masks ***" << endl;
     // Mask for a single byte inside an int
     typedef bitset<8*sizeof(int)> int_bitmask;
     array<int_bitmask, sizeof(int)> BYTE_MASKS;
     for(size_t i = 0; i<sizeof(int); ++i)
     {
         BYTE_MASKS[i] = int_bitmask(0xff << i*8);
-        cout << "Byte " << i << " : " << BYTE_MASKS[i] << endl;
+        demo_out() << "Byte " << i << " : " << BYTE_MASKS[i] << '\n';
     }
 
-    cout << endl << "*** C-style bit hacks ***" << endl;
+    demo_out() << endl << "*** C-style bit hacks ***" << endl;
     char nb=84;
-    cout << "Number               : " << +nb << " = " << as_binary(nb) << endl;
+    demo_out() << "Number               : " << +nb << " = " << as_binary(nb) << endl;
     char lowest_bit_only = lowest_set_bit(nb);
-    cout << "Keep only lowest bit : " << +lowest_bit_only << " = " << as_binary(lowest_bit_only) << endl;
+    demo_out() << "Keep only lowest bit : " << +lowest_bit_only << " = " << as_binary(lowest_bit_only) << endl;
     char lowest_bit_striped = strip_lowest_set_bit(nb);
-    cout << "Strip lowest bit     : " << +lowest_bit_striped << " = " << as_binary(lowest_bit_striped) << endl;
+    demo_out() << "Strip lowest bit     : " << +lowest_bit_striped << " = " << as_binary(lowest_bit_striped) << endl;
+
+    demo_out() << endl << "*** Bit operations (bit_ops.h) ***" << endl;
+    // Any integer width: the 1 << K of a 64-bit mask is computed in 64 bits
+    uint64_t u64 = 0x0123456789abcdefull;
+    demo_out() << "63rd bit mask for a uint64_t : " << as_binary(make_bitmask<63>(u64)) << endl;
+    demo_out() << "Number               : " << hex << u64 << dec << endl;
+    demo_out() << "Set bits             : " << bit_count(u64) << ", parity " << parity(u64) << endl;
+    demo_out() << "Leading/trailing 0s  : " << count_leading_zeros(u64) << " / " << count_trailing_zeros(u64) << endl;
+    demo_out() << hex;
+    demo_out() << "Rotate left by 8     : " << rotate_left(u64, 8) << endl;
+    demo_out() << "Byte swap            : " << byte_swap(u64) << endl;
+    demo_out() << "Bit reverse          : " << bit_reverse(u64) << endl;
+    demo_out() << dec;
+    demo_out() << "floor/ceil log2(100) : " << log2_floor(100u) << " / " << log2_ceil(100u) << endl;
+    demo_out() << "Powers of two around 100 : " << prev_power_of_two(100u) << ", " << next_power_of_two(100u) << endl;
+    // All constexpr
+    static_assert(bit_reverse(uint8_t(0x01)) == 0x80 && next_power_of_two(uint16_t(257)) == 512,
+        "bit operations are usable at compile time");
 }
@@ -1,6 +1,41 @@
 #ifndef _BIT_MANIPULATION_H
 #define _BIT_MANIPULATION_H
 
+#include <bitset>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <type_traits> // for is_integral
+#include "bit_ops.h" // for make_bitmask, lowest_set_bit etc.
+
 void demo_bit_manipulation();
 
+// Create the bitset of the appropriate size from a given integer
+// Usage: int i = 13; auto bi = as_binary(i); // bi will be of type bitset<32>
+template<typename T>
+std::bitset<8*sizeof(T)> as_binary(T int_value)
+{
+    static_assert(std::is_integral<T>::value, 
+        "binary representation: non-integer types not supported ");
+    return std::bitset<8*sizeof(T)>(int_value);
+}
+
+// Count the set bits by stripping the lowest one until none is left
+// Note: loops once per set bit, not once per bit; bit_count is the instruction
+template<typename T>
+unsigned int count_set_bits(T int_value)
+{
+    unsigned int bit_count = 0;
+    for (T int_copy = int_value; int_copy; ++bit_count)
+    {
+        int_copy = strip_lowest_set_bit(int_copy);
+    }
+    return bit_count;
+}
+
+// Number of set bits in the array, with the fastest instructions of the host
+std::size_t popcount_words(const std::uint64_t* words, std::size_t count);
+
+// C-style display base2 representation of an integer
+void print_binary(unsigned char int_value);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,221 @@
+#ifndef _BIT_OPS_H_
+#define _BIT_OPS_H_
+
+#include <cstdint> // for uint64_t
+#include <limits>
+#include <type_traits> // for make_unsigned, is_integral
+
+// Bit operations on every integer width (8 to 64 bits), signed or not:
+// signed values are taken as their two's complement bit pattern.
+// All are constexpr. With GCC and Clang they are built on the compiler
+// builtins, which fold at compile time and become single instructions
+// (POPCNT, LZCNT, TZCNT, ROL, BSWAP...) where the target has them: the
+// program is built for the baseline x86-64, so inline them into a kernel
+// compiled with __attribute__((target("popcnt,lzcnt,bmi,bmi2"))) to get
+// those, as the Kernel variants do (see cpu_features.h). Other compilers
+// get portable loops.
+
+/// Unsigned type of the same width as T
+template<typename T>
+using bit_ops_unsigned = typename std::make_unsigned<T>::type;
+
+/// Number of bits of T
+template<typename T>
+constexpr unsigned int bit_width_of()
+{
+    static_assert(std::is_integral<T>::value, "bit operations: non-integer types not supported");
+    static_assert(sizeof(T) <= sizeof(uint64_t), "bit operations: integers of up to 64 bits");
+    return std::numeric_limits<bit_ops_unsigned<T>>::digits;
+}
+
+/// Mask of the K-th bit: 2^K, except for the sign bit of a signed type,
+/// whose mask is the lowest value of the type
+template<unsigned int K, typename T>
+constexpr T make_bitmask(T)
+{
+    static_assert(K < bit_width_of<T>(), "bit mask: No such bit position in given type");
+    return T(bit_ops_unsigned<T>(bit_ops_unsigned<T>(1) << K));
+}
+
+/// Number of set bits
+template<typename T>
+constexpr unsigned int bit_count(T value)
+{
+    bit_width_of<T>();
+#if defined(__GNUC__)
+    return sizeof(T) <= sizeof(unsigned int)
+        ? __builtin_popcount(bit_ops_unsigned<T>(value))
+        : __builtin_popcountll(bit_ops_unsigned<T>(value));
+#else
+    unsigned int count = 0;
+    for(bit_ops_unsigned<T> u = value; u; u &= u - 1)
+        ++count;
+    return count;
+#endif
+}
+
+/// 1 if the number of set bits is odd, 0 otherwise
+template<typename T>
+constexpr unsigned int parity(T value)
+{
+    bit_width_of<T>();
+#if defined(__GNUC__)
+    return sizeof(T) <= sizeof(unsigned int)
+        ? __builtin_parity(bit_ops_unsigned<T>(value))
+        : __builtin_parityll(bit_ops_unsigned<T>(value));
+#else
+    return bit_count(value) & 1;
+#endif
+}
+
+/// Number of zero bits above the highest set bit; the width of T for 0
+template<typename T>
+constexpr unsigned int count_leading_zeros(T value)
+{
+    const unsigned int width = bit_width_of<T>();
+    const bit_ops_unsigned<T> u = value;
+#if defined(__GNUC__)
+    // The builtins are undefined for 0: the test is a CMOV next to LZCNT,
+    // or nothing once inlined where the value is known to be non-zero
+    return u == 0 ? width
+        : sizeof(T) <= sizeof(unsigned int)
+        ? __builtin_clz(u) - (std::numeric_limits<unsigned int>::digits - width)
+        : __builtin_clzll(u);
+#else
+    unsigned int count = 0;
+    for(bit_ops_unsigned<T> mask = bit_ops_unsigned<T>(1) << (width - 1); count < width && !(u & mask); mask >>= 1)
+        ++count;
+    return count;
+#endif
+}
+
+/// Number of zero bits below the lowest set bit; the width of T for 0
+template<typename T>
+constexpr unsigned int count_trailing_zeros(T value)
+{
+    const unsigned int width = bit_width_of<T>();
+    const bit_ops_unsigned<T> u = value;
+#if defined(__GNUC__)
+    // Same test as count_leading_zeros
+    return u == 0 ? width
+        : sizeof(T) <= sizeof(unsigned int) ? __builtin_ctz(u) : __builtin_ctzll(u);
+#else
+    unsigned int count = 0;
+    for(bit_ops_unsigned<T> v = u; count < width && !(v & 1); v >>= 1)
+        ++count;
+    return count;
+#endif
+}
+
+/// Bits rotated towards the highest, by any count (modulo the width)
+template<typename T>
+constexpr T rotate_left(T value, unsigned int count)
+{
+    const unsigned int width = bit_width_of<T>();
+    const bit_ops_unsigned<T> u = value;
+    // Both shift counts stay below the width: no undefined shift, and a single ROL
+    return T(bit_ops_unsigned<T>((u << (count & (width - 1))) | (u >> ((0u - count) & (width - 1)))));
+}
+
+/// Bits rotated towards the lowest, by any count (modulo the width)
+template<typename T>
+constexpr T rotate_right(T value, unsigned int count)
+{
+    const unsigned int width = bit_width_of<T>();
+    const bit_ops_unsigned<T> u = value;
+    return T(bit_ops_unsigned<T>((u >> (count & (width - 1))) | (u << ((0u - count) & (width - 1)))));
+}
+
+/// Bytes in reverse order
+template<typename T>
+constexpr T byte_swap(T value)
+{
+    bit_width_of<T>();
+    const bit_ops_unsigned<T> u = value;
+#if defined(__GNUC__)
+    return T(sizeof(T) == 1 ? u
+        : sizeof(T) == 2 ? bit_ops_unsigned<T>(__builtin_bswap16(uint16_t(u)))
+        : sizeof(T) == 4 ? bit_ops_unsigned<T>(__builtin_bswap32(uint32_t(u)))
+        : bit_ops_unsigned<T>(__builtin_bswap64(uint64_t(u))));
+#else
+    bit_ops_unsigned<T> swapped = 0;
+    for(unsigned int i = 0; i < sizeof(T); ++i)
+        swapped = bit_ops_unsigned<T>((swapped << 8) | ((u >> (8 * i)) & 0xff));
+    return T(swapped);
+#endif
+}
+
+/// Bits in reverse order: swaps the bits, pairs and nibbles of each byte
+/// in parallel, then the bytes
+template<typename T>
+constexpr T bit_reverse(T value)
+{
+    bit_width_of<T>();
+    typedef bit_ops_unsigned<T> U;
+    const U ones = U(~U(0));
+    U u = value;
+    u = U(((u >> 1) & (ones / 3)) | ((u & (ones / 3)) << 1));    // 0x55...
+    u = U(((u >> 2) & (ones / 5)) | ((u & (ones / 5)) << 2));    // 0x33...
+    u = U(((u >> 4) & (ones / 17)) | ((u & (ones / 17)) << 4));  // 0x0f...
+    return byte_swap(T(u));
+}
+
+/// Lowest set bit alone, 0 for 0 (BLSI)
+/// Note: two's complement: -n = ~n + 1
+template<typename T>
+constexpr T lowest_set_bit(T value)
+{
+    bit_width_of<T>();
+    const bit_ops_unsigned<T> u = value;
+    return T(bit_ops_unsigned<T>(u & (0u - u)));
+}
+
+/// Value without its lowest set bit (BLSR)
+template<typename T>
+constexpr T strip_lowest_set_bit(T value)
+{
+    bit_width_of<T>();
+    const bit_ops_unsigned<T> u = value;
+    return T(bit_ops_unsigned<T>(u & (u - 1)));
+}
+
+/// Exactly one bit is set
+template<typename T>
+constexpr bool is_power_of_two(T value)
+{
+    return value != 0 && strip_lowest_set_bit(value) == 0;
+}
+
+/// Position of the highest set bit, floor(log2(value)). Requires value != 0
+template<typename T>
+constexpr unsigned int log2_floor(T value)
+{
+    return bit_width_of<T>() - 1 - count_leading_zeros(value);
+}
+
+/// ceil(log2(value)), 0 for 0 and 1
+template<typename T>
+constexpr unsigned int log2_ceil(T value)
+{
+    const bit_ops_unsigned<T> u = value;
+    return u <= 1 ? 0 : bit_width_of<T>() - count_leading_zeros(bit_ops_unsigned<T>(u - 1));
+}
+
+/// Highest power of two not above the value, 0 for 0
+template<typename T>
+constexpr T prev_power_of_two(T value)
+{
+    const bit_ops_unsigned<T> u = value;
+    return u == 0 ? T(0) : T(bit_ops_unsigned<T>(bit_ops_unsigned<T>(1) << log2_floor(u)));
+}
+
+/// Lowest power of two not below the value, 1 for 0.
+/// Requires the result to fit in the unsigned type of the same width.
+template<typename T>
+constexpr T next_power_of_two(T value)
+{
+    const bit_ops_unsigned<T> u = value;
+    return T(bit_ops_unsigned<T>(bit_ops_unsigned<T>(1) << log2_ceil(u)));
+}
+
+#endif /* _BIT_OPS_H_ */
@@ -0,0 +1,579 @@
+#include <algorithm> // for min, max
+#include <cmath> // for exp, log, lgamma, pow, sqrt
+#include <iostream>
+#include <stdexcept> // for invalid_argument, length_error
+#include <string>
+#include "bloom_filter.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+
+using namespace std;
+
+const unsigned int BlockedBloomFilter::max_hashes;
+
+// Odd multipliers of the low 32 bits of a hash, one per bit set: the
+// first 8 are those of the split block Bloom filters of Parquet
+alignas(64) static const uint32_t salts[BlockedBloomFilter::max_hashes] = {
+    0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d, 0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31,
+    0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f, 0x165667b1, 0xd3a2646d, 0xfd7046c5, 0xb55a4f09};
+
+// The block count fits in 32 bits, for the multiplications that pick a block
+static const size_t max_blocks = 0xffffffffu;
+
+// Bit set by hash i of a key, in its word: the top 6 bits of a product
+static inline uint64_t hash_bit(uint64_t hash, unsigned int i)
+{
+    return uint64_t(1) << ((uint32_t(hash) * salts[i]) >> 26);
+}
+
+uint64_t bloom_hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+// FNV-1a, whose high bits are weak, then mixed
+uint64_t bloom_hash(const char* key, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; ++i)
+        hash = (hash ^ uint8_t(key[i])) * 0x100000001b3ull;
+    return bloom_hash(hash);
+}
+
+// Probability that the k probes of a word all find their bit set, once j
+// keys have each set k bits of it: E[(X / 64)^k], X the bits set by k * j
+// uniform throws. The probes are not independent, they share the X bits.
+// The k probes hit d distinct bits with probability
+// S(k, d) 64! / (64 - d)! / 64^k (S the Stirling numbers of the second
+// kind), and d given bits are all set with probability, by inclusion and
+// exclusion, the sum over i of (-1)^i C(d, i) (1 - i / 64)^(k j).
+static double word_rate(unsigned int k, size_t j)
+{
+    if(k == 0)
+        return 1;
+    // none_of[i]: i given bits all left clear; all_set[d]: d given bits all set;
+    // stirling[d]: S(n, d), row by row up to n = k
+    double none_of[BlockedBloomFilter::max_hashes + 1];
+    double all_set[BlockedBloomFilter::max_hashes + 1] = {};
+    double stirling[BlockedBloomFilter::max_hashes + 1] = {1};
+    for(unsigned int i = 0; i <= k; ++i)
+        none_of[i] = pow(1 - i / 64.0, double(k) * double(j));
+    for(unsigned int d = 1; d <= k; ++d)
+    {
+        double binomial = 1;
+        for(unsigned int i = 0; i <= d; ++i)
+        {
+            all_set[d] += (i % 2 ? -binomial : binomial) * none_of[i];
+            binomial = binomial * (d - i) / (i + 1);
+        }
+    }
+    for(unsigned int n = 1; n <= k; ++n)
+    {
+        for(unsigned int d = n; d > 0; --d)
+            stirling[d] = d * stirling[d] + stirling[d - 1];
+        stirling[0] = 0;
+    }
+    // distinct: 64! / (64 - d)! / 64^d
+    double rate = 0, distinct = 1;
+    for(unsigned int d = 1; d <= k; ++d)
+    {
+        distinct *= (64 - d + 1) / 64.0;
+        rate += stirling[d] * distinct * pow(1 / 64.0, double(k - d)) * all_set[d];
+    }
+    return max(rate, 0.0);
+}
+
+// Model of the false positive rate: the keys spread over the blocks
+// following a Poisson distribution, and a block of j keys answers yes
+// by chance if the bits of each of its words are all set. The Poisson
+// terms follow from each other from the mode outwards, and stop once
+// they no longer change the sum.
+static double false_positive_rate(BloomBlock block, size_t block_count, unsigned int hash_count, size_t keys)
+{
+    unsigned int words = block == BloomBlock::CacheLine ? 8 : 1;
+    double keys_per_block = double(keys) / double(block_count);
+    if(keys_per_block == 0)
+        return 0;
+    // The words hold hash_count / words hashes, one more for the first
+    // hash_count % words of them: two word rates, each to some power
+    unsigned int fewer = hash_count / words, more = fewer + 1;
+    unsigned int words_more = hash_count % words;
+    unsigned int words_fewer = hash_count >= words ? words - words_more : 0;
+    auto block_rate = [&](size_t j) {
+        return pow(word_rate(more, j), double(words_more)) * pow(word_rate(fewer, j), double(words_fewer));
+    };
+    const double negligible = 1e-7;
+    size_t mode = size_t(keys_per_block);
+    double mode_probability = exp(-keys_per_block + double(mode) * log(keys_per_block) - lgamma(double(mode) + 1));
+    double rate = mode_probability * block_rate(mode);
+    // Above the mode the block rates grow, but the probabilities fall faster
+    double probability = mode_probability;
+    for(size_t j = mode + 1; probability > negligible * rate; ++j)
+    {
+        probability *= keys_per_block / double(j);
+        rate += probability * block_rate(j);
+    }
+    // Below it both fall
+    probability = mode_probability;
+    for(size_t j = mode; j > 0; --j)
+    {
+        probability *= double(j) / keys_per_block;
+        double term = probability * block_rate(j - 1);
+        rate += term;
+        if(term <= negligible * rate)
+            break;
+    }
+    return rate;
+}
+
+// Blocks for the given number of hashes to reach the rate, 0 if more than
+// max_blocks. Starts from the size of a classic Bloom filter with as many
+// hashes, m / n = -k / ln(1 - rate^(1/k)) bits per key, which blocking
+// raises a little: brackets it by doubling or halving, then bisects to
+// within 1/1024 of the size.
+static size_t blocks_for_rate(BloomBlock block, unsigned int hash_count, size_t keys, double rate)
+{
+    double block_bits = block == BloomBlock::CacheLine ? 512 : 64;
+    double bits_per_key = -double(hash_count) / log(1 - pow(rate, 1.0 / hash_count));
+    double estimate = min(double(keys) * bits_per_key / block_bits, double(max_blocks));
+    size_t low = 0;  // largest known to miss the rate
+    size_t high = max(size_t(estimate), size_t(1));
+    if(false_positive_rate(block, high, hash_count, keys) > rate)
+    {
+        do
+        {
+            if(high == max_blocks)
+                return 0;
+            low = high;
+            high = min(2 * high, max_blocks);
+        }
+        while(false_positive_rate(block, high, hash_count, keys) > rate);
+    }
+    else
+    {
+        while(high > 1)
+        {
+            size_t half = high / 2;
+            if(false_positive_rate(block, half, hash_count, keys) > rate)
+            {
+                low = half;
+                break;
+            }
+            high = half;
+        }
+    }
+    while(high - low > 1 && high - low > high / 1024)
+    {
+        size_t middle = low + (high - low) / 2;
+        if(false_positive_rate(block, middle, hash_count, keys) > rate)
+            low = middle;
+        else
+            high = middle;
+    }
+    return high;
+}
+
+BlockedBloomFilter::BlockedBloomFilter(size_t expected_keys, double false_positive_rate, BloomBlock block)
+:_block(block), _block_count(1), _hash_count(1)
+{
+    if(!(false_positive_rate > 0 && false_positive_rate < 1))
+        throw invalid_argument("Bloom filter: false positive rate " + to_string(false_positive_rate)
+                               + " not in (0, 1)");
+    // The fewest blocks over the numbers of hashes that reach the rate
+    size_t best_blocks = 0;
+    for(unsigned int k = 1; k <= max_hashes; ++k)
+    {
+        size_t blocks = blocks_for_rate(block, k, expected_keys, false_positive_rate);
+        if(blocks != 0 && (best_blocks == 0 || blocks < best_blocks))
+        {
+            best_blocks = blocks;
+            _hash_count = k;
+        }
+    }
+    if(best_blocks == 0)
+        throw length_error("Bloom filter: " + to_string(expected_keys) + " keys at a rate of "
+                           + to_string(false_positive_rate) + " need more than 2^32 blocks");
+    _block_count = best_blocks;
+    _bits = DynamicBitset(_block_count * block_words() * 64);
+}
+
+BlockedBloomFilter::BlockedBloomFilter(BloomBlock block, size_t block_count, unsigned int hash_count)
+:_block(block), _block_count(block_count), _hash_count(hash_count), _bits(block_count * block_words() * 64)
+{
+}
+
+void BlockedBloomFilter::add(uint64_t hash)
+{
+    uint64_t* words = _bits.data() + block_of(hash);
+    size_t mask = block_words() - 1;
+    for(unsigned int i = 0; i < _hash_count; ++i)
+        words[i & mask] |= hash_bit(hash, i);
+}
+
+bool BlockedBloomFilter::contains(uint64_t hash) const
+{
+    const uint64_t* words = _bits.data() + block_of(hash);
+    size_t mask = block_words() - 1;
+    for(unsigned int i = 0; i < _hash_count; ++i)
+    {
+        uint64_t bit = hash_bit(hash, i);
+        if(!(words[i & mask] & bit))
+            return false;
+    }
+    return true;
+}
+
+// Batched lookups, one variant per instruction set. Each block is
+// prefetched some lookups ahead: the misses of the next lookups overlap
+// the tests of the current ones.
+
+struct BloomProbe
+{
+    const uint64_t* words;
+    size_t block_count;
+    unsigned int hash_count;
+};
+
+static const size_t prefetch_distance = 16;
+
+static inline size_t probe_block(const BloomProbe& probe, uint64_t hash)
+{
+    return size_t(((hash >> 32) * probe.block_count) >> 32);
+}
+
+// Calls test(i) for each hash, which tells if hashes[i] is present, and
+// gathers the answers in the words of found
+template<typename Test>
+static inline void gather_found(size_t n, uint64_t* found, Test test)
+{
+    for(size_t w = 0; w * 64 < n; ++w)
+    {
+        uint64_t word = 0;
+        size_t count = min<size_t>(64, n - w * 64);
+        for(size_t i = 0; i < count; ++i)
+            word |= uint64_t(test(w * 64 + i)) << i;
+        found[w] = word;
+    }
+}
+
+template<BloomBlock block>
+static void contains_scalar_loop(const BloomProbe& probe, const uint64_t* hashes, size_t n, uint64_t* found)
+{
+    const size_t words = block == BloomBlock::CacheLine ? 8 : 1;
+    gather_found(n, found, [&](size_t i) {
+        if(i + prefetch_distance < n)
+            __builtin_prefetch(probe.words + probe_block(probe, hashes[i + prefetch_distance]) * words);
+        const uint64_t* block_words = probe.words + probe_block(probe, hashes[i]) * words;
+        uint64_t missing = 0;
+        for(unsigned int h = 0; h < probe.hash_count; ++h)
+        {
+            uint64_t bit = hash_bit(hashes[i], h);
+            missing |= bit & ~block_words[h % words];
+        }
+        return missing == 0;
+    });
+}
+
+static void contains_scalar(BloomBlock block, const BloomProbe& probe, const uint64_t* hashes, size_t n, uint64_t* found)
+{
+    if(block == BloomBlock::CacheLine)
+        contains_scalar_loop<BloomBlock::CacheLine>(probe, hashes, n, found);
+    else
+        contains_scalar_loop<BloomBlock::Register>(probe, hashes, n, found);
+}
+
+#ifdef HAS_X86_KERNELS
+// Cache line blocks: the 8 bits of hashes 0 to 7 of a key, one per word,
+// are 8 products of 32-bit lanes, turned into 64-bit masks by variable
+// shifts; hashes 8 to 15 likewise. The lanes past the hash count are
+// cleared. The block has every bit if and only if none is missing (TESTC).
+__attribute__((target("avx2")))
+static inline bool cache_line_contains_avx2(const uint64_t* block, uint64_t hash, __m256i enabled_low, __m256i enabled_high,
+                                            bool two_rounds)
+{
+    const __m256i one = _mm256_set1_epi64x(1);
+    __m256i key = _mm256_set1_epi32(int(uint32_t(hash)));
+    __m256i positions = _mm256_srli_epi32(_mm256_mullo_epi32(key, _mm256_load_si256(reinterpret_cast<const __m256i*>(salts))), 26);
+    __m256i mask_low = _mm256_and_si256(_mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(positions))),
+                                        _mm256_cvtepi32_epi64(_mm256_castsi256_si128(enabled_low)));
+    __m256i mask_high = _mm256_and_si256(_mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(positions, 1))),
+                                         _mm256_cvtepi32_epi64(_mm256_extracti128_si256(enabled_low, 1)));
+    if(two_rounds)
+    {
+        positions = _mm256_srli_epi32(_mm256_mullo_epi32(key, _mm256_load_si256(reinterpret_cast<const __m256i*>(salts + 8))), 26);
+        mask_low = _mm256_or_si256(mask_low, _mm256_and_si256(
+            _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(positions))),
+            _mm256_cvtepi32_epi64(_mm256_castsi256_si128(enabled_high))));
+        mask_high = _mm256_or_si256(mask_high, _mm256_and_si256(
+            _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(positions, 1))),
+            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(enabled_high, 1))));
+    }
+    return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block)), mask_low)
+        && _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block + 4)), mask_high);
+}
+
+// 32-bit lanes i of the hashes below the count, all ones
+__attribute__((target("avx2")))
+static inline __m256i enabled_lanes_avx2(unsigned int hash_count, unsigned int first)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(int(hash_count)),
+                              _mm256_setr_epi32(first, first + 1, first + 2, first + 3, first + 4, first + 5, first + 6, first + 7));
+}
+
+// Register blocks: 4 keys at a time, their words gathered, their masks
+// built hash by hash in 64-bit lanes
+__attribute__((target("avx2")))
+static void register_contains_avx2(const BloomProbe& probe, const uint64_t* hashes, size_t n, uint64_t* found)
+{
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i block_count = _mm256_set1_epi64x(static_cast<long long>(probe.block_count));
+    for(size_t w = 0; w * 64 < n; ++w)
+    {
+        uint64_t word = 0;
+        size_t count = min<size_t>(64, n - w * 64);
+        size_t i = 0;
+        for(; i + 4 <= count; i += 4)
+        {
+            const uint64_t* at = hashes + w * 64 + i;
+            if(at + prefetch_distance + 4 <= hashes + n)
+                for(size_t p = 0; p < 4; ++p)
+                    __builtin_prefetch(probe.words + probe_block(probe, at[prefetch_distance + p]));
+            __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at));
+            __m256i mask = _mm256_setzero_si256();
+            for(unsigned int k = 0; k < probe.hash_count; ++k)
+            {
+                __m256i product = _mm256_mul_epu32(h, _mm256_set1_epi64x(salts[k]));
+                __m256i position = _mm256_and_si256(_mm256_srli_epi64(product, 26), _mm256_set1_epi64x(63));
+                mask = _mm256_or_si256(mask, _mm256_sllv_epi64(one, position));
+            }
+            __m256i block = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(h, 32), block_count), 32);
+            __m256i words = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(probe.words), block, 8);
+            __m256i present = _mm256_cmpeq_epi64(_mm256_and_si256(words, mask), mask);
+            word |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(present))) << i;
+        }
+        for(; i < count; ++i)
+        {
+            uint64_t hash = hashes[w * 64 + i];
+            uint64_t mask = 0;
+            for(unsigned int k = 0; k < probe.hash_count; ++k)
+                mask |= hash_bit(hash, k);
+            word |= uint64_t((probe.words[probe_block(probe, hash)] & mask) == mask) << i;
+        }
+        found[w] = word;
+    }
+}
+
+__attribute__((target("avx2")))
+static void contains_avx2(BloomBlock block, const BloomProbe& probe, const uint64_t* hashes, size_t n, uint64_t* found)
+{
+    if(block == BloomBlock::Register)
+        return register_contains_avx2(probe, hashes, n, found);
+    __m256i enabled_low = enabled_lanes_avx2(probe.hash_count, 0);
+    __m256i enabled_high = enabled_lanes_avx2(probe.hash_count, 8);
+    bool two_rounds = probe.hash_count > 8;
+    // No lambda: it would not inherit the target, and take vectors by value
+    for(size_t w = 0; w * 64 < n; ++w)
+    {
+        uint64_t word = 0;
+        size_t count = min<size_t>(64, n - w * 64);
+        for(size_t i = 0; i < count; ++i)
+        {
+            size_t at = w * 64 + i;
+            if(at + prefetch_distance < n)
+                __builtin_prefetch(probe.words + probe_block(probe, hashes[at + prefetch_distance]) * 8);
+            word |= uint64_t(cache_line_contains_avx2(probe.words + probe_block(probe, hashes[at]) * 8, hashes[at],
+                                                      enabled_low, enabled_high, two_rounds)) << i;
+        }
+        found[w] = word;
+    }
+}
+
+BEGIN_AVX512_KERNELS
+// The 8 words of a cache line block in one vector, the disabled lanes under a mask
+__attribute__((target("avx512f,avx512vl")))
+static inline bool cache_line_contains_avx512(const uint64_t* block, uint64_t hash, __mmask8 enabled_low,
+                                              __mmask8 enabled_high)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    __m256i key = _mm256_set1_epi32(int(uint32_t(hash)));
+    __m256i positions = _mm256_srli_epi32(_mm256_mullo_epi32(key, _mm256_load_si256(reinterpret_cast<const __m256i*>(salts))), 26);
+    __m512i mask = _mm512_maskz_sllv_epi64(enabled_low, one, _mm512_cvtepu32_epi64(positions));
+    if(enabled_high)
+    {
+        positions = _mm256_srli_epi32(_mm256_mullo_epi32(key, _mm256_load_si256(reinterpret_cast<const __m256i*>(salts + 8))), 26);
+        mask = _mm512_or_si512(mask, _mm512_maskz_sllv_epi64(enabled_high, one, _mm512_cvtepu32_epi64(positions)));
+    }
+    return _mm512_cmpneq_epi64_mask(_mm512_and_si512(_mm512_load_si512(block), mask), mask) == 0;
+}
+
+__attribute__((target("avx512f,avx512vl,avx2")))
+static void contains_avx512(BloomBlock block, const BloomProbe& probe, const uint64_t* hashes, size_t n, uint64_t* found)
+{
+    if(block == BloomBlock::Register)
+        return register_contains_avx2(probe, hashes, n, found);
+    __mmask8 enabled_low = __mmask8(probe.hash_count >= 8 ? 0xff : (1u << probe.hash_count) - 1);
+    __mmask8 enabled_high = __mmask8(probe.hash_count <= 8 ? 0 : (1u << (probe.hash_count - 8)) - 1);
+    for(size_t w = 0; w * 64 < n; ++w)
+    {
+        uint64_t word = 0;
+        size_t count = min<size_t>(64, n - w * 64);
+        for(size_t i = 0; i < count; ++i)
+        {
+            size_t at = w * 64 + i;
+            if(at + prefetch_distance < n)
+                __builtin_prefetch(probe.words + probe_block(probe, hashes[at + prefetch_distance]) * 8);
+            word |= uint64_t(cache_line_contains_avx512(probe.words + probe_block(probe, hashes[at]) * 8, hashes[at],
+                                                        enabled_low, enabled_high)) << i;
+        }
+        found[w] = word;
+    }
+}
+END_AVX512_KERNELS
+#endif
+
+static const Kernel<void (*)(BloomBlock, const BloomProbe&, const uint64_t*, size_t, uint64_t*)> contains_kernel(
+    "bloom_filter.contains", contains_scalar, nullptr, X86_KERNEL(contains_avx2), X86_KERNEL(contains_avx512));
+
+void BlockedBloomFilter::contains(const uint64_t* hashes, size_t n, uint64_t* found) const
+{
+    contains_kernel(_block, BloomProbe{_bits.data(), _block_count, _hash_count}, hashes, n, found);
+}
+
+void BlockedBloomFilter::merge(const BlockedBloomFilter& other)
+{
+    if(_block != other._block || _block_count != other._block_count || _hash_count != other._hash_count)
+        throw invalid_argument("Bloom filter: merge of filters of different layouts");
+    _bits |= other._bits;
+}
+
+double BlockedBloomFilter::expected_false_positive_rate(size_t keys) const
+{
+    return ::false_positive_rate(_block, _block_count, _hash_count, keys);
+}
+
+bool BlockedBloomFilter::operator==(const BlockedBloomFilter& other) const
+{
+    return _block == other._block && _block_count == other._block_count
+        && _hash_count == other._hash_count && _bits == other._bits;
+}
+
+// Serialized form, little-endian: "BLOM", the block type (0 cache line,
+// 1 register), the hash count, 2 bytes of zeros, the block count on
+// 8 bytes, then the words of the blocks
+static const uint8_t magic[4] = {'B', 'L', 'O', 'M'};
+static const size_t header_size = 16;
+
+vector<uint8_t> BlockedBloomFilter::serialize() const
+{
+    size_t words = _block_count * block_words();
+    vector<uint8_t> out(header_size + 8 * words);
+    copy(magic, magic + 4, out.begin());
+    out[4] = _block == BloomBlock::CacheLine ? 0 : 1;
+    out[5] = uint8_t(_hash_count);
+    for(size_t b = 0; b < 8; ++b)
+        out[8 + b] = uint8_t(uint64_t(_block_count) >> (8 * b));
+    const uint64_t* data = _bits.data();
+    for(size_t w = 0; w < words; ++w)
+        for(size_t b = 0; b < 8; ++b)
+            out[header_size + 8 * w + b] = uint8_t(data[w] >> (8 * b));
+    return out;
+}
+
+BlockedBloomFilter BlockedBloomFilter::deserialize(const uint8_t* bytes, size_t size)
+{
+    if(size < header_size || !equal(magic, magic + 4, bytes))
+        throw invalid_argument("Bloom filter: no serialized filter header");
+    if(bytes[4] > 1 || bytes[5] < 1 || bytes[5] > max_hashes || bytes[6] || bytes[7])
+        throw invalid_argument("Bloom filter: invalid layout in the header");
+    uint64_t block_count = 0;
+    for(size_t b = 0; b < 8; ++b)
+        block_count |= uint64_t(bytes[8 + b]) << (8 * b);
+    BloomBlock block = bytes[4] == 0 ? BloomBlock::CacheLine : BloomBlock::Register;
+    size_t block_words = block == BloomBlock::CacheLine ? 8 : 1;
+    if(block_count == 0 || block_count > max_blocks || (size - header_size) / 8 / block_words != block_count
+       || (size - header_size) % (8 * block_words))
+        throw invalid_argument("Bloom filter: " + to_string(size - header_size) + " bytes of blocks for "
+                               + to_string(block_count) + " blocks");
+    BlockedBloomFilter filter(block, size_t(block_count), bytes[5]);
+    uint64_t* data = filter._bits.data();
+    for(size_t w = 0; w < block_count * block_words; ++w)
+    {
+        uint64_t word = 0;
+        for(size_t b = 0; b < 8; ++b)
+            word |= uint64_t(bytes[header_size + 8 * w + b]) << (8 * b);
+        data[w] = word;
+    }
+    return filter;
+}
+
+void demo_bloom_filter()
+{
+    demo_out() << endl << "************** Bloom filter **************" << endl;
+
+    // The keywords of C++, searched by a linear scan like is_one_of:
+    // most identifiers are not keywords, and the filter skips their scan
+    static const char* const keywords[] = {
+        "alignas", "alignof", "and", "asm", "auto", "bool", "break", "case", "catch", "char",
+        "class", "const", "constexpr", "const_cast", "continue", "decltype", "default", "delete",
+        "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false",
+        "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace",
+        "new", "noexcept", "nullptr", "operator", "or", "private", "protected", "public",
+        "register", "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+        "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local",
+        "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using",
+        "virtual", "void", "volatile", "wchar_t", "while"};
+    BlockedBloomFilter filter(sizeof(keywords) / sizeof(keywords[0]), 0.01);
+    for(const char* k : keywords)
+        filter.add(bloom_hash(k, string(k).size()));
+    demo_out() << sizeof(keywords) / sizeof(keywords[0]) << " keywords in " << filter.block_count() << " cache lines ("
+               << filter.size_in_bytes() << " bytes), " << filter.hash_count() << " hashes" << endl;
+
+    auto is_keyword = [&](const string& word) {
+        if(!filter.contains(bloom_hash(word.data(), word.size())))
+            return false;
+        for(const char* k : keywords)
+            if(word == k)
+                return true;
+        return false;
+    };
+    for(const char* word : {"constexpr", "demo", "while", "filter", "static_cast"})
+        demo_out() << word << (is_keyword(word) ? " is a keyword" : " is not a keyword") << endl;
+
+    // Measured false positive rate, for the rate asked and the layouts
+    const size_t keys = 100000, probes = 100000;
+    const double rate = 0.01;
+    vector<uint64_t> absent(probes);
+    for(size_t i = 0; i < probes; ++i)
+        absent[i] = bloom_hash(uint64_t(keys + i));
+    vector<uint64_t> found((probes + 63) / 64);
+    for(BloomBlock block : {BloomBlock::CacheLine, BloomBlock::Register})
+    {
+        BlockedBloomFilter ids(keys, rate, block);
+        for(size_t i = 0; i < keys; ++i)
+            ids.add(bloom_hash(uint64_t(i)));
+        ids.contains(absent.data(), probes, found.data());
+        DynamicBitset found_bits(probes);
+        copy(found.begin(), found.end(), found_bits.data());
+        demo_out() << (block == BloomBlock::CacheLine ? "Cache line blocks : " : "Register blocks   : ")
+                   << double(ids.size_in_bytes()) * 8 / keys << " bits per key, " << ids.hash_count()
+                   << " hashes, false positives " << found_bits.count() << " in " << probes
+                   << ", within the rate asked ? " << (double(found_bits.count()) <= rate * probes ? "true" : "false") << endl;
+    }
+
+    vector<uint8_t> bytes = filter.serialize();
+    demo_out() << "Serialized : " << bytes.size() << " bytes, read back equal ? "
+               << (BlockedBloomFilter::deserialize(bytes.data(), bytes.size()) == filter ? "true" : "false") << endl;
+    try
+    {
+        BlockedBloomFilter::deserialize(bytes.data(), bytes.size() - 8);
+    }
+    catch(invalid_argument const& e)
+    {
+        demo_out() << "Error : " << e.what() << endl;
+    }
+}
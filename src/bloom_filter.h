@@ -0,0 +1,87 @@
+#ifndef _BLOOM_FILTER_H_
+#define _BLOOM_FILTER_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t, uint8_t
+#include <vector>
+#include "dynamic_bitset.h"
+
+/// Bloom filter demo: a pre-filter in front of a linear scan
+void demo_bloom_filter();
+
+/// Bits of the filter a key sets, all within one block
+enum class BloomBlock : unsigned int
+{
+    CacheLine,  ///< 512 bits: one cache miss per lookup
+    Register    ///< 64 bits: one word per lookup, at a higher false positive rate for the size
+};
+
+/// 64-bit hash of a string, mixed well enough for the filter
+uint64_t bloom_hash(const char* key, size_t size);
+/// Mix of an integer key (MurmurHash3 finalizer): keys that are not hashes already
+uint64_t bloom_hash(uint64_t key);
+
+/// Blocked Bloom filter (Putze, Sanders, Singler, "Cache-, Hash- and
+/// Space-Efficient Bloom Filters"): a set of hashes that answers
+/// "maybe present" or "surely absent", here for about one cache miss.
+/// The high 32 bits of a hash pick a block; its low 32 bits times k odd
+/// constants give the k bits set in the block, hash i in word i % 8 of a
+/// cache line. The blocks are aligned, so a lookup reads one cache line,
+/// or a single word for register blocks, and batches of lookups test whole
+/// blocks with SIMD masks (see cpu_features.h).
+///
+/// The number of blocks and of bits per key are chosen for the expected
+/// number of keys and false positive rate, which holds as long as no more
+/// keys are added. The hashes must be well mixed: see bloom_hash.
+class BlockedBloomFilter
+{
+public:
+    static const unsigned int max_hashes = 16;
+
+    /// Throws std::invalid_argument unless 0 < false_positive_rate < 1
+    BlockedBloomFilter(size_t expected_keys, double false_positive_rate,
+                       BloomBlock block = BloomBlock::CacheLine);
+
+    void add(uint64_t hash);
+    /// False if the hash was never added; true if it was, or by chance
+    bool contains(uint64_t hash) const;
+    /// Bit i % 64 of found[i / 64] is contains(hashes[i]), for the
+    /// (n + 63) / 64 words
+    void contains(const uint64_t* hashes, size_t n, uint64_t* found) const;
+
+    /// Adds the keys of a filter of the same layout. Throws std::invalid_argument otherwise.
+    void merge(const BlockedBloomFilter& other);
+    void clear() { _bits.reset(); }
+
+    BloomBlock block() const { return _block; }
+    size_t block_count() const { return _block_count; }
+    /// Bits set per key
+    unsigned int hash_count() const { return _hash_count; }
+    size_t size_in_bytes() const { return _bits.word_count() * sizeof(uint64_t); }
+
+    /// Probability that a hash not added is reported present, once the
+    /// given number of keys are
+    double expected_false_positive_rate(size_t keys) const;
+
+    /// Portable form: little-endian whatever the host
+    std::vector<uint8_t> serialize() const;
+    /// Throws std::invalid_argument if the bytes are not a serialized filter
+    static BlockedBloomFilter deserialize(const uint8_t* bytes, size_t size);
+
+    bool operator==(const BlockedBloomFilter& other) const;
+    bool operator!=(const BlockedBloomFilter& other) const { return !(*this == other); }
+
+private:
+    BlockedBloomFilter(BloomBlock block, size_t block_count, unsigned int hash_count);
+
+    size_t block_words() const { return _block == BloomBlock::CacheLine ? 8 : 1; }
+    /// First word of the block of the hash
+    size_t block_of(uint64_t hash) const { return size_t(((hash >> 32) * _block_count) >> 32) * block_words(); }
+
+    BloomBlock _block;
+    size_t _block_count;    ///< at most 2^32
+    unsigned int _hash_count;
+    DynamicBitset _bits;    ///< cache-line aligned: so are the blocks
+};
+
+#endif /* _BLOOM_FILTER_H_ */
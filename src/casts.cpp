@@ -1,5 +1,8 @@
 // References: https://arne-mertz.de/2015/01/a-casting-show/
 #include "casts.h"
+#include "demo_output.h"
+#include "latency.h"
+#include "trace.h"
 #include <climits>
 #include <iostream>
 
@@ -10,12 +13,12 @@ using namespace std;
 
 void takesAnInt(int a)
 {
-    cout << a << " - this is the overload that takes an int" << endl;
+    demo_out() << a << " - this is the overload that takes an int" << endl;
 }
 
 void takesAnInt(long int b)
 {
-    cout << b << " - this is the overload that takes a long int " << endl;
+    demo_out() << b << " - this is the overload that takes a long int " << endl;
 }
 
 class Pet {
@@ -38,14 +41,16 @@ void feedTheCat(Pet& b)
 
 void feedItAMouse(Pet& b)
 {
-    cout << "Your pet says : 'A mouse ? ";
+    TRACE_SPAN("casts.feedItAMouse");
+    LATENCY_PROBE("casts.feedItAMouse");
+    demo_out() << "Your pet says : 'A mouse ? ";
     try
     {
         MouseEater& f = dynamic_cast<MouseEater&>(b);
         UNUSED_VAR(f);
-        cout << " Yum-yum !'" << endl;
+        demo_out() << " Yum-yum !'" << endl;
     }catch(/*std::bad_cast const& bc*/...){
-        cout << " I hate you !'" << endl;
+        demo_out() << " I hate you !'" << endl;
     }
 }
 
@@ -82,14 +87,14 @@ public:
     void println()
     {
         for (size_t i=0; i<_n; ++i)
-            cout << _data[i] << " ";
-        cout << endl;
+            demo_out() << _data[i] << " ";
+        demo_out() << endl;
     }
 };
 
 void demo_casts()
 {
-    cout << endl << "*************** Casts ********************" << endl;
+    demo_out() << endl << "*************** Casts ********************" << endl;
     /// Static cast
     /// A a; B b = static_cast<B>(a);
     /// The most straightforward check-at-compile-time cast operator in C++
@@ -135,7 +140,7 @@ void demo_casts()
     UNUSED_VAR(l);
 
     // Use case 3 - forcing overload choice
-    cout << "j value is " << j << endl;
+    demo_out() << "j value is " << j << endl;
     takesAnInt(j);
     takesAnInt(static_cast<long>(j)); 
 
@@ -146,7 +151,7 @@ void demo_casts()
     feedTheCat(*b); ///< Contains an explicit static cast from Pet& to Cat&
 
     // Use case 4 - misuse
-    cout << "Choose a pet : input < 0 for Cat, "
+    demo_out() << "Choose a pet : input < 0 for Cat, "
         "0 <= input < 5 for Ferret, "
         "input >= 5 for Dog" << endl;
     short petChoice = 0;
@@ -166,13 +171,13 @@ void demo_casts()
     void* pV = &j;
     // Compiles, no warning -> bogus value is printed
     double* pDbl = static_cast<double*>(pV);
-    cout << "Int reinterpreted as double : " << j << " == " << *pDbl << endl;
+    demo_out() << "Int reinterpreted as double : " << j << " == " << *pDbl << endl;
     // One may as well use reinterpret_cast if not sure that pV is a double*
 
     // Use case 5
     void* vpJ = &j;
     int* p2J = static_cast<int*>(vpJ);
-    cout << "j value is still " << *p2J << endl;
+    demo_out() << "j value is still " << *p2J << endl;
 
     /// Dynamic cast
     /// A a; B b = dynamic_cast<B>(a);
@@ -199,9 +204,9 @@ void demo_casts()
     // Use case 1
     Dog* pDog = dynamic_cast<Dog*>(pD);
     if(pDog)
-        cout << "Dog says 'woof!'" << endl;
+        demo_out() << "Dog says 'woof!'" << endl;
     else
-        cout << "Your pet is not a dog." << endl;
+        demo_out() << "Your pet is not a dog." << endl;
 
     // Use case 2
     feedItAMouse(*pD); ///< Contains a dynamic cast from Pet& to MouseEater&
@@ -241,9 +246,9 @@ void demo_casts()
                         // with offset of sizeof(B2) = sizeof(int) = 4 bytes
     D* p2D_ok = static_cast<D*>(p2B3);          // correctly removes the offset
     D* p2D_ko = reinterpret_cast<D*>(p2B3);     // keeps the same address
-    cout << "Address of d is " << &d0 << endl;
-    cout << "p2D_ok points to " << p2D_ok << endl;
-    cout << "p2D_ko points to " << p2D_ko << endl;
+    demo_out() << "Address of d is " << &d0 << endl;
+    demo_out() << "p2D_ok points to " << p2D_ok << endl;
+    demo_out() << "p2D_ko points to " << p2D_ko << endl;
     // For downcasts one should use either static_cast or dynamic_cast, 
     // never reinterpret_cast.
 
@@ -270,14 +275,14 @@ void demo_casts()
     const_cast<MyContainer*>(&cmc)->println();
 
     // Use case 2
-    cout << "Element at index 2: " << cmc.at(2) << endl;
+    demo_out() << "Element at index 2: " << cmc.at(2) << endl;
     // Does not compile: OK: only the RHV accessor works on a constant container
     // cmc.at(2) = 19;
     MyContainer mc(5, table);
-    cout << "Element at index 2: " << mc.at(2) << endl;
+    demo_out() << "Element at index 2: " << mc.at(2) << endl;
     // Here, the LHV accessor is using the const_cast; see class definition
     mc.at(2) = 13;
-    cout << "Element at index 2: " << mc.at(2) << endl;
+    demo_out() << "Element at index 2: " << mc.at(2) << endl;
 
     /// C-style cast
     /// A a; B b = (B) a;
@@ -298,7 +303,7 @@ void demo_casts()
     // Misuse
     const int m = j;
     pDbl = (double*)&m;
-    cout << "j value as a double is " << *pDbl <<endl;
+    demo_out() << "j value as a double is " << *pDbl <<endl;
     // Here one should prefer either static_cast or reinterpret_cast.
     // C-style cast casts away constness - rarely wanted - and may
     // degrade in a reinterpret_cast, which does no type checking and is unsafe
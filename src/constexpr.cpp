@@ -1,7 +1,14 @@
 #include "constexpr.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+#include "frozen.h"
+#include "lookup_tables.h"
+#include "perfect_hash.h"
+#include <cstdint> // for uintptr_t
 #include <cstring> // for std::strlen
+#include <string>
 #include <cstdio> // for printf
-#include <iostream> // for std::cout
+#include <iostream> // for std::endl
 #include <type_traits> // for std::is_same
 #include <array>
 #include <experimental/array>
@@ -96,36 +103,6 @@ constexpr pair<size_t, size_t> size_range(size_t size, size_t tolerance)
     return pair<size_t, size_t>(size_min(size, tolerance), size + tolerance);
 }
 
-// Computes greatest common divisor recursively
-constexpr uint gcd(uint a, uint b)
-{
-    return a ==0 || b==0 ? 0 : (
-        a == b ? a : (a < b ? gcd(a, b-a) : gcd(a - b, b))
-    );
-}
-
-// Recursive integer square root recursive helper
-#define MID ((lo + hi + 1) / 2)
-constexpr uint64_t sqrt_helper(uint64_t x, uint64_t lo, uint64_t hi)
-{
-  return lo == hi ? lo : ((x / MID < MID)
-      ? sqrt_helper(x, lo, MID - 1) : sqrt_helper(x, MID, hi));
-}
-#undef MID
-
-// Compute integer square root using binary search
-constexpr uint64_t csqrt(uint64_t x)
-{
-  return sqrt_helper(x, 0, x / 2 + 1);
-}
-
-
-// Constexpr version of strlen 
-constexpr size_t cx_strlen(const char* str)
-{
-    return (str == nullptr || *str == '\0') ? 0 : 1 + cx_strlen(str + 1);
-}
-
 // Constexpr version of strcmp for C-string literals of known size
 // - does not work with constexpr const char* parameters ('\0'-ending but unknown size)
 template<size_t N1, size_t N2>
@@ -148,15 +125,6 @@ constexpr int cx_strcmp(const char* a, const char* b)
         strcmp(a+1, b+1);
 }
 
-// True if given string is present in given list (C-array) of strings
-template<size_t N>
-constexpr bool is_one_of(const char* x, const char* const (&list)[N], size_t K = 0)
-{
-    return K >= N ? false : (
-        0 == cx_strcmp(x, list[K]) ? true : is_one_of(x, list, K+1)
-    );
-}
-
 // Create std::array<T, N> from an initializer list of N values
 // This allows initializing std::array without counting the rhs values
 // example: auto a = make_array(1.41, 2.71, 3.14);
@@ -193,6 +161,12 @@ constexpr bool is_almost_one_of(double x1, const double (&xarray)[N], double eps
     );
 }
 
+// Generator of a table: the cube of the index
+constexpr uint64_t cube(size_t n)
+{
+    return uint64_t(n) * n * n;
+}
+
 // Consexpr-friendly string class
 class cx_string
 {
@@ -213,10 +187,95 @@ public:
     constexpr const char* const& c_str() const { return _str; }
 };
 
+// Length of a string, one variant per instruction set
+
+static size_t strlen_scalar(const char* str)
+{
+    const char* end = str;
+    while(*end)
+        ++end;
+    return end - str;
+}
+
+#ifdef HAS_X86_KERNELS
+// The vector variants compare whole aligned blocks with zero. An aligned load
+// never crosses a page boundary, so reading the bytes around the string is
+// safe, though invisible to the compiler: hence no_sanitize_address.
+
+// 16 bytes at a time with SSE2
+__attribute__((no_sanitize_address))
+static size_t strlen_sse42(const char* str)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t misalignment = reinterpret_cast<uintptr_t>(str) & 15;
+    const char* block = str - misalignment;
+    // Ignore the zeros before the string
+    unsigned int zeros = _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(block)), zero)) >> misalignment;
+    if(zeros)
+        return __builtin_ctz(zeros);
+    for(;;)
+    {
+        block += 16;
+        zeros = _mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(block)), zero));
+        if(zeros)
+            return block - str + __builtin_ctz(zeros);
+    }
+}
+
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t strlen_avx2(const char* str)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t misalignment = reinterpret_cast<uintptr_t>(str) & 31;
+    const char* block = str - misalignment;
+    unsigned int zeros = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(block)), zero))) >> misalignment;
+    if(zeros)
+        return __builtin_ctz(zeros);
+    for(;;)
+    {
+        block += 32;
+        zeros = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(block)), zero));
+        if(zeros)
+            return block - str + __builtin_ctz(zeros);
+    }
+}
+
+// The comparison gives a 64-bit mask directly, without movemask
+__attribute__((target("avx512f,avx512bw"), no_sanitize_address))
+static size_t strlen_avx512(const char* str)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    size_t misalignment = reinterpret_cast<uintptr_t>(str) & 63;
+    const char* block = str - misalignment;
+    uint64_t zeros = _mm512_cmpeq_epi8_mask(_mm512_load_si512(block), zero) >> misalignment;
+    if(zeros)
+        return __builtin_ctzll(zeros);
+    for(;;)
+    {
+        block += 64;
+        zeros = _mm512_cmpeq_epi8_mask(_mm512_load_si512(block), zero);
+        if(zeros)
+            return block - str + __builtin_ctzll(zeros);
+    }
+}
+#endif
+
+static const Kernel<size_t (*)(const char*)> strlen_kernel("constexpr.fast_strlen",
+    strlen_scalar, X86_KERNEL(strlen_sse42), X86_KERNEL(strlen_avx2), X86_KERNEL(strlen_avx512));
+
+size_t fast_strlen(const char* str)
+{
+    return strlen_kernel(str);
+}
+
 // Main function
 void demo_constexpr()
 {
-    cout << endl << "*************** Constexpr ***********" << endl;
+    demo_out() << endl << "*************** Constexpr ***********" << endl;
 
     // Integers only
     constexpr size_t size1 = 13;
@@ -224,12 +283,12 @@ void demo_constexpr()
 
     // Test that the return of size_min is usable at compile time
     array <int, size_min(size1, tolerance)> a0;
-    cout << "Array of min size " << a0.size() << '\n';
+    demo_out() << "Array of min size " << a0.size() << '\n';
 
     // Test that the return of size_range is usable at compile time
     constexpr auto sizes_min_max = size_range(size1, tolerance);
     array <int, sizes_min_max.second> a00;    
-    cout << "Array of max size " << a00.size() << '\n';
+    demo_out() << "Array of max size " << a00.size() << '\n';
 
     // Compute greatest common divisor of two integers at compile time
     static_assert( 24 == gcd(1440, 168), "invalid gcd");
@@ -238,15 +297,27 @@ void demo_constexpr()
     static_assert( 14 == gcd(14, 14), "invalid gcd");
     
     // Compute greatest common divisor of two integers at runtime
-    cout << "GCD(" << 1440 << ',' << 168 << ") = " << gcd(1440, 168) << '\n';
-    cout << "GCD(" << 15 << ',' << 17 << ") = " << gcd(15, 17) << '\n';
-    cout << "GCD(" << 12 << ',' << 0 << ") = " << gcd(12, 0) << '\n';
-    cout << "GCD(" << 14 << ',' << 14 << ") = " << gcd(14, 14) << '\n';
+    demo_out() << "GCD(" << 1440 << ',' << 168 << ") = " << gcd(1440, 168) << '\n';
+    demo_out() << "GCD(" << 15 << ',' << 17 << ") = " << gcd(15, 17) << '\n';
+    demo_out() << "GCD(" << 12 << ',' << 0 << ") = " << gcd(12, 0) << '\n';
+    demo_out() << "GCD(" << 14 << ',' << 14 << ") = " << gcd(14, 14) << '\n';
 
     // Compute square root at compile time
     static_assert( 13 == csqrt(169), "invalid sqrt");
     static_assert( 11 == csqrt(122), "invalid sqrt");
     static_assert( 4 == csqrt(24), "invalid sqrt");
+    // Small values are one load from a table generated at compile time
+    // (lookup_tables.h), like any table of a constexpr function
+    static_assert( 63 == table_isqrt(4095) && 8 == table_popcount(0xff), "invalid tables");
+    constexpr auto cubes = make_table<uint64_t, 8>(cube);
+    demo_out() << "Table of cubes : ";
+    for(const auto& elem : cubes) demo_out() << elem << ", ";
+    demo_out() << '\n';
+    demo_out() << "Primes below 40 from the prime table : ";
+    for(unsigned int n = 0; n < 40; ++n)
+        if(table_is_prime(n))
+            demo_out() << n << ", ";
+    demo_out() << '\n';
 
     // Floating point values
     constexpr double xvalues[] = {1.41, 2.71, 3.14};
@@ -262,60 +333,85 @@ void demo_constexpr()
     constexpr const char cs1[] = "Hello World!";
     // Constexpr function to determine length of C-string
     // Note: using raw string literal R"delimiter( raw_characters )delimiter"
-    cout << R"(cx_strlen("Hello World!") = )" << cx_strlen("Hello World!") << '\n';
+    demo_out() << R"(cx_strlen("Hello World!") = )" << cx_strlen("Hello World!") << '\n';
     // Construct array and copy C-string into it. 
     // Unfortunately cannot initialize with C-string auto-deducing char type and size.
     array<char, cx_strlen(cs1)> a1;
     std::move(std::begin(cs1), std::end(cs1), a1.begin());
-    cout << "Array of size " << a1.size() << ": " << a1.data() << '\n';
+    demo_out() << "Array of size " << a1.size() << ": " << a1.data() << '\n';
 
     // Create int array like a C-array !
     auto a3 = make_array(2, 3, 5, 7, 11, 13, 17, 19);
     // Check that type is indeed an array<int, 8> !
     static_assert(is_same<decltype(a3), array<int, 8> >::value, "Not same type");
     // Display content
-    cout << "Array of size " << a3.size() << ": ";
-    for(const auto& elem : a3) cout << elem << ", ";
-    cout << '\n';
+    demo_out() << "Array of size " << a3.size() << ": ";
+    for(const auto& elem : a3) demo_out() << elem << ", ";
+    demo_out() << '\n';
+
+    // Sort an array at compile time, then search it as a frozen set (frozen.h)
+    constexpr auto a4 = cx_sort(make_array(17, 3, 11, 2, 19, 7, 13, 5));
+    static_assert(a4[0] == 2 && a4[7] == 19, "not sorted");
+    demo_out() << "Sorted array : ";
+    for(const auto& elem : a4) demo_out() << elem << ", ";
+    demo_out() << '\n';
+    constexpr auto primes = make_frozen_set(a4);
+    static_assert(primes.contains(13) && !primes.contains(9), "not a frozen set of the primes");
+    static_assert(*primes.lower_bound(8) == 11, "invalid lower bound");
+    demo_out() << "First prime from 14 : " << *primes.lower_bound(14) << '\n';
+    // A lookup table without std::map: no nodes, no allocation at startup
+    constexpr auto reasons = make_frozen_map(make_array(
+        make_pair(404, "Not Found"), make_pair(200, "OK"), make_pair(301, "Moved Permanently"),
+        make_pair(500, "Internal Server Error"), make_pair(403, "Forbidden")));
+    static_assert(reasons.size() == 5 && reasons.contains(301), "not a frozen map");
+    for(const auto& entry : reasons)
+        demo_out() << "HTTP " << entry.first << " : " << entry.second << '\n';
+    demo_out() << "HTTP 403 : " << reasons.at(403) << '\n';
 
     // Compare strings at compile time
     constexpr const char* scale[] = {"do", "re", "mi", "fa", "sol", "la", "si"};
     constexpr int do_vs_re = cx_safestrcmp("do", "re");
     constexpr int sol_vs_solo = cx_safestrcmp("sol", "solo");
     constexpr int fa_vs_fa = cx_safestrcmp("fa", "fa");
-    cout << R"(safestrcmp("do", "re") = )" << do_vs_re << '\n';
-    cout << R"(safestrcmp("sol", "solo") = )" << sol_vs_solo << '\n';
-    cout << R"(safestrcmp("fa", "fa") = )" << fa_vs_fa << '\n';
+    demo_out() << R"(safestrcmp("do", "re") = )" << do_vs_re << '\n';
+    demo_out() << R"(safestrcmp("sol", "solo") = )" << sol_vs_solo << '\n';
+    demo_out() << R"(safestrcmp("fa", "fa") = )" << fa_vs_fa << '\n';
     // constexpr int re_vs_mi = cx_safestrcmp(scale[1], scale[2]);
-    // cout << "strcmp(re, mi) = " << re_vs_mi << '\n';
+    // demo_out() << "strcmp(re, mi) = " << re_vs_mi << '\n';
     // Note: Does not compile because scale[i] is decayed 
     // from a const char (&)[N] to a const char*& 
     // so the template cannot deduce N1 and N2
 
     constexpr int do_vs_sol = cx_strcmp(scale[0], scale[4]);
-    cout << "strcmp(do, sol) = " << do_vs_sol << '\n';
+    demo_out() << "strcmp(do, sol) = " << do_vs_sol << '\n';
     constexpr int sol_vs_si = cx_strcmp(scale[4], scale[5]);
-    cout << "strcmp(sol, si) = " << sol_vs_si << '\n';
+    demo_out() << "strcmp(sol, si) = " << sol_vs_si << '\n';
     // constexpr int sol_vs_null = cx_strcmp(scale[4], 0);
     // Does not compile : 'dereferencing null pointer' ==> OK
-    // cout << cx_strcmp("sol", 0) << '\n';
+    // demo_out() << cx_strcmp("sol", 0) << '\n';
     // Does compile ! And crashes at runtime
 
-    // Search string in a list at compile time
-    constexpr bool is_sol_in_scale = is_one_of("sol", scale);
-    constexpr bool is_solo_in_scale = is_one_of("solo", scale);
-    cout << "Is sol in scale ? " <<  is_sol_in_scale << '\n';
-    cout << "Is solo in scale ? " <<  is_solo_in_scale << '\n';
+    // Search string in a list at compile time, through a perfect hash table
+    // of the list built at compile time too (perfect_hash.h)
+    constexpr auto scale_set = make_perfect_hash_set(scale);
+    constexpr bool is_sol_in_scale = scale_set.contains("sol");
+    constexpr bool is_solo_in_scale = scale_set.contains("solo");
+    demo_out() << "Is sol in scale ? " <<  is_sol_in_scale << '\n';
+    demo_out() << "Is solo in scale ? " <<  is_solo_in_scale << '\n';
+    static_assert(scale_set.index_of("la") == 5, "la is the 6th note");
+    // Same lookup at run time: one hash, one slot, one string compare
+    const string note = "fa";
+    demo_out() << "Index of fa in scale : " << scale_set.index_of(note.c_str(), note.size()) << '\n';
 
     constexpr auto quote = cx_string("The state of law is equal for all people. "
         "It cannot depend on electoral politics. - Baltasar Garzon");
-    cout << "Quote content : " << quote.c_str() << '\n';    
-    cout << "Quote size : " << quote.size() << "; verification : " 
-        << cx_strlen(quote.c_str()) << '\n';
+    demo_out() << "Quote content : " << quote.c_str() << '\n';    
+    demo_out() << "Quote size : " << quote.size() << "; verification : " 
+        << fast_strlen(quote.c_str()) << '\n';
     // constexpr char at_99 = quote[99];
     // breaks at compile time
     constexpr char at_98 = quote[quote.size()-1];
-    cout << "Quote content last character : " << at_98 << '\n';
+    demo_out() << "Quote content last character : " << at_98 << '\n';
 
     
     // Note: In C++14, also in <experimental/array> we have std::experimental::to_array
@@ -332,5 +428,5 @@ void demo_constexpr()
 
     // Note: for more constexpr see https://github.com/elbeno/constexpr
 
-    cout << "End of constexpr demo" << endl;
+    demo_out() << "End of constexpr demo" << endl;
 }
@@ -1,9 +1,46 @@
 #ifndef _CONSTEXPR_H_
 #define _CONSTEXPR_H_
 
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include "lookup_tables.h"
+
 // Use of strongly-typed (aka scoped) enums
 // Differences with standard enums
 void demo_constexpr();
 
+// Computes greatest common divisor recursively
+constexpr unsigned int gcd(unsigned int a, unsigned int b)
+{
+    return a ==0 || b==0 ? 0 : (
+        a == b ? a : (a < b ? gcd(a, b-a) : gcd(a - b, b))
+    );
+}
+
+// Recursive integer square root recursive helper
+#define MID ((lo + hi + 1) / 2)
+constexpr uint64_t sqrt_helper(uint64_t x, uint64_t lo, uint64_t hi)
+{
+  return lo == hi ? lo : ((x / MID < MID)
+      ? sqrt_helper(x, lo, MID - 1) : sqrt_helper(x, MID, hi));
+}
+#undef MID
+
+// Compute integer square root: one load from a table of the small values,
+// binary search otherwise
+constexpr uint64_t csqrt(uint64_t x)
+{
+  return x < LookupTables::isqrt_size ? table_isqrt(x) : sqrt_helper(x, 0, x / 2 + 1);
+}
+
+// Constexpr version of strlen 
+constexpr size_t cx_strlen(const char* str)
+{
+    return (str == nullptr || *str == '\0') ? 0 : 1 + cx_strlen(str + 1);
+}
+
+// Run-time counterpart of cx_strlen, with the fastest instructions of the host
+size_t fast_strlen(const char* str);
+
 
 #endif /* _CONSTEXPR_H_ */
@@ -0,0 +1,117 @@
+#include "cpu_features.h"
+#include <cstdlib> // for getenv
+#include <mutex>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+using namespace std;
+
+const char* to_string(CpuLevel level)
+{
+    switch(level)
+    {
+    case CpuLevel::Scalar: return "scalar";
+    case CpuLevel::SSE42: return "sse42";
+    case CpuLevel::AVX2: return "avx2";
+    case CpuLevel::AVX512: return "avx512";
+    default: return "unknown";
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Register state the OS saves on context switches (XCR0)
+static unsigned long long read_xcr0()
+{
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+}
+#endif
+
+static CpuFeatures detect_features()
+{
+    CpuFeatures f;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return f;
+    f.sse42 = ecx & bit_SSE4_2;
+    f.popcnt = ecx & bit_POPCNT;
+    bool osxsave = ecx & bit_OSXSAVE;
+    unsigned long long xcr0 = osxsave ? read_xcr0() : 0;
+    bool ymm_saved = (xcr0 & 0x6) == 0x6;    // SSE and AVX state
+    bool zmm_saved = (xcr0 & 0xe6) == 0xe6;  // and opmask, ZMM0-15 upper halves, ZMM16-31
+    if(__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        f.avx2 = ymm_saved && (ebx & bit_AVX2);
+        f.bmi2 = ebx & bit_BMI2;
+        f.avx512f = zmm_saved && (ebx & bit_AVX512F);
+        f.avx512bw = zmm_saved && (ebx & bit_AVX512BW);
+        f.avx512vl = zmm_saved && (ebx & bit_AVX512VL);
+    }
+#endif
+    return f;
+}
+
+const CpuFeatures& cpu_features()
+{
+    static const CpuFeatures features = detect_features();
+    return features;
+}
+
+static CpuLevel detect_level()
+{
+    const CpuFeatures& f = cpu_features();
+    CpuLevel level = CpuLevel::Scalar;
+    if(f.sse42 && f.popcnt)
+    {
+        level = CpuLevel::SSE42;
+        if(f.avx2 && f.bmi2)
+        {
+            level = CpuLevel::AVX2;
+            if(f.avx512f && f.avx512bw && f.avx512vl)
+                level = CpuLevel::AVX512;
+        }
+    }
+    if(const char* forced = getenv("DEMO_CPU_LEVEL"))
+    {
+        for(unsigned int i = 0; i < nCpuLevels; ++i)
+        {
+            if(string(forced) == to_string(CpuLevel(i)) && i < static_cast<unsigned int>(level))
+                level = CpuLevel(i);
+        }
+    }
+    return level;
+}
+
+CpuLevel cpu_level()
+{
+    static const CpuLevel level = detect_level();
+    return level;
+}
+
+// Function-local, since the kernels register from static initializers
+static mutex& bindings_mutex()
+{
+    static mutex m;
+    return m;
+}
+
+static vector<KernelBinding>& bindings()
+{
+    static vector<KernelBinding> b;
+    return b;
+}
+
+void register_kernel_binding(const char* name, CpuLevel level)
+{
+    lock_guard<mutex> lock(bindings_mutex());
+    bindings().push_back(KernelBinding{name, level});
+}
+
+vector<KernelBinding> kernel_bindings()
+{
+    lock_guard<mutex> lock(bindings_mutex());
+    return bindings();
+}
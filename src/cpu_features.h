@@ -0,0 +1,110 @@
+#ifndef _CPU_FEATURES_H_
+#define _CPU_FEATURES_H_
+
+#include <string>
+#include <utility> // for std::declval
+#include <vector>
+
+// Runtime selection of the instruction set used by the kernels.
+// The program is built for the baseline x86-64 (SSE2); the kernels
+// compile their faster variants with __attribute__((target("..."))) and
+// Kernel binds the best one the host supports when the program starts.
+// A variant that needs nothing beyond SSE2 is bound at the SSE42 level,
+// the lowest above the scalar baseline.
+
+// The variants are x86 code, compiled where HAS_X86_KERNELS is defined;
+// elsewhere X86_KERNEL(variant) is nullptr and Kernel binds the scalar one
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_KERNELS
+#define X86_KERNEL(variant) variant
+#else
+#define X86_KERNEL(variant) nullptr
+#endif
+
+// The AVX-512 intrinsics of GCC 12 start from deliberately undefined
+// registers, which -O2 reports as uninitialized once they are inlined:
+// the AVX-512 variants go between these two
+#define BEGIN_AVX512_KERNELS \
+    _Pragma("GCC diagnostic push") \
+    _Pragma("GCC diagnostic ignored \"-Wuninitialized\"") \
+    _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#define END_AVX512_KERNELS _Pragma("GCC diagnostic pop")
+
+/// Instruction set levels, each including the previous ones
+enum class CpuLevel : unsigned int
+{
+    Scalar = 0, ///< baseline: no assumption beyond the build flags
+    SSE42,      ///< SSE4.2 and POPCNT
+    AVX2,       ///< AVX2 and BMI2
+    AVX512,     ///< AVX-512 F, BW and VL
+    NumLevels // must be the last element
+};
+
+constexpr unsigned int nCpuLevels = static_cast<unsigned int>(CpuLevel::NumLevels);
+
+/// Name of the level, as accepted by DEMO_CPU_LEVEL, e.g. "avx2"
+const char* to_string(CpuLevel level);
+
+/// Features reported by cpuid, and enabled by the OS for the vector registers
+struct CpuFeatures
+{
+    bool sse42 = false;
+    bool popcnt = false;
+    bool avx2 = false;
+    bool bmi2 = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+    bool avx512vl = false;
+};
+
+/// Detected on first call
+const CpuFeatures& cpu_features();
+
+/// Highest level the host supports, lowered to the one named by the
+/// environment variable DEMO_CPU_LEVEL if it is set (to test the other
+/// variants). A level above the host's is ignored, an unknown name too.
+CpuLevel cpu_level();
+
+/// Kernel and the level of the variant bound to it
+struct KernelBinding
+{
+    std::string name;
+    CpuLevel level;
+};
+
+/// Bindings of all the kernels so far, in the order they were bound
+std::vector<KernelBinding> kernel_bindings();
+
+void register_kernel_binding(const char* name, CpuLevel level);
+
+/// Kernel with one variant per level; only the scalar one is required,
+/// the others may be nullptr. Define it as a static: the best variant
+/// for cpu_level() is bound when the program starts. Like any static, it
+/// cannot be called from the initializer of a static of another file.
+template<typename Fn>
+class Kernel
+{
+public:
+    Kernel(const char* name, Fn scalar, Fn sse42, Fn avx2, Fn avx512)
+    :_variants{scalar, sse42, avx2, avx512}, _selected(scalar)
+    {
+        unsigned int level = static_cast<unsigned int>(cpu_level());
+        while(!_variants[level])
+            --level;
+        _selected = _variants[level];
+        register_kernel_binding(name, CpuLevel(level));
+    }
+
+    template<typename... Args>
+    auto operator()(Args... args) const -> decltype(std::declval<Fn>()(args...))
+    {
+        return _selected(args...);
+    }
+
+private:
+    Fn _variants[nCpuLevels];
+    Fn _selected;
+};
+
+#endif /* _CPU_FEATURES_H_ */
@@ -1,4 +1,5 @@
 #include "default_and_deleted_functions.h"
+#include "demo_output.h"
 #include <iostream>
 #include <string>
 
@@ -57,12 +58,12 @@ public:
     }
     void print()
     {
-        cout << to_string(_type) << " at (" << _locX << ", " << _locY << ")" << endl;
-        cout << "Passenger frequencies: " << endl;
+        demo_out() << to_string(_type) << " at (" << _locX << ", " << _locY << ")\n";
+        demo_out() << "Passenger frequencies: \n";
         for (unsigned int i = 0; i < nStopTypes; ++i)
         {
-            cout << "- to " << to_string(static_cast<MetroStopType>(i))
-                << " : " << _passengerFrequenciesHz[i] << " Hz" << endl;
+            demo_out() << "- to " << to_string(static_cast<MetroStopType>(i))
+                << " : " << _passengerFrequenciesHz[i] << " Hz\n";
         }
 
     }
@@ -78,12 +79,12 @@ void call_with_true_double_only(T) = delete;
 
 // also define for const double, double&, etc. as needed.
 void call_with_true_double_only(double param) {
-    cout << "Called with true double parameter value " << param << endl;
+    demo_out() << "Called with true double parameter value " << param << endl;
 }
 
 void demo_default_and_deleted_functions()
 {
-    cout << endl << "***** Default and deleted functions ******" << endl;
+    demo_out() << endl << "***** Default and deleted functions ******" << endl;
     // Default constructed
     MetroStop cirStop1;
     cirStop1.print();
@@ -0,0 +1,308 @@
+#include "demo_output.h"
+#include <algorithm> // for min
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring> // for memcpy
+#include <iostream>
+#include <memory> // for unique_ptr
+#include <mutex>
+#include <stdexcept> // for invalid_argument
+#include <thread>
+#include <vector>
+#include <unistd.h> // for write, STDOUT_FILENO
+
+using namespace std;
+
+// Redirection of the calling thread; nullptr means the sink
+static thread_local ostream* current_output = nullptr;
+
+ostream& demo_out()
+{
+    return current_output ? *current_output : sink_out();
+}
+
+ScopedDemoOutput::ScopedDemoOutput(ostream& target)
+:_previous(current_output)
+{
+    current_output = &target;
+}
+
+ScopedDemoOutput::~ScopedDemoOutput()
+{
+    current_output = _previous;
+}
+
+// Writes the whole range to the file descriptor, resuming after
+// signals and partial writes. Errors are dropped: there is nowhere
+// left to report them.
+static void write_all(int fd, const char* data, size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t written = ::write(fd, data, size);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// Stream buffer of a sink other than the console
+class SinkBuffer : public streambuf
+{
+public:
+    // Writes out everything received so far; returns once it is written
+    virtual void drain() {}
+};
+
+class NullSink : public SinkBuffer
+{
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// Fully buffered: std::endl (sync) does not write, only a full buffer does
+class BufferedSink : public SinkBuffer
+{
+public:
+    BufferedSink()
+    :_buffer(64 * 1024)
+    {
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+    }
+    ~BufferedSink() { drain(); }
+
+    void drain() override
+    {
+        write_all(STDOUT_FILENO, pbase(), pptr() - pbase());
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        drain();
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+    int sync() override { return 0; }
+
+private:
+    vector<char> _buffer;
+};
+
+// Single-producer single-consumer ring buffer, drained to standard output
+// by a background thread. The producer (the thread writing to the sink)
+// fills a small put area, which sync and overflow copy into the ring:
+// std::endl costs a memcpy and an atomic store, no system call.
+// When the ring is full the producer waits for the writer, so no output is lost.
+class AsyncSink : public SinkBuffer
+{
+public:
+    AsyncSink()
+    :_ring(ring_size), _head(0), _tail(0), _writer_idle(false), _stopping(false)
+    {
+        setp(_chunk, _chunk + chunk_size);
+        _writer = thread(&AsyncSink::write_loop, this);
+    }
+
+    ~AsyncSink()
+    {
+        publish();
+        _stopping.store(true, memory_order_release);
+        wake_writer();
+        _writer.join();
+    }
+
+    void drain() override
+    {
+        publish();
+        size_t head = _head.load(memory_order_relaxed);
+        while(_tail.load(memory_order_acquire) != head)
+        {
+            wake_writer();
+            this_thread::yield();
+        }
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        publish();
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        publish();
+        return 0;
+    }
+
+private:
+    static const size_t ring_size = 1 << 20; // a power of two
+    static const size_t chunk_size = 4096;
+
+    // Moves the put area into the ring
+    void publish()
+    {
+        const char* data = pbase();
+        size_t size = pptr() - pbase();
+        size_t head = _head.load(memory_order_relaxed);
+        while(size > 0)
+        {
+            size_t room = ring_size - (head - _tail.load(memory_order_acquire));
+            if(room == 0)
+            {
+                wake_writer();
+                this_thread::yield();
+                continue;
+            }
+            // Up to the end of the ring; the rest wraps around next turn
+            size_t offset = head & (ring_size - 1);
+            size_t n = min(min(size, room), ring_size - offset);
+            memcpy(&_ring[offset], data, n);
+            data += n;
+            size -= n;
+            head += n;
+            _head.store(head, memory_order_release);
+        }
+        setp(_chunk, _chunk + chunk_size);
+        // The writer polls; only wake it early when the ring fills up
+        if(head - _tail.load(memory_order_relaxed) > ring_size / 4)
+            wake_writer();
+    }
+
+    void wake_writer()
+    {
+        if(_writer_idle.load())
+        {
+            lock_guard<mutex> lock(_wake_mutex);
+            _wake.notify_one();
+        }
+    }
+
+    void write_loop()
+    {
+        for(;;)
+        {
+            size_t tail = _tail.load(memory_order_relaxed);
+            size_t head = _head.load(memory_order_acquire);
+            if(head != tail)
+            {
+                size_t offset = tail & (ring_size - 1);
+                size_t n = min(head - tail, ring_size - offset);
+                write_all(STDOUT_FILENO, &_ring[offset], n);
+                _tail.store(tail + n, memory_order_release);
+                continue;
+            }
+            // The last bytes are published before _stopping is set
+            if(_stopping.load(memory_order_acquire))
+            {
+                if(_head.load(memory_order_acquire) == tail)
+                    return;
+                continue;
+            }
+            unique_lock<mutex> lock(_wake_mutex);
+            _writer_idle.store(true);
+            _wake.wait_for(lock, chrono::milliseconds(1));
+            _writer_idle.store(false);
+        }
+    }
+
+    vector<char> _ring;
+    // Bytes published and bytes written since the start; they only grow.
+    // The put area sits between them, so that they are on distinct cache lines.
+    atomic<size_t> _head;
+    char _chunk[chunk_size];
+    atomic<size_t> _tail;
+    atomic<bool> _writer_idle;
+    atomic<bool> _stopping;
+    mutex _wake_mutex;
+    condition_variable _wake;
+    thread _writer;
+};
+
+static OutputSink current_sink = OutputSink::Console;
+static unique_ptr<SinkBuffer> sink_buffer;
+static unique_ptr<ostream> sink_stream;
+
+OutputSink parse_output_sink(const string& name)
+{
+    if(name == "console")
+        return OutputSink::Console;
+    if(name == "buffered")
+        return OutputSink::Buffered;
+    if(name == "async")
+        return OutputSink::Async;
+    if(name == "null")
+        return OutputSink::Null;
+    throw invalid_argument("--sink: expected console, buffered, async or null, got '" + name + "'");
+}
+
+void set_output_sink(OutputSink sink)
+{
+    flush_output_sink();
+    // Stops the writer thread of the async sink
+    sink_stream.reset();
+    sink_buffer.reset();
+    current_sink = sink;
+    switch(sink)
+    {
+    case OutputSink::Console: break;
+    case OutputSink::Buffered: sink_buffer.reset(new BufferedSink); break;
+    case OutputSink::Async: sink_buffer.reset(new AsyncSink); break;
+    case OutputSink::Null: sink_buffer.reset(new NullSink); break;
+    }
+    if(sink_buffer)
+        sink_stream.reset(new ostream(sink_buffer.get()));
+    // A prompt must be visible before reading the answer
+    cin.tie(&sink_out());
+}
+
+OutputSink output_sink()
+{
+    return current_sink;
+}
+
+ostream& sink_out()
+{
+    return sink_stream ? *sink_stream : cout;
+}
+
+void flush_output_sink()
+{
+    // Also orders what was written to std::cout before the sink
+    cout.flush();
+    if(sink_stream)
+    {
+        sink_stream->flush();
+        sink_buffer->drain();
+    }
+}
+
+ScopedOutputSink::ScopedOutputSink(OutputSink sink)
+:_previous(current_sink)
+{
+    set_output_sink(sink);
+}
+
+ScopedOutputSink::~ScopedOutputSink()
+{
+    set_output_sink(_previous);
+}
@@ -0,0 +1,75 @@
+#ifndef _DEMO_OUTPUT_H_
+#define _DEMO_OUTPUT_H_
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+/// Stream the demos print to: the output sink (std::cout by default),
+/// unless the calling thread redirected it with a ScopedDemoOutput.
+/// Each thread has its own redirection, so that demos running concurrently
+/// neither interleave their output nor share formatting flags (hex, precision...).
+std::ostream& demo_out();
+
+/// Redirects demo_out() of the calling thread to the given stream
+/// for the lifetime of the object. Redirections can be nested.
+class ScopedDemoOutput
+{
+public:
+    explicit ScopedDemoOutput(std::ostream& target);
+    ~ScopedDemoOutput();
+    ScopedDemoOutput(const ScopedDemoOutput&) = delete;
+    ScopedDemoOutput& operator=(const ScopedDemoOutput&) = delete;
+private:
+    std::ostream* _previous;
+};
+
+/// Where demo_out() ends up when not redirected
+enum class OutputSink
+{
+    Console,    ///< std::cout: each std::endl is a write to the terminal (the default)
+    Buffered,   ///< standard output, written only when a 64 KiB buffer is full
+    Async,      ///< lock-free ring buffer, written to standard output by a background thread
+    Null        ///< discarded, to measure the demos without any I/O
+};
+
+/// Parses "console", "buffered", "async" or "null". Throws std::invalid_argument.
+OutputSink parse_output_sink(const std::string& name);
+
+/// Flushes the current sink, then switches to the given one. Call it while
+/// no demo runs. The sink has a single writer at a time, which keeps the
+/// output in order: the thread running the demos, or the one printing
+/// their captured output.
+void set_output_sink(OutputSink sink);
+OutputSink output_sink();
+
+/// Stream of the sink: demo_out() without redirection
+std::ostream& sink_out();
+
+/// Returns once everything written to the sink reached standard output.
+/// With the Buffered and Async sinks std::endl does not; call it before
+/// writing to standard output by other means.
+void flush_output_sink();
+
+/// Switches the sink for the lifetime of the object, then restores the previous one
+class ScopedOutputSink
+{
+public:
+    explicit ScopedOutputSink(OutputSink sink);
+    ~ScopedOutputSink();
+    ScopedOutputSink(const ScopedOutputSink&) = delete;
+    ScopedOutputSink& operator=(const ScopedOutputSink&) = delete;
+private:
+    OutputSink _previous;
+};
+
+/// Stream buffer that swallows everything written to it
+/// Used to measure the demos without the cost of the terminal
+class NullBuffer : public std::streambuf
+{
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+#endif /* _DEMO_OUTPUT_H_ */
@@ -0,0 +1,680 @@
+#include "demo_runner.h"
+#include "alloc_tracker.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+#include "latency.h"
+#include "perf_counters.h"
+#include "profiler.h"
+#include "stats_counters.h"
+#include "trace.h"
+#include <algorithm> // for std::sort, std::find_if, std::min
+#include <atomic>
+#include <chrono> // for steady_clock
+#include <condition_variable>
+#include <cstdint> // for uint64_t
+#include <cstdlib> // for EXIT_SUCCESS
+#include <ctime> // for clock_gettime
+#include <fstream>
+#include <map>
+#include <exception> // for exception_ptr
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept> // for invalid_argument, runtime_error
+#include <thread>
+
+using namespace std;
+
+// Wall-clock time, in nanoseconds since an arbitrary origin
+static uint64_t wall_now_ns()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU time consumed so far by the calling thread, in nanoseconds
+static uint64_t cpu_now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
+
+// Summary of the samples of one measure
+struct SampleStats
+{
+    uint64_t min = 0;
+    uint64_t median = 0;
+    uint64_t mean = 0;
+    uint64_t max = 0;
+};
+
+static SampleStats summarize(vector<uint64_t> samples)
+{
+    SampleStats stats;
+    if(samples.empty())
+        return stats;
+    sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = n % 2 ? samples[n/2] : (samples[n/2 - 1] + samples[n/2]) / 2;
+    uint64_t sum = 0;
+    for(auto s : samples)
+        sum += s;
+    stats.mean = sum / n;
+    return stats;
+}
+
+// Timings of all the timed runs of one demo
+struct DemoResult
+{
+    string name;
+    vector<uint64_t> wall_ns;
+    vector<uint64_t> cpu_ns;
+    PerfCounts perf;  ///< sum over the timed runs
+    uint64_t allocations = 0;       ///< sum over the timed runs
+    uint64_t allocated_bytes = 0;   ///< sum over the timed runs
+    int64_t peak_live_bytes = 0;    ///< highest over the timed runs
+    int64_t leaked_bytes = 0;       ///< sum over the timed runs
+    vector<AllocSite> alloc_sites;
+    map<string, uint64_t> counters; ///< sum over the timed runs, non-zero only
+};
+
+// Everything the report shows
+struct BatchReport
+{
+    unsigned int repeat = 0;
+    unsigned int warmup = 0;
+    unsigned int jobs = 0;
+    uint64_t total_wall_ns = 0;
+    bool perf = false;  ///< the counters were enabled
+    bool alloc = false; ///< the allocation tracker was enabled
+    bool latency = false; ///< the latency probes were enabled
+    bool counters = false; ///< the statistics counters are reported
+    vector<DemoResult> demos;
+    vector<PerfRegionTotals> regions;
+    vector<LatencySummary> latencies;
+    vector<StatValue> counter_totals;
+};
+
+static unsigned int parse_count(const string& option, const char* value)
+{
+    istringstream in(value);
+    unsigned int count = 0;
+    if(!(in >> count) || !in.eof())
+        throw invalid_argument(option + ": expected a non-negative integer, got '" + value + "'");
+    return count;
+}
+
+RunnerOptions parse_runner_options(int argc, char* argv[])
+{
+    RunnerOptions options;
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        // Options taking a value read it from the next argument
+        auto value = [&]() -> const char* {
+            if(i + 1 >= argc)
+                throw invalid_argument(arg + ": missing value");
+            return argv[++i];
+        };
+        if(arg == "--batch")
+            ; // implied by the presence of any argument
+        else if(arg == "--repeat")
+            options.repeat = parse_count(arg, value());
+        else if(arg == "--warmup")
+            options.warmup = parse_count(arg, value());
+        else if(arg == "--report")
+            options.report_format = value();
+        else if(arg == "--output")
+            options.report_file = value();
+        else if(arg == "--jobs")
+            options.jobs = parse_count(arg, value());
+        else if(arg == "--perf")
+            options.perf = true;
+        else if(arg == "--counters")
+            options.counters = true;
+        else if(arg == "--latency")
+            options.latency = true;
+        else if(arg == "--alloc")
+            options.alloc = true;
+        else if(arg == "--alloc-sites")
+            options.alloc = options.alloc_sites = true;
+        else if(arg == "--trace")
+            options.trace_file = value();
+        else if(arg == "--profile")
+            options.profile_dir = value();
+        else if(arg == "--profile-hz")
+            options.profile_hz = parse_count(arg, value());
+        else if(arg == "--sink")
+            options.sink = parse_output_sink(value());
+        else if(arg == "--quiet")
+            options.sink = OutputSink::Null;
+        else if(arg == "--list")
+            options.list = true;
+        else if(arg == "--help" || arg == "-h")
+            options.help = true;
+        else if(arg.compare(0, 1, "-") == 0)
+            throw invalid_argument("unknown option " + arg);
+        else
+            options.selected.push_back(arg);
+    }
+    if(options.repeat == 0)
+        throw invalid_argument("--repeat: at least one timed run is needed");
+    if(options.report_format != "json" && options.report_format != "csv")
+        throw invalid_argument("--report: expected json or csv, got '" + options.report_format + "'");
+    return options;
+}
+
+void print_usage(ostream& out, const char* program)
+{
+    out << "Usage: " << program << " [options] [demo ...]\n"
+        << "Without arguments, runs all the demos interactively.\n"
+        << "With arguments, runs the named demos (default: all) without prompting\n"
+        << "and reports the wall-clock and CPU time of each one.\n"
+        << "  --batch          run all the demos without prompting\n"
+        << "  --repeat N       number of timed runs of each demo (default 1)\n"
+        << "  --warmup N       number of untimed runs before timing (default 0)\n"
+        << "  --report FORMAT  json or csv (default json)\n"
+        << "  --output FILE    write the report to FILE instead of standard output\n"
+        << "  --jobs N         run up to N demos at the same time (0: one per core;\n"
+        << "                   default 1); the output is still printed in order\n"
+        << "  --perf           also report hardware counters (cycles, instructions,\n"
+        << "                   cache and branch misses, context switches), per demo\n"
+        << "                   and per region marked with PERF_REGION\n"
+        << "  --counters       also report the statistics counters (STAT_ADD) that each\n"
+        << "                   demo incremented, per run and per second (JSON only)\n"
+        << "  --latency        also report the distribution of the latency of the calls\n"
+        << "                   marked with LATENCY_PROBE (JSON report only)\n"
+        << "  --alloc          also report the heap allocations (count, bytes,\n"
+        << "                   peak and leaked live bytes) of each demo\n"
+        << "  --alloc-sites    --alloc, plus the call sites allocating the most\n"
+        << "  --trace FILE     write a timeline of the demos and of the spans marked\n"
+        << "                   with TRACE_SPAN to FILE (Chrome trace JSON, for\n"
+        << "                   chrome://tracing or ui.perfetto.dev)\n"
+        << "  --profile DIR    sample the call stacks and write them to DIR/<demo>.folded\n"
+        << "                   for flame graph tools; use --repeat for short demos\n"
+        << "  --profile-hz N   samples per second of CPU time (default 997)\n"
+        << "  --sink SINK      where the demos print: console (default), buffered\n"
+        << "                   (64 KiB buffer), async (ring buffer written by a\n"
+        << "                   background thread) or null (discarded)\n"
+        << "  --quiet          --sink null\n"
+        << "  --list           list the demo names\n"
+        << "  --help           show this help\n"
+        << "Note: the casts demo reads a number from the standard input.\n";
+}
+
+// Writes the counters as a JSON object, per run; null for the unavailable events
+static void write_perf_json(ostream& out, const PerfCounts& counts, uint64_t runs)
+{
+    out << "{";
+    for(unsigned int i = 0; i < nPerfEvents; ++i)
+    {
+        out << (i ? ", " : "") << "\"" << to_string(PerfEvent(i)) << "\": ";
+        if(counts.available[i])
+            out << counts.values[i] / runs;
+        else
+            out << "null";
+    }
+    out << ", \"ipc\": " << counts.ipc() << "}";
+}
+
+// Quotes the string for JSON, escaping the characters that need it
+static string json_string(const string& str)
+{
+    string quoted = "\"";
+    for(char c : str)
+    {
+        if(c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Writes the allocations of the demo as JSON members: per run,
+// except the call sites which are totalled over the timed runs
+static void write_alloc_json(ostream& out, const DemoResult& r)
+{
+    uint64_t runs = r.wall_ns.size();
+    out << "\"alloc\": {\"allocations\": " << r.allocations / runs
+        << ", \"bytes\": " << r.allocated_bytes / runs
+        << ", \"peak_live_bytes\": " << r.peak_live_bytes
+        << ", \"leaked_bytes\": " << r.leaked_bytes / int64_t(runs) << "}";
+    if(r.alloc_sites.empty())
+        return;
+    out << ", \"alloc_sites\": [";
+    for(size_t i = 0; i < r.alloc_sites.size(); ++i)
+    {
+        const AllocSite& site = r.alloc_sites[i];
+        out << (i ? ", " : "") << "{\"function\": " << json_string(site.function)
+            << ", \"via\": " << json_string(site.via)
+            << ", \"total_allocations\": " << site.allocations
+            << ", \"total_bytes\": " << site.bytes << "}";
+    }
+    out << "]";
+}
+
+// Writes the counters the demo incremented as a JSON member: per run,
+// and per second of wall-clock time
+static void write_counters_json(ostream& out, const DemoResult& r)
+{
+    uint64_t runs = r.wall_ns.size();
+    uint64_t wall_ns = 0;
+    for(auto t : r.wall_ns)
+        wall_ns += t;
+    out << "\"counters\": {";
+    bool first = true;
+    for(const auto& c : r.counters)
+    {
+        out << (first ? "" : ", ") << json_string(c.first) << ": {\"per_run\": " << c.second / runs
+            << ", \"per_second\": " << uint64_t(wall_ns ? c.second * 1e9 / wall_ns : 0) << "}";
+        first = false;
+    }
+    out << "}";
+}
+
+static void write_json(ostream& out, const BatchReport& report)
+{
+    auto write_stats = [&out](const char* key, const vector<uint64_t>& samples) {
+        SampleStats s = summarize(samples);
+        out << "\"" << key << "\": {\"min\": " << s.min << ", \"median\": " << s.median
+            << ", \"mean\": " << s.mean << ", \"max\": " << s.max << "}";
+    };
+    out << "{\n  \"repeat\": " << report.repeat
+        << ",\n  \"warmup\": " << report.warmup
+        << ",\n  \"jobs\": " << report.jobs
+        << ",\n  \"total_wall_ns\": " << report.total_wall_ns
+        << ",\n  \"cpu_level\": \"" << to_string(cpu_level()) << "\"";
+    // Variant bound to each kernel, which may be below cpu_level if it has no such variant
+    out << ",\n  \"kernels\": {";
+    vector<KernelBinding> kernels = kernel_bindings();
+    for(size_t i = 0; i < kernels.size(); ++i)
+        out << (i ? ", " : "") << json_string(kernels[i].name) << ": \"" << to_string(kernels[i].level) << "\"";
+    out << "}"
+        << ",\n  \"demos\": [";
+    for(size_t i = 0; i < report.demos.size(); ++i)
+    {
+        const DemoResult& r = report.demos[i];
+        out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\", \"runs\": "
+            << r.wall_ns.size() << ", ";
+        write_stats("wall_ns", r.wall_ns);
+        out << ", ";
+        write_stats("cpu_ns", r.cpu_ns);
+        if(report.perf)
+        {
+            out << ", \"perf\": ";
+            write_perf_json(out, r.perf, r.wall_ns.size());
+        }
+        if(report.alloc)
+        {
+            out << ", ";
+            write_alloc_json(out, r);
+        }
+        if(report.counters)
+        {
+            out << ", ";
+            write_counters_json(out, r);
+        }
+        out << "}";
+    }
+    out << "\n  ]";
+    if(report.perf)
+    {
+        out << ",\n  \"regions\": [";
+        for(size_t i = 0; i < report.regions.size(); ++i)
+        {
+            const PerfRegionTotals& r = report.regions[i];
+            out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\", \"calls\": "
+                << r.calls << ", \"perf\": ";
+            write_perf_json(out, r.counts, r.calls);
+            out << "}";
+        }
+        out << "\n  ]";
+    }
+    if(report.counters)
+    {
+        out << ",\n  \"counters\": {";
+        for(size_t i = 0; i < report.counter_totals.size(); ++i)
+        {
+            const StatValue& c = report.counter_totals[i];
+            out << (i ? "," : "") << "\n    " << json_string(c.name) << ": " << c.value;
+        }
+        out << "\n  }";
+    }
+    if(report.latency)
+    {
+        // Rounded to the nanosecond; the histograms are exact within 3%
+        auto ns = [](double value) { return uint64_t(value + 0.5); };
+        out << ",\n  \"latency\": [";
+        for(size_t i = 0; i < report.latencies.size(); ++i)
+        {
+            const LatencySummary& l = report.latencies[i];
+            out << (i ? "," : "") << "\n    {\"name\": " << json_string(l.name)
+                << ", \"calls\": " << l.count << ", \"mean_ns\": " << ns(l.mean_ns)
+                << ", \"p50_ns\": " << ns(l.p50_ns) << ", \"p99_ns\": " << ns(l.p99_ns)
+                << ", \"p999_ns\": " << ns(l.p999_ns) << ", \"max_ns\": " << ns(l.max_ns) << "}";
+        }
+        out << "\n  ]";
+    }
+    out << "\n}\n";
+}
+
+static void write_csv(ostream& out, const BatchReport& report)
+{
+    out << "name,runs,wall_min_ns,wall_median_ns,wall_mean_ns,wall_max_ns,"
+           "cpu_min_ns,cpu_median_ns,cpu_mean_ns,cpu_max_ns";
+    if(report.perf)
+    {
+        for(unsigned int i = 0; i < nPerfEvents; ++i)
+            out << ',' << to_string(PerfEvent(i));
+        out << ",ipc";
+    }
+    if(report.alloc)
+        out << ",allocations,allocated_bytes,peak_live_bytes,leaked_bytes";
+    out << '\n';
+    for(const auto& r : report.demos)
+    {
+        SampleStats wall = summarize(r.wall_ns);
+        SampleStats cpu = summarize(r.cpu_ns);
+        out << r.name << ',' << r.wall_ns.size()
+            << ',' << wall.min << ',' << wall.median << ',' << wall.mean << ',' << wall.max
+            << ',' << cpu.min << ',' << cpu.median << ',' << cpu.mean << ',' << cpu.max;
+        if(report.perf)
+        {
+            // Per run; empty for the unavailable events
+            for(unsigned int i = 0; i < nPerfEvents; ++i)
+            {
+                out << ',';
+                if(r.perf.available[i])
+                    out << r.perf.values[i] / r.wall_ns.size();
+            }
+            out << ',' << r.perf.ipc();
+        }
+        if(report.alloc)
+        {
+            // Per run, except the peak
+            uint64_t runs = r.wall_ns.size();
+            out << ',' << r.allocations / runs << ',' << r.allocated_bytes / runs
+                << ',' << r.peak_live_bytes << ',' << r.leaked_bytes / int64_t(runs);
+        }
+        out << '\n';
+    }
+}
+
+// Runs the demo once with demo_out() in its default format state, so that
+// no demo depends on the flags (hex, precision...) left by the previous one
+// and the transcript does not depend on which demos shared a stream
+static void run_isolated(const Demo& demo)
+{
+    ostream& out = demo_out();
+    ios default_format(nullptr);
+    default_format.copyfmt(out);
+    {
+        TRACE_SPAN(demo.name);
+        ProfileScope profile_scope(demo.name);
+        AllocSiteTag site_tag(demo.name);
+        demo.run();
+    }
+    out.copyfmt(default_format);
+}
+
+// Adds the counts of the calling thread between the two snapshots.
+// Counters created in between are missing from the first one.
+static void add_counter_deltas(map<string, uint64_t>& sums,
+    const vector<StatValue>& start, const vector<StatValue>& end)
+{
+    map<string, uint64_t> before;
+    for(const auto& v : start)
+        before[v.name] = v.value;
+    for(const auto& v : end)
+    {
+        uint64_t delta = v.value - before[v.name];
+        if(delta)
+            sums[v.name] += delta;
+    }
+}
+
+// Warm-up and timed runs of one demo, printing to demo_out()
+static DemoResult run_demo(const Demo& demo, const RunnerOptions& options)
+{
+    DemoResult result;
+    result.name = demo.name;
+    for(unsigned int i = 0; i < options.warmup; ++i)
+        run_isolated(demo);
+    for(unsigned int i = 0; i < options.repeat; ++i)
+    {
+        // Out of the measured span: the snapshots allocate
+        vector<StatValue> counters_start;
+        if(options.counters)
+            counters_start = stat_counters_local();
+        alloc_reset_peak();
+        AllocStats alloc_start = alloc_stats_now();
+        PerfCounts perf_start = perf_counters_now();
+        uint64_t wall_start = wall_now_ns();
+        uint64_t cpu_start = cpu_now_ns();
+        run_isolated(demo);
+        uint64_t cpu_end = cpu_now_ns();
+        uint64_t wall_end = wall_now_ns();
+        PerfCounts perf_end = perf_counters_now();
+        AllocStats alloc_end = alloc_stats_now();
+        result.cpu_ns.push_back(cpu_end - cpu_start);
+        result.wall_ns.push_back(wall_end - wall_start);
+        result.perf += perf_end - perf_start;
+        result.allocations += alloc_end.allocations - alloc_start.allocations;
+        result.allocated_bytes += alloc_end.bytes - alloc_start.bytes;
+        result.peak_live_bytes = max(result.peak_live_bytes,
+            alloc_end.peak_live_bytes - alloc_start.live_bytes);
+        // Blocks allocated before the run and freed by it do not offset leaks
+        result.leaked_bytes += max(int64_t(0), alloc_end.live_bytes - alloc_start.live_bytes);
+        if(options.counters)
+            add_counter_deltas(result.counters, counters_start, stat_counters_local());
+    }
+    return result;
+}
+
+// Runs the demos one after the other on the calling thread
+static vector<DemoResult> run_serial(const vector<const Demo*>& selection,
+    const RunnerOptions& options)
+{
+    vector<DemoResult> results;
+    for(const Demo* demo : selection)
+        results.push_back(run_demo(*demo, options));
+    return results;
+}
+
+// One demo of the selection, as run by the worker pool
+struct DemoTask
+{
+    const Demo* demo = nullptr;
+    DemoResult result;
+    ostringstream output;
+    exception_ptr error;
+    bool done = false;
+};
+
+// Runs the demos on a pool of worker threads, each demo printing to
+// its own buffer. The calling thread prints the buffers to the sink in
+// selection order as soon as they are complete, so the transcript is the one
+// of a serial run. With the null sink the demos print to nothing instead.
+static vector<DemoResult> run_parallel(const vector<const Demo*>& selection,
+    const RunnerOptions& options, unsigned int jobs)
+{
+    vector<DemoTask> tasks(selection.size());
+    for(size_t i = 0; i < tasks.size(); ++i)
+        tasks[i].demo = selection[i];
+    atomic<size_t> next_task(0);
+    mutex done_mutex;
+    condition_variable done_signal;
+
+    auto worker = [&]() {
+        NullBuffer null_buffer;
+        ostream null_out(&null_buffer);
+        for(size_t i = next_task++; i < tasks.size(); i = next_task++)
+        {
+            DemoTask& task = tasks[i];
+            try
+            {
+                ScopedDemoOutput redirect(options.sink == OutputSink::Null ? null_out : task.output);
+                task.result = run_demo(*task.demo, options);
+            } catch(...) {
+                task.error = current_exception();
+            }
+            lock_guard<mutex> lock(done_mutex);
+            task.done = true;
+            done_signal.notify_all();
+        }
+    };
+    vector<thread> workers;
+    for(unsigned int i = 0; i < jobs; ++i)
+        workers.emplace_back(worker);
+
+    exception_ptr first_error;
+    vector<DemoResult> results;
+    for(auto& task : tasks)
+    {
+        {
+            unique_lock<mutex> lock(done_mutex);
+            done_signal.wait(lock, [&task] { return task.done; });
+        }
+        // Stop printing at the first failure, like a serial run would
+        if(first_error)
+            continue;
+        sink_out() << task.output.str();
+        if(task.error)
+            first_error = task.error;
+        else
+            results.push_back(move(task.result));
+    }
+    for(auto& w : workers)
+        w.join();
+    if(first_error)
+        rethrow_exception(first_error);
+    return results;
+}
+
+int run_batch(const Demo* demos, size_t count, const RunnerOptions& options)
+{
+    if(options.help)
+    {
+        print_usage(cout, "DemoCpp11");
+        return EXIT_SUCCESS;
+    }
+    if(options.list)
+    {
+        for(size_t i = 0; i < count; ++i)
+            cout << demos[i].name << '\n';
+        return EXIT_SUCCESS;
+    }
+
+    // Resolve the selection before running anything
+    vector<const Demo*> selection;
+    if(options.selected.empty())
+    {
+        for(size_t i = 0; i < count; ++i)
+            selection.push_back(&demos[i]);
+    }
+    for(const auto& name : options.selected)
+    {
+        const Demo* found = find_if(demos, demos + count,
+            [&name](const Demo& d) { return name == d.name; });
+        if(found == demos + count)
+            throw invalid_argument("unknown demo '" + name + "' (see --list)");
+        selection.push_back(found);
+    }
+
+    BatchReport report;
+    report.repeat = options.repeat;
+    report.warmup = options.warmup;
+    if(options.perf)
+    {
+        string reason;
+        report.perf = enable_perf_counters(reason);
+        if(!report.perf)
+            cerr << "Hardware counters unavailable, reporting timings only; " << reason << endl;
+        else if(!reason.empty())
+            cerr << "Some hardware counters are unavailable and reported as null; "
+                 << reason << endl;
+    }
+
+    // Fail before running anything if the trace cannot be written
+    ofstream trace_file;
+    if(!options.trace_file.empty())
+    {
+        trace_file.open(options.trace_file);
+        if(!trace_file)
+            throw runtime_error("cannot write trace to " + options.trace_file);
+        enable_tracing();
+    }
+
+    if(!options.profile_dir.empty())
+    {
+        string reason;
+        if(!start_profiler(options.profile_hz, reason))
+            throw runtime_error("cannot start the profiler: " + reason);
+    }
+
+    report.alloc = options.alloc;
+    if(options.alloc)
+        enable_alloc_tracking(options.alloc_sites);
+    report.latency = options.latency;
+    if(options.latency)
+        enable_latency_probes();
+
+    unsigned int jobs = options.jobs ? options.jobs : thread::hardware_concurrency();
+    report.jobs = max(1u, min<unsigned int>(jobs, selection.size()));
+    {
+        // Restored, hence flushed, before the report is written
+        ScopedOutputSink sink(options.sink);
+        uint64_t total_start = wall_now_ns();
+        if(report.jobs == 1)
+            report.demos = run_serial(selection, options);
+        else
+            report.demos = run_parallel(selection, options, report.jobs);
+        report.total_wall_ns = wall_now_ns() - total_start;
+    }
+    report.regions = perf_region_totals();
+    if(options.latency)
+        report.latencies = latency_summaries();
+    report.counters = options.counters;
+    if(options.counters)
+        report.counter_totals = stat_counters_total();
+    if(options.alloc_sites)
+    {
+        for(auto& r : report.demos)
+            r.alloc_sites = alloc_top_sites(r.name.c_str(), 5);
+    }
+
+    if(!options.profile_dir.empty())
+    {
+        stop_profiler();
+        ProfileSummary profile = write_folded_stacks(options.profile_dir);
+        cerr << "Profile: " << profile.samples << " samples in " << profile.files
+             << " files in " << options.profile_dir
+             << ", " << profile.outside << " outside the demos";
+        if(profile.dropped)
+            cerr << ", " << profile.dropped << " dropped (buffer full)";
+        cerr << endl;
+    }
+    if(trace_file.is_open())
+    {
+        uint64_t dropped = write_trace(trace_file);
+        if(dropped)
+            cerr << dropped << " spans dropped from the trace: thread buffers full" << endl;
+    }
+
+    ofstream report_file;
+    if(!options.report_file.empty())
+    {
+        report_file.open(options.report_file);
+        if(!report_file)
+            throw runtime_error("cannot write report to " + options.report_file);
+    }
+    ostream& report_out = options.report_file.empty() ? cout : report_file;
+    if(options.report_format == "csv")
+        write_csv(report_out, report);
+    else
+        write_json(report_out, report);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#ifndef _DEMO_RUNNER_H_
+#define _DEMO_RUNNER_H_
+
+#include <cstddef> // for size_t
+#include <functional> // for std::function
+#include <ostream>
+#include <string>
+#include <vector>
+#include "demo_output.h"
+
+typedef std::function<void()> DemoFunction;
+
+/// Entry of the demo table: the name used to select it on the command line
+/// and the function that runs it
+struct Demo
+{
+    const char* name;
+    DemoFunction run;
+};
+
+/// Settings of the non-interactive (batch) mode, parsed from the command line
+struct RunnerOptions
+{
+    std::vector<std::string> selected;  ///< demo names, in run order; empty for all
+    unsigned int repeat = 1;            ///< timed runs of each demo
+    unsigned int warmup = 0;            ///< untimed runs of each demo before timing
+    std::string report_format = "json"; ///< "json" or "csv"
+    std::string report_file;            ///< empty for standard output
+    unsigned int jobs = 1;              ///< demos run at the same time; 0 for one per core
+    bool perf = false;                  ///< also report the hardware counters
+    bool counters = false;              ///< also report the statistics counters
+    bool latency = false;               ///< also report the latency of the probed calls
+    bool alloc = false;                 ///< also report the heap allocations
+    bool alloc_sites = false;           ///< and the call sites allocating the most
+    std::string trace_file;             ///< where to write the timeline; empty for none
+    std::string profile_dir;            ///< where to write the folded stacks; empty for none
+    unsigned int profile_hz = 997;      ///< samples per second of CPU time
+    OutputSink sink = OutputSink::Console; ///< where the demos print
+    bool list = false;                  ///< only list the demo names
+    bool help = false;                  ///< only print the usage
+};
+
+/// Parses the command line. Throws std::invalid_argument on bad usage.
+RunnerOptions parse_runner_options(int argc, char* argv[]);
+
+/// Describes the command line options
+void print_usage(std::ostream& out, const char* program);
+
+/// Runs the selected demos without prompting, times each run
+/// and writes the report. Returns the process exit code.
+int run_batch(const Demo* demos, size_t count, const RunnerOptions& options);
+
+#endif /* _DEMO_RUNNER_H_ */
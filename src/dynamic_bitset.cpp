@@ -0,0 +1,508 @@
+#include <cstdlib> // for aligned_alloc, free
+#include <cstring> // for memcpy, memset, memcmp
+#include <iostream>
+#include <new> // for bad_alloc
+#include <stdexcept> // for invalid_argument, out_of_range
+#include <string>
+#include <utility> // for swap
+#include "dynamic_bitset.h"
+#include "bit_manipulation.h" // for popcount_words
+#include "cpu_features.h"
+#include "demo_output.h"
+
+using namespace std;
+
+const size_t DynamicBitset::npos;
+const size_t DynamicBitset::word_bits;
+const size_t DynamicBitset::line_words;
+
+// Bulk operations, one variant per instruction set. The word count is a
+// multiple of a cache line and the words are aligned on one: no tail,
+// aligned vector loads. Each loop is a template on the operation, and the
+// variant of each level picks the loop of the operation once per call.
+
+template<BitOp op>
+static inline uint64_t op_word(uint64_t a, uint64_t b)
+{
+    switch(op)
+    {
+    case BitOp::And: return a & b;
+    case BitOp::Or: return a | b;
+    case BitOp::Xor: return a ^ b;
+    default: return a & ~b;
+    }
+}
+
+// Calls Loop<op>::run(args...)
+template<template<BitOp> class Loop, typename... Args>
+static auto dispatch(BitOp op, Args... args) -> decltype(Loop<BitOp::And>::run(args...))
+{
+    switch(op)
+    {
+    case BitOp::And: return Loop<BitOp::And>::run(args...);
+    case BitOp::Or: return Loop<BitOp::Or>::run(args...);
+    case BitOp::Xor: return Loop<BitOp::Xor>::run(args...);
+    default: return Loop<BitOp::AndNot>::run(args...);
+    }
+}
+
+template<BitOp op>
+struct ApplyScalar
+{
+    static void run(uint64_t* a, const uint64_t* b, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i)
+            a[i] = op_word<op>(a[i], b[i]);
+    }
+};
+
+// Baseline: the builtin of bit_count is a call to libgcc
+template<BitOp op>
+struct CountScalar
+{
+    static size_t run(const uint64_t* a, const uint64_t* b, size_t count)
+    {
+        size_t total = 0;
+        for(size_t i = 0; i < count; ++i)
+            total += bit_count(op_word<op>(a[i], b[i]));
+        return total;
+    }
+};
+
+static void apply_scalar(BitOp op, uint64_t* a, const uint64_t* b, size_t count)
+{
+    dispatch<ApplyScalar>(op, a, b, count);
+}
+
+static size_t count_scalar(BitOp op, const uint64_t* a, const uint64_t* b, size_t count)
+{
+    return dispatch<CountScalar>(op, a, b, count);
+}
+
+#ifdef HAS_X86_KERNELS
+// Same code, where bit_count is the POPCNT instruction
+template<BitOp op>
+struct CountSSE42
+{
+    __attribute__((target("popcnt")))
+    static size_t run(const uint64_t* a, const uint64_t* b, size_t count)
+    {
+        size_t total = 0;
+        for(size_t i = 0; i < count; ++i)
+            total += bit_count(op_word<op>(a[i], b[i]));
+        return total;
+    }
+};
+
+static size_t count_sse42(BitOp op, const uint64_t* a, const uint64_t* b, size_t count)
+{
+    return dispatch<CountSSE42>(op, a, b, count);
+}
+
+template<BitOp op>
+__attribute__((target("avx2")))
+static inline __m256i op_avx2(__m256i a, __m256i b)
+{
+    switch(op)
+    {
+    case BitOp::And: return _mm256_and_si256(a, b);
+    case BitOp::Or: return _mm256_or_si256(a, b);
+    case BitOp::Xor: return _mm256_xor_si256(a, b);
+    default: return _mm256_andnot_si256(b, a);
+    }
+}
+
+// Bits of each byte, by nibble lookup with a byte shuffle, summed
+// over each 64-bit lane with SAD (see popcount_words)
+__attribute__((target("avx2")))
+static inline __m256i popcount_lanes_avx2(__m256i v)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(v, low_nibbles);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                    _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+template<BitOp op>
+struct ApplyAVX2
+{
+    __attribute__((target("avx2")))
+    static void run(uint64_t* a, const uint64_t* b, size_t count)
+    {
+        for(size_t i = 0; i < count; i += 8)
+        {
+            __m256i* pa = reinterpret_cast<__m256i*>(a + i);
+            const __m256i* pb = reinterpret_cast<const __m256i*>(b + i);
+            _mm256_store_si256(pa, op_avx2<op>(_mm256_load_si256(pa), _mm256_load_si256(pb)));
+            _mm256_store_si256(pa + 1, op_avx2<op>(_mm256_load_si256(pa + 1), _mm256_load_si256(pb + 1)));
+        }
+    }
+};
+
+template<BitOp op>
+struct CountAVX2
+{
+    __attribute__((target("avx2")))
+    static size_t run(const uint64_t* a, const uint64_t* b, size_t count)
+    {
+        __m256i sums = _mm256_setzero_si256();
+        for(size_t i = 0; i < count; i += 8)
+        {
+            const __m256i* pa = reinterpret_cast<const __m256i*>(a + i);
+            const __m256i* pb = reinterpret_cast<const __m256i*>(b + i);
+            sums = _mm256_add_epi64(sums, popcount_lanes_avx2(
+                op_avx2<op>(_mm256_load_si256(pa), _mm256_load_si256(pb))));
+            sums = _mm256_add_epi64(sums, popcount_lanes_avx2(
+                op_avx2<op>(_mm256_load_si256(pa + 1), _mm256_load_si256(pb + 1))));
+        }
+        return _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+             + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    }
+};
+
+__attribute__((target("avx2")))
+static void apply_avx2(BitOp op, uint64_t* a, const uint64_t* b, size_t count)
+{
+    dispatch<ApplyAVX2>(op, a, b, count);
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(BitOp op, const uint64_t* a, const uint64_t* b, size_t count)
+{
+    return dispatch<CountAVX2>(op, a, b, count);
+}
+
+BEGIN_AVX512_KERNELS
+template<BitOp op>
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i op_avx512(__m512i a, __m512i b)
+{
+    switch(op)
+    {
+    case BitOp::And: return _mm512_and_si512(a, b);
+    case BitOp::Or: return _mm512_or_si512(a, b);
+    case BitOp::Xor: return _mm512_xor_si512(a, b);
+    default: return _mm512_andnot_si512(b, a);
+    }
+}
+
+// Same as AVX2, over 512-bit vectors. Does not need the VPOPCNTQ extension.
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i popcount_lanes_avx512(__m512i v)
+{
+    const __m512i lookup = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                                                1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low_nibbles = _mm512_set1_epi8(0x0f);
+    __m512i low = _mm512_and_si512(v, low_nibbles);
+    __m512i high = _mm512_and_si512(_mm512_srli_epi16(v, 4), low_nibbles);
+    __m512i bytes = _mm512_add_epi8(_mm512_shuffle_epi8(lookup, low),
+                                    _mm512_shuffle_epi8(lookup, high));
+    return _mm512_sad_epu8(bytes, _mm512_setzero_si512());
+}
+
+// One cache line per iteration
+template<BitOp op>
+struct ApplyAVX512
+{
+    __attribute__((target("avx512f,avx512bw")))
+    static void run(uint64_t* a, const uint64_t* b, size_t count)
+    {
+        for(size_t i = 0; i < count; i += 8)
+            _mm512_store_si512(a + i, op_avx512<op>(_mm512_load_si512(a + i), _mm512_load_si512(b + i)));
+    }
+};
+
+template<BitOp op>
+struct CountAVX512
+{
+    __attribute__((target("avx512f,avx512bw")))
+    static size_t run(const uint64_t* a, const uint64_t* b, size_t count)
+    {
+        __m512i sums = _mm512_setzero_si512();
+        for(size_t i = 0; i < count; i += 8)
+            sums = _mm512_add_epi64(sums, popcount_lanes_avx512(
+                op_avx512<op>(_mm512_load_si512(a + i), _mm512_load_si512(b + i))));
+        return _mm512_reduce_add_epi64(sums);
+    }
+};
+
+__attribute__((target("avx512f,avx512bw")))
+static void apply_avx512(BitOp op, uint64_t* a, const uint64_t* b, size_t count)
+{
+    dispatch<ApplyAVX512>(op, a, b, count);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t count_avx512(BitOp op, const uint64_t* a, const uint64_t* b, size_t count)
+{
+    return dispatch<CountAVX512>(op, a, b, count);
+}
+END_AVX512_KERNELS
+#endif
+
+static const Kernel<void (*)(BitOp, uint64_t*, const uint64_t*, size_t)> apply_kernel(
+    "dynamic_bitset.apply", apply_scalar, nullptr, X86_KERNEL(apply_avx2), X86_KERNEL(apply_avx512));
+
+static const Kernel<size_t (*)(BitOp, const uint64_t*, const uint64_t*, size_t)> count_kernel(
+    "dynamic_bitset.count_of", count_scalar, X86_KERNEL(count_sse42), X86_KERNEL(count_avx2), X86_KERNEL(count_avx512));
+
+// Words of the given number of bits, rounded up to whole cache lines
+static size_t words_for(size_t size)
+{
+    size_t words = (size + DynamicBitset::word_bits - 1) / DynamicBitset::word_bits;
+    return (words + DynamicBitset::line_words - 1) / DynamicBitset::line_words * DynamicBitset::line_words;
+}
+
+static uint64_t* allocate_words(size_t count)
+{
+    if(count == 0)
+        return nullptr;
+    // The size is a multiple of the alignment, as aligned_alloc requires
+    void* words = aligned_alloc(DynamicBitset::line_words * sizeof(uint64_t), count * sizeof(uint64_t));
+    if(!words)
+        throw bad_alloc();
+    return static_cast<uint64_t*>(words);
+}
+
+DynamicBitset::DynamicBitset(size_t size, bool value)
+:_words(allocate_words(words_for(size))), _size(size), _word_count(words_for(size))
+{
+    if(value)
+        set();
+    else
+        reset();
+}
+
+DynamicBitset::DynamicBitset(const DynamicBitset& other)
+:_words(allocate_words(other._word_count)), _size(other._size), _word_count(other._word_count)
+{
+    if(_word_count)
+        memcpy(_words, other._words, _word_count * sizeof(uint64_t));
+}
+
+DynamicBitset::DynamicBitset(DynamicBitset&& other) noexcept
+:_words(other._words), _size(other._size), _word_count(other._word_count)
+{
+    other._words = nullptr;
+    other._size = 0;
+    other._word_count = 0;
+}
+
+DynamicBitset& DynamicBitset::operator=(const DynamicBitset& other)
+{
+    if(this == &other)
+        return *this;
+    if(_word_count != other._word_count)
+    {
+        DynamicBitset copy(other);
+        return *this = std::move(copy);
+    }
+    _size = other._size;
+    if(_word_count)
+        memcpy(_words, other._words, _word_count * sizeof(uint64_t));
+    return *this;
+}
+
+DynamicBitset& DynamicBitset::operator=(DynamicBitset&& other) noexcept
+{
+    swap(_words, other._words);
+    swap(_size, other._size);
+    swap(_word_count, other._word_count);
+    return *this;
+}
+
+DynamicBitset::~DynamicBitset()
+{
+    free(_words);
+}
+
+bool DynamicBitset::test(size_t i) const
+{
+    if(i >= _size)
+        throw out_of_range("bitset position " + to_string(i) + " past the size " + to_string(_size));
+    return (*this)[i];
+}
+
+DynamicBitset& DynamicBitset::set()
+{
+    if(_word_count)
+        memset(_words, 0xff, _word_count * sizeof(uint64_t));
+    clear_padding();
+    return *this;
+}
+
+DynamicBitset& DynamicBitset::reset()
+{
+    if(_word_count)
+        memset(_words, 0, _word_count * sizeof(uint64_t));
+    return *this;
+}
+
+void DynamicBitset::clear_padding()
+{
+    size_t used = (_size + word_bits - 1) / word_bits;
+    if(_size % word_bits)
+        _words[used - 1] &= (uint64_t(1) << (_size % word_bits)) - 1;
+    for(size_t w = used; w < _word_count; ++w)
+        _words[w] = 0;
+}
+
+size_t DynamicBitset::count() const
+{
+    return popcount_words(_words, _word_count);
+}
+
+// A cache line at a time, with no branch inside it
+bool DynamicBitset::any() const
+{
+    for(size_t w = 0; w < _word_count; w += line_words)
+    {
+        uint64_t line = 0;
+        for(size_t i = 0; i < line_words; ++i)
+            line |= _words[w + i];
+        if(line)
+            return true;
+    }
+    return false;
+}
+
+void DynamicBitset::check_same_size(const DynamicBitset& other) const
+{
+    if(_size != other._size)
+        throw invalid_argument("bitsets of different sizes: " + to_string(_size)
+            + " and " + to_string(other._size));
+}
+
+DynamicBitset& DynamicBitset::apply(BitOp op, const DynamicBitset& other)
+{
+    check_same_size(other);
+    apply_kernel(op, _words, other._words, _word_count);
+    return *this;
+}
+
+size_t count_of(BitOp op, const DynamicBitset& a, const DynamicBitset& b)
+{
+    if(a.size() != b.size())
+        throw invalid_argument("bitsets of different sizes: " + to_string(a.size())
+            + " and " + to_string(b.size()));
+    return count_kernel(op, a.data(), b.data(), a.word_count());
+}
+
+DynamicBitset& DynamicBitset::operator<<=(size_t shift)
+{
+    if(shift >= _size)
+        return reset();
+    size_t word_shift = shift / word_bits;
+    size_t bit_shift = shift % word_bits;
+    // From the top, each word made of the two source words it straddles
+    for(size_t w = _word_count; w-- > word_shift; )
+    {
+        size_t source = w - word_shift;
+        uint64_t word = _words[source] << bit_shift;
+        if(bit_shift && source > 0)
+            word |= _words[source - 1] >> (word_bits - bit_shift);
+        _words[w] = word;
+    }
+    for(size_t w = 0; w < word_shift; ++w)
+        _words[w] = 0;
+    clear_padding();
+    return *this;
+}
+
+DynamicBitset& DynamicBitset::operator>>=(size_t shift)
+{
+    if(shift >= _size)
+        return reset();
+    size_t word_shift = shift / word_bits;
+    size_t bit_shift = shift % word_bits;
+    for(size_t w = 0; w + word_shift < _word_count; ++w)
+    {
+        size_t source = w + word_shift;
+        uint64_t word = _words[source] >> bit_shift;
+        if(bit_shift && source + 1 < _word_count)
+            word |= _words[source + 1] << (word_bits - bit_shift);
+        _words[w] = word;
+    }
+    for(size_t w = _word_count - word_shift; w < _word_count; ++w)
+        _words[w] = 0;
+    return *this;
+}
+
+size_t DynamicBitset::find_from(size_t pos) const
+{
+    size_t w = pos / word_bits;
+    if(w >= _word_count)
+        return npos;
+    // The bits below pos masked off the first word
+    uint64_t word = _words[w] & (~uint64_t(0) << (pos % word_bits));
+    while(!word)
+    {
+        if(++w == _word_count)
+            return npos;
+        word = _words[w];
+    }
+    return w * word_bits + count_trailing_zeros(word);
+}
+
+bool DynamicBitset::operator==(const DynamicBitset& other) const
+{
+    return _size == other._size
+        && (_word_count == 0 || memcmp(_words, other._words, _word_count * sizeof(uint64_t)) == 0);
+}
+
+static void print_members(const char* name, const DynamicBitset& set)
+{
+    demo_out() << name << " (" << set.count() << ") :";
+    set.for_each_set([](size_t i) { demo_out() << ' ' << i; });
+    demo_out() << '\n';
+}
+
+void demo_dynamic_bitset()
+{
+    demo_out() << endl << "************* Dynamic bitset *************" << endl;
+
+    // Membership sets over 0..99: the size is only known at run time
+    size_t n = 100;
+    DynamicBitset multiples_of_3(n), multiples_of_5(n);
+    for(size_t i = 0; i < n; i += 3)
+        multiples_of_3.set(i);
+    for(size_t i = 0; i < n; i += 5)
+        multiples_of_5.set(i);
+    demo_out() << "Size " << multiples_of_3.size() << " bits in " << multiples_of_3.word_count()
+               << " words (" << multiples_of_3.word_count() * sizeof(uint64_t) << " bytes, one cache line)" << endl;
+    print_members("Multiples of 3 ", multiples_of_3);
+    print_members("Multiples of 5 ", multiples_of_5);
+
+    // The counts of the combinations need no intermediate bitset
+    demo_out() << "Multiples of 3 and 5 : " << count_of(BitOp::And, multiples_of_3, multiples_of_5) << endl;
+    demo_out() << "Multiples of 3 or 5  : " << count_of(BitOp::Or, multiples_of_3, multiples_of_5) << endl;
+    demo_out() << "Multiples of 3 not 5 : " << count_of(BitOp::AndNot, multiples_of_3, multiples_of_5) << endl;
+
+    DynamicBitset multiples_of_15 = multiples_of_3 & multiples_of_5;
+    print_members("Multiples of 15", multiples_of_15);
+    demo_out() << "Visited with find_first/find_next :";
+    for(size_t i = multiples_of_15.find_first(); i != DynamicBitset::npos; i = multiples_of_15.find_next(i))
+        demo_out() << ' ' << i;
+    demo_out() << endl;
+
+    // Shifting by one turns each multiple of 15 into its successor
+    multiples_of_15 <<= 1;
+    print_members("Shifted left by 1", multiples_of_15);
+    multiples_of_15 >>= 91;
+    print_members("Shifted right by 91", multiples_of_15);
+    multiples_of_15.and_not(multiples_of_15);
+    demo_out() << "Any bit left after and_not itself ? " << (multiples_of_15.any() ? "true" : "false") << endl;
+
+    try
+    {
+        multiples_of_3 &= DynamicBitset(n + 1);
+    }
+    catch(invalid_argument const& e)
+    {
+        demo_out() << "Error: " << e.what() << endl;
+    }
+}
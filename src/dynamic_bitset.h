@@ -0,0 +1,175 @@
+#ifndef _DYNAMIC_BITSET_H_
+#define _DYNAMIC_BITSET_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <iterator> // for forward_iterator_tag
+#include "bit_ops.h"
+
+/// Dynamic bitset demo: membership sets, intersections and iteration
+void demo_dynamic_bitset();
+
+/// Bitwise operation of two bitsets, applied word by word
+enum class BitOp : unsigned int
+{
+    And,
+    Or,
+    Xor,
+    AndNot  ///< bits of the first operand that are not in the second
+};
+
+/// Forward iterator over the positions of the set bits of an array of
+/// words, in increasing order: strips the lowest set bit off the current word
+class SetBitIterator
+{
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef size_t value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const size_t* pointer;
+    typedef size_t reference;
+
+    /// Positioned on the first set bit of the words, or at the end
+    SetBitIterator(const uint64_t* words, size_t word_count, size_t word_index)
+    :_words(words), _word_count(word_count), _index(word_index), _word(0)
+    {
+        if(_index < _word_count)
+        {
+            _word = _words[_index];
+            skip_empty_words();
+        }
+    }
+
+    size_t operator*() const { return _index * 64 + count_trailing_zeros(_word); }
+
+    SetBitIterator& operator++()
+    {
+        _word = strip_lowest_set_bit(_word);
+        skip_empty_words();
+        return *this;
+    }
+
+    SetBitIterator operator++(int)
+    {
+        SetBitIterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(const SetBitIterator& other) const { return _index == other._index && _word == other._word; }
+    bool operator!=(const SetBitIterator& other) const { return !(*this == other); }
+
+private:
+    void skip_empty_words()
+    {
+        while(!_word && ++_index < _word_count)
+            _word = _words[_index];
+    }
+
+    const uint64_t* _words;
+    size_t _word_count;
+    size_t _index;      ///< current word, _word_count at the end
+    uint64_t _word;     ///< its set bits not visited yet
+};
+
+/// Bit array whose size is chosen at run time, from a few bits to billions.
+/// The words are 64-byte aligned and padded to a whole number of cache
+/// lines, the bits past size() always clear: the bulk operations run over
+/// whole vectors with no tail, with the fastest instructions of the host
+/// (see cpu_features.h). Bit i is bit i%64 of word i/64.
+class DynamicBitset
+{
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+    static const size_t word_bits = 64;
+    /// Words per cache line: the word count is a multiple of it
+    static const size_t line_words = 8;
+
+    explicit DynamicBitset(size_t size = 0, bool value = false);
+    DynamicBitset(const DynamicBitset& other);
+    DynamicBitset(DynamicBitset&& other) noexcept;
+    DynamicBitset& operator=(const DynamicBitset& other);
+    DynamicBitset& operator=(DynamicBitset&& other) noexcept;
+    ~DynamicBitset();
+
+    size_t size() const { return _size; }
+    /// Number of words, padding included
+    size_t word_count() const { return _word_count; }
+    const uint64_t* data() const { return _words; }
+    /// The words may be written in bulk, keeping the bits past size() clear
+    uint64_t* data() { return _words; }
+
+    /// Unchecked accessors
+    bool operator[](size_t i) const { return (_words[i / word_bits] >> (i % word_bits)) & 1; }
+    void set(size_t i) { _words[i / word_bits] |= uint64_t(1) << (i % word_bits); }
+    void reset(size_t i) { _words[i / word_bits] &= ~(uint64_t(1) << (i % word_bits)); }
+    void flip(size_t i) { _words[i / word_bits] ^= uint64_t(1) << (i % word_bits); }
+    void set(size_t i, bool value) { value ? set(i) : reset(i); }
+
+    /// Checked access: throws std::out_of_range past the size
+    bool test(size_t i) const;
+
+    /// All the bits at once
+    DynamicBitset& set();
+    DynamicBitset& reset();
+
+    size_t count() const;
+    bool any() const;
+    bool none() const { return !any(); }
+
+    /// In-place operations with a bitset of the same size,
+    /// else they throw std::invalid_argument
+    DynamicBitset& apply(BitOp op, const DynamicBitset& other);
+    DynamicBitset& operator&=(const DynamicBitset& other) { return apply(BitOp::And, other); }
+    DynamicBitset& operator|=(const DynamicBitset& other) { return apply(BitOp::Or, other); }
+    DynamicBitset& operator^=(const DynamicBitset& other) { return apply(BitOp::Xor, other); }
+    DynamicBitset& and_not(const DynamicBitset& other) { return apply(BitOp::AndNot, other); }
+
+    /// Bits moved towards the higher (<<) or lower (>>) positions,
+    /// the bits shifted past either end being lost
+    DynamicBitset& operator<<=(size_t shift);
+    DynamicBitset& operator>>=(size_t shift);
+
+    /// Position of the lowest set bit, npos if there is none
+    size_t find_first() const { return find_from(0); }
+    /// Position of the lowest set bit above pos, npos if there is none
+    size_t find_next(size_t pos) const { return pos + 1 >= _size ? npos : find_from(pos + 1); }
+
+    /// Calls f(position) for each set bit, in increasing order:
+    /// one iteration per set bit, stripping the lowest one off each word
+    template<typename F>
+    void for_each_set(F f) const
+    {
+        for(size_t w = 0; w < _word_count; ++w)
+        {
+            for(uint64_t word = _words[w]; word; word = strip_lowest_set_bit(word))
+                f(w * word_bits + count_trailing_zeros(word));
+        }
+    }
+
+    /// Positions of the set bits, e.g. for(size_t i : bits)
+    SetBitIterator begin() const { return SetBitIterator(_words, _word_count, 0); }
+    SetBitIterator end() const { return SetBitIterator(_words, _word_count, _word_count); }
+
+    bool operator==(const DynamicBitset& other) const;
+    bool operator!=(const DynamicBitset& other) const { return !(*this == other); }
+
+private:
+    size_t find_from(size_t pos) const;
+    void clear_padding();
+    void check_same_size(const DynamicBitset& other) const;
+
+    uint64_t* _words;
+    size_t _size;
+    size_t _word_count;
+};
+
+inline DynamicBitset operator&(DynamicBitset a, const DynamicBitset& b) { a &= b; return a; }
+inline DynamicBitset operator|(DynamicBitset a, const DynamicBitset& b) { a |= b; return a; }
+inline DynamicBitset operator^(DynamicBitset a, const DynamicBitset& b) { a ^= b; return a; }
+
+/// Number of set bits of (a op b), without storing it: one pass over both.
+/// Throws std::invalid_argument if the sizes differ.
+size_t count_of(BitOp op, const DynamicBitset& a, const DynamicBitset& b);
+
+#endif /* _DYNAMIC_BITSET_H_ */
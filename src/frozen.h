@@ -0,0 +1,301 @@
+#ifndef _FROZEN_H_
+#define _FROZEN_H_
+
+#include <array>
+#include <cstddef> // for size_t
+#include <functional> // for less
+#include <stdexcept> // for invalid_argument, out_of_range
+#include <utility> // for pair, index_sequence
+#include "bit_ops.h"
+
+// Constexpr sort of std::array, and "frozen" ordered containers built from
+// it at compile time: sorted once, never modified, no heap. All of it is
+// C++14: std::array is only read (its const operator[] is the constexpr
+// one), the work is done in plain arrays, with loops rather than recursion
+// so that thousands of elements stay within the constexpr limits of the
+// compiler. The element types are literal and default-constructible.
+
+/// Position order[i] of the i-th smallest of the n values: iterative heap
+/// sort of the positions. Equal values keep their order: the positions
+/// break the ties.
+template<typename Values, typename Compare>
+constexpr bool cx_order_less(const Values& values, size_t a, size_t b, Compare comp)
+{
+    return comp(values[a], values[b]) || (!comp(values[b], values[a]) && a < b);
+}
+
+template<typename Values, typename Compare>
+constexpr void cx_sift_down(const Values& values, size_t* order, size_t root, size_t n, Compare comp)
+{
+    while(2 * root + 1 < n)
+    {
+        size_t child = 2 * root + 1;
+        if(child + 1 < n && cx_order_less(values, order[child], order[child + 1], comp))
+            ++child;
+        if(!cx_order_less(values, order[root], order[child], comp))
+            return;
+        size_t swapped = order[root];
+        order[root] = order[child];
+        order[child] = swapped;
+        root = child;
+    }
+}
+
+template<typename Values, typename Compare>
+constexpr void cx_sort_order(const Values& values, size_t* order, size_t n, Compare comp)
+{
+    for(size_t i = 0; i < n; ++i)
+        order[i] = i;
+    for(size_t root = n / 2; root-- > 0;)
+        cx_sift_down(values, order, root, n, comp);
+    for(size_t end = n; end-- > 1;)
+    {
+        size_t largest = order[0];
+        order[0] = order[end];
+        order[end] = largest;
+        cx_sift_down(values, order, 0, end, comp);
+    }
+}
+
+template<typename T, size_t N, size_t... I>
+constexpr std::array<T, N> cx_gather(const std::array<T, N>& values, const size_t* order, std::index_sequence<I...>)
+{
+    return {{values[order[I]]...}};
+}
+
+/// Sorted copy of the array, usable at compile time:
+/// constexpr auto sorted = cx_sort(make_array(3, 1, 2));
+/// Stable, O(N log N) comparisons. Meant for constant expressions: the
+/// result is built from one initializer per element, which is slow to
+/// compile into run-time code for large N, where std::sort is the tool.
+template<typename T, size_t N, typename Compare = std::less<T>>
+constexpr std::array<T, N> cx_sort(const std::array<T, N>& values, Compare comp = Compare())
+{
+    size_t order[N > 0 ? N : 1] = {};
+    cx_sort_order(values, order, N, comp);
+    return cx_gather(values, order, std::make_index_sequence<N>());
+}
+
+// Eytzinger layout (Khuong, Morin, "Array layouts for comparison-based
+// searching"): the implicit binary search tree stored breadth first, root
+// at 1, children of k at 2k and 2k + 1. A search goes down with one
+// comparison and no branch per level, and the 16 descendants of k four
+// levels down are in one cache line: they are prefetched while the levels
+// in between are compared.
+
+/// Slot of the smallest element of a layout of n elements
+constexpr size_t eytzinger_first(size_t n)
+{
+    size_t k = n > 0 ? 1 : 0;
+    while(k > 0 && 2 * k <= n)
+        k *= 2;
+    return k;
+}
+
+/// Slot of the element after the one at slot k, in order; 0 past the last
+constexpr size_t eytzinger_next(size_t k, size_t n)
+{
+    if(2 * k + 1 <= n)
+    {
+        k = 2 * k + 1;
+        while(2 * k <= n)
+            k *= 2;
+        return k;
+    }
+    // Up past the ancestors of which k is in the right subtree
+    return k >> (count_trailing_zeros(~k) + 1);
+}
+
+/// Slot of the first of the n elements of keys[1..n] that the key is not
+/// after (lower bound), or that is after the key (upper bound); 0 if none
+template<bool Upper, typename T, typename Key, typename Compare>
+constexpr size_t eytzinger_search(const T* keys, size_t n, const Key& key, Compare comp)
+{
+    const size_t line = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+    size_t k = 1;
+    while(k <= n)
+    {
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+        if(!__builtin_is_constant_evaluated() && k * line <= n)
+            __builtin_prefetch(keys + k * line);
+#endif
+#endif
+        k = 2 * k + (Upper ? !comp(key, keys[k]) : comp(keys[k], key));
+    }
+    // Undo the moves to the right after the last move to the left
+    return k >> (count_trailing_zeros(~k) + 1);
+}
+
+/// Ordered set of N values fixed at construction, in constant expressions
+/// too: constexpr auto set = make_frozen_set(make_array(...)). Replaces a
+/// static std::set lookup table: no node per value, no heap allocation at
+/// startup. The values are sorted as by cx_sort, then stored in Eytzinger
+/// order; contains, find, lower_bound and upper_bound are branch-free
+/// searches with prefetching, and the iterators walk the values in order.
+/// Duplicate values throw std::invalid_argument, i.e. fail to compile
+/// when the set is constexpr.
+template<typename T, size_t N, typename Compare = std::less<T>>
+class FrozenSet
+{
+public:
+    static_assert(N > 0, "a frozen set has at least one value");
+
+    typedef T value_type;
+
+    /// Forward iterator, in the order of Compare
+    class const_iterator
+    {
+    public:
+        constexpr const_iterator(const T* keys, size_t slot) : _keys(keys), _slot(slot) {}
+        constexpr const T& operator*() const { return _keys[_slot]; }
+        constexpr const T* operator->() const { return _keys + _slot; }
+        constexpr const_iterator& operator++() { _slot = eytzinger_next(_slot, N); return *this; }
+        constexpr bool operator==(const const_iterator& other) const { return _slot == other._slot; }
+        constexpr bool operator!=(const const_iterator& other) const { return _slot != other._slot; }
+    private:
+        const T* _keys;
+        size_t _slot;   ///< 0 at the end
+    };
+
+    constexpr explicit FrozenSet(const std::array<T, N>& values, Compare comp = Compare())
+        : _keys{}, _comp(comp)
+    {
+        size_t order[N] = {};
+        cx_sort_order(values, order, N, comp);
+        for(size_t i = 1; i < N; ++i)
+            if(!comp(values[order[i - 1]], values[order[i]]))
+                throw std::invalid_argument("frozen set: duplicate value");
+        size_t slot = eytzinger_first(N);
+        for(size_t i = 0; i < N; ++i, slot = eytzinger_next(slot, N))
+            _keys[slot] = values[order[i]];
+    }
+
+    constexpr size_t size() const { return N; }
+    constexpr const_iterator begin() const { return const_iterator(_keys, eytzinger_first(N)); }
+    constexpr const_iterator end() const { return const_iterator(_keys, 0); }
+
+    constexpr const_iterator lower_bound(const T& value) const
+    {
+        return const_iterator(_keys, eytzinger_search<false>(_keys, N, value, _comp));
+    }
+    constexpr const_iterator upper_bound(const T& value) const
+    {
+        return const_iterator(_keys, eytzinger_search<true>(_keys, N, value, _comp));
+    }
+    constexpr const_iterator find(const T& value) const
+    {
+        size_t slot = eytzinger_search<false>(_keys, N, value, _comp);
+        return const_iterator(_keys, slot != 0 && !_comp(value, _keys[slot]) ? slot : 0);
+    }
+    constexpr bool contains(const T& value) const { return find(value) != end(); }
+    constexpr size_t count(const T& value) const { return contains(value) ? 1 : 0; }
+
+private:
+    alignas(64) T _keys[N + 1];   ///< Eytzinger order from 1; _keys[0] unused
+    Compare _comp;
+};
+
+/// Ordered map of N entries fixed at construction, like FrozenSet: the keys
+/// in Eytzinger order for the searches, their values at the same slots of a
+/// parallel array, read only for the key found. Iterators dereference to a
+/// pair of references to the key and the value. Duplicate keys throw
+/// std::invalid_argument.
+template<typename Key, typename T, size_t N, typename Compare = std::less<Key>>
+class FrozenMap
+{
+public:
+    static_assert(N > 0, "a frozen map has at least one entry");
+
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<const Key&, const T&> reference;
+
+    /// Forward iterator, in the order of Compare of the keys
+    class const_iterator
+    {
+    public:
+        constexpr const_iterator(const Key* keys, const T* values, size_t slot)
+            : _keys(keys), _values(values), _slot(slot) {}
+        constexpr reference operator*() const { return reference(_keys[_slot], _values[_slot]); }
+        constexpr const_iterator& operator++() { _slot = eytzinger_next(_slot, N); return *this; }
+        constexpr bool operator==(const const_iterator& other) const { return _slot == other._slot; }
+        constexpr bool operator!=(const const_iterator& other) const { return _slot != other._slot; }
+    private:
+        const Key* _keys;
+        const T* _values;
+        size_t _slot;   ///< 0 at the end
+    };
+
+    constexpr explicit FrozenMap(const std::array<std::pair<Key, T>, N>& entries, Compare comp = Compare())
+        : _keys{}, _values{}, _comp(comp)
+    {
+        Key keys[N] = {};
+        for(size_t i = 0; i < N; ++i)
+            keys[i] = entries[i].first;
+        size_t order[N] = {};
+        cx_sort_order(keys, order, N, comp);
+        for(size_t i = 1; i < N; ++i)
+            if(!comp(keys[order[i - 1]], keys[order[i]]))
+                throw std::invalid_argument("frozen map: duplicate key");
+        size_t slot = eytzinger_first(N);
+        for(size_t i = 0; i < N; ++i, slot = eytzinger_next(slot, N))
+        {
+            _keys[slot] = entries[order[i]].first;
+            _values[slot] = entries[order[i]].second;
+        }
+    }
+
+    constexpr size_t size() const { return N; }
+    constexpr const_iterator begin() const { return iterator_at(eytzinger_first(N)); }
+    constexpr const_iterator end() const { return iterator_at(0); }
+
+    constexpr const_iterator lower_bound(const Key& key) const
+    {
+        return iterator_at(eytzinger_search<false>(_keys, N, key, _comp));
+    }
+    constexpr const_iterator upper_bound(const Key& key) const
+    {
+        return iterator_at(eytzinger_search<true>(_keys, N, key, _comp));
+    }
+    constexpr const_iterator find(const Key& key) const { return iterator_at(slot_of(key)); }
+    constexpr bool contains(const Key& key) const { return slot_of(key) != 0; }
+    constexpr size_t count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+    /// Value of the key; throws std::out_of_range if absent
+    constexpr const T& at(const Key& key) const
+    {
+        size_t slot = slot_of(key);
+        return slot != 0 ? _values[slot] : throw std::out_of_range("frozen map: no such key");
+    }
+
+private:
+    constexpr const_iterator iterator_at(size_t slot) const { return const_iterator(_keys, _values, slot); }
+
+    /// Slot of the key, 0 if absent
+    constexpr size_t slot_of(const Key& key) const
+    {
+        size_t slot = eytzinger_search<false>(_keys, N, key, _comp);
+        return slot != 0 && !_comp(key, _keys[slot]) ? slot : 0;
+    }
+
+    alignas(64) Key _keys[N + 1];   ///< Eytzinger order from 1; _keys[0] unused
+    T _values[N + 1];               ///< value of _keys[k] at _values[k]
+    Compare _comp;
+};
+
+/// Set of the values of an array: constexpr auto set = make_frozen_set(make_array(5, 2, 3));
+template<typename T, size_t N>
+constexpr FrozenSet<T, N> make_frozen_set(const std::array<T, N>& values)
+{
+    return FrozenSet<T, N>(values);
+}
+
+/// Map of the entries of an array of (key, value) pairs
+template<typename Key, typename T, size_t N>
+constexpr FrozenMap<Key, T, N> make_frozen_map(const std::array<std::pair<Key, T>, N>& entries)
+{
+    return FrozenMap<Key, T, N>(entries);
+}
+
+#endif /* _FROZEN_H_ */
@@ -5,6 +5,8 @@
 #include <vector>
 
 #include "initialization.h"
+#include "demo_output.h"
+#include "lifecycle_probe.h"
 
 using namespace std;
 
@@ -13,9 +15,9 @@ void print_container(const C& c)
 {
     for(const auto& x : c)
     {
-        cout << x << " ";
+        demo_out() << x << " ";
     }
-    cout << endl;
+    demo_out() << '\n';
 }
 
 template<typename D>
@@ -23,9 +25,9 @@ void print_dictionary(const D& d)
 {
     for(const auto& x : d)
     {
-        cout << x.first << "->" << x.second << " ";
+        demo_out() << x.first << "->" << x.second << " ";
     }
-    cout << endl;
+    demo_out() << '\n';
 }
 
 template<typename T>
@@ -33,12 +35,12 @@ void print_array(const T* a, unsigned int size)
 {
     for(const T* x = a; x < a+size; ++x)
     {
-        cout << *x << " ";
+        demo_out() << *x << " ";
     }
-    cout << endl;
+    demo_out() << '\n';
 }
 
-class C1
+class C1 : public LifecycleProbe<C1>
 {
     // In-class initialized data members
     string _s {"abc"};
@@ -52,7 +54,7 @@ public:
     C1(double d, const char* p) : _d(d), _p(p) {}
     void print() const
     {
-        cout << _s << " " << _d << " " << (_p ? _p : "") << endl;
+        demo_out() << _s << " " << _d << " " << (_p ? _p : "") << endl;
         print_array(_y, 4);
     }
 };
@@ -62,9 +64,12 @@ struct S1
     double _d;
     const char * _p;
     int _y[3];
+    // A member, not a base: in C++14 an aggregate has no base class.
+    // Last, so that the aggregate initializations leave it defaulted.
+    LifecycleProbe<S1> _probe;
     void print() const
     {
-        cout << _d << " " << (_p ? _p : "") << endl;
+        demo_out() << _d << " " << (_p ? _p : "") << endl;
         print_array(_y, 3);
     }
 };
@@ -78,7 +83,7 @@ S1 transform(const S1& s_in)
 
 void demo_initialization()
 {
-    cout << endl << "*************** Initialization ***********" << endl;
+    demo_out() << endl << "*************** Initialization ***********" << endl;
 
     // Initializing arrays
     int aData[] {1, 2, 3, 4, 5};
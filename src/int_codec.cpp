@@ -0,0 +1,381 @@
+#include <algorithm> // for copy, min_element
+#include <array>
+#include <iostream>
+#include <stdexcept> // for out_of_range
+#include <string>
+#include <utility> // for index_sequence
+#include "int_codec.h"
+#include "bit_ops.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+
+using namespace std;
+
+const size_t BitPackedSequence::block_size;
+const size_t BitPackedSequence::group_size;
+
+// Position of value j of a block: bit (j / 4) * width of stream j % 4,
+// whose word k is in[4 * k + j % 4]
+static inline uint32_t packed_value(const uint32_t* in, unsigned int width, size_t j)
+{
+    if(width == 0)
+        return 0;
+    size_t lane = j % 4, bit = (j / 4) * width, k = bit / 32, shift = bit % 32;
+    uint64_t pair = in[4 * k + lane];
+    if(shift + width > 32)
+        pair |= uint64_t(in[4 * k + 4 + lane]) << 32;
+    return uint32_t(pair >> shift) & uint32_t(~uint64_t(0) >> (64 - width));
+}
+
+// Decoding of one whole block, one variant per instruction set: the
+// values of the given width unpacked from in, then transformed back from
+// base, to out. The loops are instantiated for each width, where the
+// shifts and masks are constants.
+
+typedef void (*UnpackBlock)(uint32_t base, const uint32_t* in, uint32_t* out);
+
+// Table of Unpack<W, T>::run for the widths 1 to 32 (index W - 1)
+template<template<unsigned int, IntTransform> class Unpack, IntTransform T, size_t... W>
+static constexpr array<UnpackBlock, 32> unpack_table(index_sequence<W...>)
+{
+    return {{&Unpack<unsigned(W + 1), T>::run...}};
+}
+
+template<template<unsigned int, IntTransform> class Unpack>
+static void dispatch_unpack(IntTransform transform, unsigned int width, uint32_t base, const uint32_t* in, uint32_t* out)
+{
+    static const array<UnpackBlock, 32> tables[] = {
+        unpack_table<Unpack, IntTransform::FrameOfReference>(make_index_sequence<32>()),
+        unpack_table<Unpack, IntTransform::Delta>(make_index_sequence<32>()),
+        unpack_table<Unpack, IntTransform::ZigZagDelta>(make_index_sequence<32>())};
+    if(width == 0)
+    {
+        // Every transformed value is 0: the block repeats its base
+        fill(out, out + BitPackedSequence::block_size, base);
+        return;
+    }
+    tables[static_cast<unsigned int>(transform)][width - 1](base, in, out);
+}
+
+// Baseline: a value at a time, then the transform over the block
+template<unsigned int W, IntTransform T>
+struct UnpackScalar
+{
+    static void run(uint32_t base, const uint32_t* in, uint32_t* out)
+    {
+        for(size_t j = 0; j < BitPackedSequence::block_size; ++j)
+            out[j] = packed_value(in, W, j);
+        uint32_t previous = base;
+        for(size_t j = 0; j < BitPackedSequence::block_size; ++j)
+        {
+            if(T == IntTransform::FrameOfReference)
+                out[j] += base;
+            else
+                out[j] = previous += T == IntTransform::Delta ? out[j] : uint32_t(zigzag_decode(out[j]));
+        }
+    }
+};
+
+static void unpack_scalar(IntTransform transform, unsigned int width, uint32_t base, const uint32_t* in, uint32_t* out)
+{
+    dispatch_unpack<UnpackScalar>(transform, width, base, in, out);
+}
+
+#ifdef HAS_X86_KERNELS
+// 4 values at a time with SSE2:
+// vector p holds values 4p to 4p + 3, at bit p * W of the 4 streams. The
+// transform is fused in: the deltas are summed within the vector by two
+// shifted additions, plus the last value of the vector before.
+template<unsigned int W, IntTransform T>
+struct UnpackSSE42
+{
+    static void run(uint32_t base, const uint32_t* in, uint32_t* out)
+    {
+        const __m128i* words = reinterpret_cast<const __m128i*>(in);
+        const __m128i mask = _mm_set1_epi32(int(uint32_t(~uint64_t(0) >> (64 - W))));
+        // The base, then the last 4 values for the deltas
+        __m128i previous = _mm_set1_epi32(int(base));
+        // Unrolled, the shifts and the second loads are resolved per vector
+#pragma GCC unroll 32
+        for(unsigned int p = 0; p < BitPackedSequence::block_size / 4; ++p)
+        {
+            const unsigned int bit = p * W, k = bit / 32, shift = bit % 32;
+            __m128i v = _mm_srli_epi32(_mm_loadu_si128(words + k), int(shift));
+            if(shift + W > 32)
+                v = _mm_or_si128(v, _mm_slli_epi32(_mm_loadu_si128(words + k + 1), int(32 - shift)));
+            if(W < 32)
+                v = _mm_and_si128(v, mask);
+            if(T == IntTransform::FrameOfReference)
+                v = _mm_add_epi32(v, previous);
+            else
+            {
+                if(T == IntTransform::ZigZagDelta)
+                    v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(),
+                                                                         _mm_and_si128(v, _mm_set1_epi32(1))));
+                v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+                v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+                v = previous = _mm_add_epi32(v, _mm_shuffle_epi32(previous, 0xff));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * p), v);
+        }
+    }
+};
+
+static void unpack_sse42(IntTransform transform, unsigned int width, uint32_t base, const uint32_t* in, uint32_t* out)
+{
+    dispatch_unpack<UnpackSSE42>(transform, width, base, in, out);
+}
+#endif
+
+static const Kernel<void (*)(IntTransform, unsigned int, uint32_t, const uint32_t*, uint32_t*)> unpack_kernel(
+    "int_codec.unpack", unpack_scalar, X86_KERNEL(unpack_sse42), nullptr, nullptr);
+
+// Encoding of one whole block, one variant per instruction set: the
+// block_size transformed values, each below 2^width, packed from in to
+// the 4 * width words of out. Instantiated per width like the unpacking.
+
+typedef void (*PackBlock)(const uint32_t* in, uint32_t* out);
+
+// Table of Pack<W>::run for the widths 1 to 32 (index W - 1)
+template<template<unsigned int> class Pack, size_t... W>
+static constexpr array<PackBlock, 32> pack_table(index_sequence<W...>)
+{
+    return {{&Pack<unsigned(W + 1)>::run...}};
+}
+
+template<template<unsigned int> class Pack>
+static void dispatch_pack(unsigned int width, const uint32_t* in, uint32_t* out)
+{
+    static const array<PackBlock, 32> table = pack_table<Pack>(make_index_sequence<32>());
+    // Width 0 has no words
+    if(width != 0)
+        table[width - 1](in, out);
+}
+
+// Baseline: value j ORed at bit (j / 4) * W of stream j % 4
+template<unsigned int W>
+struct PackScalar
+{
+    static void run(const uint32_t* in, uint32_t* out)
+    {
+        fill(out, out + 4 * W, 0u);
+        for(size_t j = 0; j < BitPackedSequence::block_size; ++j)
+        {
+            size_t lane = j % 4, bit = (j / 4) * W, k = bit / 32, shift = bit % 32;
+            out[4 * k + lane] |= in[j] << shift;
+            if(shift + W > 32)
+                out[4 * k + 4 + lane] |= in[j] >> (32 - shift);
+        }
+    }
+};
+
+static void pack_scalar(unsigned int width, const uint32_t* in, uint32_t* out)
+{
+    dispatch_pack<PackScalar>(width, in, out);
+}
+
+#ifdef HAS_X86_KERNELS
+// 4 values at a time with SSE2, the reverse of UnpackSSE42: vector p
+// shifted to bit p * W of the 4 streams, ORed into the vector of words
+// being filled, stored once full with the bits past it carried over
+template<unsigned int W>
+struct PackSSE42
+{
+    static void run(const uint32_t* in, uint32_t* out)
+    {
+        __m128i* words = reinterpret_cast<__m128i*>(out);
+        __m128i filling = _mm_setzero_si128();
+#pragma GCC unroll 32
+        for(unsigned int p = 0; p < BitPackedSequence::block_size / 4; ++p)
+        {
+            const unsigned int bit = p * W, k = bit / 32, shift = bit % 32;
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * p));
+            filling = _mm_or_si128(filling, _mm_slli_epi32(v, int(shift)));
+            // The 32 vectors end exactly at the end of word 4 * W - 1
+            if(shift + W >= 32)
+            {
+                _mm_storeu_si128(words + k, filling);
+                filling = shift + W > 32 ? _mm_srli_epi32(v, int(32 - shift)) : _mm_setzero_si128();
+            }
+        }
+    }
+};
+
+static void pack_sse42(unsigned int width, const uint32_t* in, uint32_t* out)
+{
+    dispatch_pack<PackSSE42>(width, in, out);
+}
+#endif
+
+static const Kernel<void (*)(unsigned int, const uint32_t*, uint32_t*)> pack_kernel(
+    "int_codec.pack", pack_scalar, X86_KERNEL(pack_sse42), nullptr, nullptr);
+
+BitPackedSequence::BitPackedSequence(const uint32_t* values, size_t n, IntTransform transform)
+:_transform(transform), _size(n)
+{
+    size_t blocks = (n + block_size - 1) / block_size;
+    _bases.reserve(blocks);
+    _widths.reserve(blocks);
+    _offsets.reserve((blocks + group_size - 1) / group_size);
+    uint32_t transformed[block_size];
+    // The first block starts from the first value: its first delta is 0
+    uint32_t previous = n ? values[0] : 0;
+    for(size_t first = 0; first < n; first += block_size)
+    {
+        size_t count = min(block_size, n - first);
+        const uint32_t* block = values + first;
+        uint32_t base = previous;
+        if(transform == IntTransform::FrameOfReference)
+            base = *min_element(block, block + count);
+        // The padding of the last block is 0 once transformed
+        uint32_t any = 0;
+        for(size_t j = 0; j < block_size; ++j)
+        {
+            if(j >= count)
+                transformed[j] = 0;
+            else if(transform == IntTransform::FrameOfReference)
+                transformed[j] = block[j] - base;
+            else if(transform == IntTransform::Delta)
+                transformed[j] = block[j] - previous;
+            else
+                transformed[j] = zigzag_encode(int32_t(block[j] - previous));
+            if(j < count)
+                previous = block[j];
+            any |= transformed[j];
+        }
+        unsigned int width = 32 - count_leading_zeros(any);
+        if(_widths.size() % group_size == 0)
+            _offsets.push_back(_words.size());
+        _bases.push_back(base);
+        _widths.push_back(uint8_t(width));
+
+        size_t offset = _words.size();
+        _words.resize(offset + 4 * width);
+        pack_kernel(width, transformed, _words.data() + offset);
+    }
+}
+
+size_t BitPackedSequence::size_in_bytes() const
+{
+    return _words.size() * sizeof(uint32_t) + _bases.size() * sizeof(uint32_t) + _widths.size()
+           + _offsets.size() * sizeof(size_t);
+}
+
+size_t BitPackedSequence::block_offset(size_t b) const
+{
+    size_t offset = _offsets[b / group_size];
+    for(size_t g = b - b % group_size; g < b; ++g)
+        offset += 4 * _widths[g];
+    return offset;
+}
+
+uint32_t BitPackedSequence::operator[](size_t i) const
+{
+    size_t b = i / block_size;
+    const uint32_t* words = _words.data() + block_offset(b);
+    if(_transform == IntTransform::FrameOfReference)
+        return _bases[b] + packed_value(words, _widths[b], i % block_size);
+    uint32_t values[block_size];
+    unpack_kernel(_transform, _widths[b], _bases[b], words, values);
+    return values[i % block_size];
+}
+
+uint32_t BitPackedSequence::at(size_t i) const
+{
+    if(i >= _size)
+        throw out_of_range("bit-packed sequence: index " + to_string(i) + " past the size " + to_string(_size));
+    return (*this)[i];
+}
+
+void BitPackedSequence::decode(uint32_t* out) const
+{
+    // The offsets summed along the way
+    size_t whole = _size / block_size, offset = 0;
+    for(size_t b = 0; b < whole; offset += 4 * _widths[b++])
+        unpack_kernel(_transform, _widths[b], _bases[b], _words.data() + offset, out + b * block_size);
+    if(whole < _widths.size())
+        decode_block(whole, out + whole * block_size);
+}
+
+vector<uint32_t> BitPackedSequence::decode() const
+{
+    vector<uint32_t> values(_size);
+    decode(values.data());
+    return values;
+}
+
+size_t BitPackedSequence::decode_block(size_t b, uint32_t* out) const
+{
+    if(b >= _widths.size())
+        throw out_of_range("bit-packed sequence: block " + to_string(b) + " past the " + to_string(_widths.size()));
+    const uint32_t* words = _words.data() + block_offset(b);
+    size_t count = min(block_size, _size - b * block_size);
+    if(count == block_size)
+        unpack_kernel(_transform, _widths[b], _bases[b], words, out);
+    else
+    {
+        uint32_t values[block_size];
+        unpack_kernel(_transform, _widths[b], _bases[b], words, values);
+        copy(values, values + count, out);
+    }
+    return count;
+}
+
+void demo_int_codec()
+{
+    demo_out() << endl << "************** Integer codec **************" << endl;
+
+    // Sorted IDs of a small range, like the numbers of demo_lambdas but
+    // many more: the gaps take a few bits where the IDs take 32
+    vector<uint32_t> ids;
+    uint32_t seed = 1, id = 1000000;
+    for(size_t i = 0; i < 100000; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        ids.push_back(id += 1 + (seed >> 16) % 16);
+    }
+    // A slowly varying signal, up and down
+    vector<uint32_t> signal;
+    int32_t level = 5000;
+    for(size_t i = 0; i < 100000; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        signal.push_back(uint32_t(level += int32_t((seed >> 16) % 21) - 10));
+    }
+
+    struct Sample
+    {
+        const char* name;
+        const vector<uint32_t>& values;
+    };
+    for(const Sample& sample : {Sample{"Sorted IDs   ", ids}, Sample{"Signal       ", signal}})
+    {
+        demo_out() << sample.name << " : " << sample.values.size() * sizeof(uint32_t) << " bytes";
+        for(IntTransform transform : {IntTransform::FrameOfReference, IntTransform::Delta, IntTransform::ZigZagDelta})
+        {
+            BitPackedSequence packed(sample.values, transform);
+            demo_out() << (transform == IntTransform::FrameOfReference ? ", frame of reference "
+                           : transform == IntTransform::Delta ? ", delta " : ", zigzag delta ")
+                       << packed.size_in_bytes() << " (" << (packed.decode() == sample.values ? "" : "NOT ")
+                       << "decoded back)";
+        }
+        demo_out() << endl;
+    }
+
+    BitPackedSequence packed(ids);
+    demo_out() << packed.block_count() << " blocks of " << BitPackedSequence::block_size
+               << " IDs, block 0 at " << packed.block_width(0) << " bits per ID" << endl;
+    uint32_t block[BitPackedSequence::block_size];
+    size_t count = packed.decode_block(packed.block_count() - 1, block);
+    demo_out() << "Last block : " << count << " IDs, the last " << block[count - 1]
+               << ", ID 54321 : " << packed[54321] << " == " << ids[54321] << endl;
+    demo_out() << "zigzag_encode(-3) = " << zigzag_encode(-3) << ", zigzag_decode(5) = " << zigzag_decode(5) << endl;
+    try
+    {
+        packed.at(packed.size());
+    }
+    catch(out_of_range const& e)
+    {
+        demo_out() << "Error : " << e.what() << endl;
+    }
+}
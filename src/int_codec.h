@@ -0,0 +1,88 @@
+#ifndef _INT_CODEC_H_
+#define _INT_CODEC_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint32_t, int32_t, uint8_t
+#include <vector>
+
+/// Integer codec demo: sorted ID lists compressed by bit-packing
+void demo_int_codec();
+
+/// Transform of the values of a block before they are bit-packed: what is
+/// small in the sequence
+enum class IntTransform : unsigned int
+{
+    FrameOfReference, ///< value - minimum of the block: values in a narrow range, in any order
+    Delta,            ///< value - previous value: sorted values
+    ZigZagDelta       ///< zigzag of value - previous value: values that rise and fall by small steps
+};
+
+/// Small magnitudes, of either sign, to small unsigned integers:
+/// 0, -1, 1, -2, 2... to 0, 1, 2, 3, 4...
+inline uint32_t zigzag_encode(int32_t value) { return (uint32_t(value) << 1) ^ uint32_t(value >> 31); }
+inline int32_t zigzag_decode(uint32_t value) { return int32_t((value >> 1) ^ (0u - (value & 1))); }
+
+/// Read-only sequence of 32-bit integers, bit-packed in blocks of 128
+/// (Lemire, Boytsov, "Decoding billions of integers per second through
+/// vectorization", SIMD-BP128). Each block is transformed, then packed
+/// with as many bits per value as its largest transformed value needs.
+/// Value i of a block is in lane i % 4 of 4 interleaved streams of
+/// 32-bit words: a 128-bit vector holds word k of the 4 streams, and
+/// unpacking it gives 4 consecutive values at once, with one shift and
+/// one mask. The layout is the same whatever the host; packing and
+/// unpacking run with the fastest instructions it has (see cpu_features.h).
+/// The transforms are fused into the unpacking; when encoding, they run a
+/// value at a time, in the same pass as the width of the block.
+///
+/// The blocks decode independently of each other: each keeps the value
+/// its transform starts from and its width, 5 bytes. Where its words start
+/// is the sum of the widths before it, from the start of its group of
+/// group_size blocks, whose first word is stored.
+class BitPackedSequence
+{
+public:
+    static const size_t block_size = 128;
+    /// Blocks per stored offset
+    static const size_t group_size = 16;
+
+    BitPackedSequence() : _transform(IntTransform::Delta), _size(0) {}
+    BitPackedSequence(const uint32_t* values, size_t n, IntTransform transform);
+    explicit BitPackedSequence(const std::vector<uint32_t>& values, IntTransform transform = IntTransform::Delta)
+    : BitPackedSequence(values.data(), values.size(), transform) {}
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    IntTransform transform() const { return _transform; }
+    size_t block_count() const { return _widths.size(); }
+    /// Bits per value in block b
+    unsigned int block_width(size_t b) const { return _widths[b]; }
+    /// Packed words, block headers and group offsets
+    size_t size_in_bytes() const;
+
+    /// Unchecked access. Frame of reference reads the bits of the value
+    /// alone; the delta transforms decode its block up to it.
+    uint32_t operator[](size_t i) const;
+    /// Checked access: throws std::out_of_range past the size
+    uint32_t at(size_t i) const;
+
+    /// Writes the size() values to out
+    void decode(uint32_t* out) const;
+    std::vector<uint32_t> decode() const;
+    /// Writes the values of block b (block_size but for the last block)
+    /// to out, which has room for block_size. Returns their count.
+    /// Throws std::out_of_range past the last block.
+    size_t decode_block(size_t b, uint32_t* out) const;
+
+private:
+    /// First word of block b in _words
+    size_t block_offset(size_t b) const;
+
+    IntTransform _transform;
+    size_t _size;
+    std::vector<uint32_t> _bases;   ///< per block: minimum, or value the deltas start from: the one before the block, the first one for block 0
+    std::vector<uint8_t> _widths;   ///< per block: bits per value, 0 to 32; the block has 4 * width words
+    std::vector<size_t> _offsets;   ///< first word of blocks 0, group_size, 2 * group_size...
+    std::vector<uint32_t> _words;
+};
+
+#endif /* _INT_CODEC_H_ */
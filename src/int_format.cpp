@@ -0,0 +1,284 @@
+#include <cstdint> // for uint64_t
+#include <cstring> // for memcpy
+#include <iostream>
+#include <stdexcept> // for invalid_argument
+#include <string>
+#include "int_format.h"
+#include "bit_ops.h" // for byte_swap
+#include "cpu_features.h"
+#include "demo_output.h"
+
+using namespace std;
+
+// Binary digits of each byte, built at compile time
+struct BinaryTable
+{
+    char digits[256][8];
+};
+
+static constexpr BinaryTable make_binary_table()
+{
+    BinaryTable table{};
+    for(unsigned int byte = 0; byte < 256; ++byte)
+        for(unsigned int i = 0; i < 8; ++i)
+            table.digits[byte][i] = (byte >> (7 - i)) & 1 ? '1' : '0';
+    return table;
+}
+
+static constexpr BinaryTable binary_table = make_binary_table();
+
+// Hex digits of each nibble, 16 bytes: also one vector for a byte shuffle
+alignas(16) static const char hex_lower[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                               '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+alignas(16) static const char hex_upper[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                               '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+// Calls format(value, out) for each value, zero-extended to 64 bits,
+// and writes the separators
+template<typename U, typename Format>
+static inline char* format_values(const void* values, size_t count, char separator, char* out, Format format)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(values);
+    for(size_t i = 0; i < count; ++i, bytes += sizeof(U))
+    {
+        U value;
+        memcpy(&value, bytes, sizeof(U));
+        out = format(uint64_t(value), out);
+        if(separator && i + 1 < count)
+            *out++ = separator;
+    }
+    return out;
+}
+
+// Calls format_values for the size of the values, once per call
+template<typename Format>
+static inline char* dispatch(const void* values, size_t count, unsigned int value_bytes, char separator,
+                             char* out, Format format)
+{
+    switch(value_bytes)
+    {
+    case 1: return format_values<uint8_t>(values, count, separator, out, format);
+    case 2: return format_values<uint16_t>(values, count, separator, out, format);
+    case 4: return format_values<uint32_t>(values, count, separator, out, format);
+    default: return format_values<uint64_t>(values, count, separator, out, format);
+    }
+}
+
+// One value, one variant per instruction set. The digits are written from
+// the last one backwards, taking the value from its low bits: whole
+// vectors, then whole bytes, then the leading digits one by one.
+
+// Baseline: one lookup of 8 digits per byte
+static inline char* binary_bytes(uint64_t value, unsigned int digits, char* end)
+{
+    for(; digits >= 8; digits -= 8, value >>= 8)
+    {
+        end -= 8;
+        memcpy(end, binary_table.digits[value & 0xff], 8);
+    }
+    for(; digits; --digits, value >>= 1)
+        *--end = char('0' + (value & 1));
+    return end;
+}
+
+static inline char* binary_digits_scalar(uint64_t value, unsigned int digits, char* out)
+{
+    binary_bytes(value, digits, out + digits);
+    return out + digits;
+}
+
+// One lookup per nibble
+static inline char* hex_nibbles(uint64_t value, unsigned int digits, const char* alphabet, char* end)
+{
+    for(; digits; --digits, value >>= 4)
+        *--end = alphabet[value & 0xf];
+    return end;
+}
+
+static inline char* hex_digits_scalar(uint64_t value, unsigned int digits, const char* alphabet, char* out)
+{
+    hex_nibbles(value, digits, alphabet, out + digits);
+    return out + digits;
+}
+
+static char* format_binary_scalar(const void* values, size_t count, unsigned int value_bytes,
+                                  unsigned int digits, char separator, char* out)
+{
+    return dispatch(values, count, value_bytes, separator, out,
+                    [digits](uint64_t value, char* o) { return binary_digits_scalar(value, digits, o); });
+}
+
+static char* format_hex_scalar(const void* values, size_t count, unsigned int value_bytes,
+                               unsigned int digits, char separator, const char* alphabet, char* out)
+{
+    return dispatch(values, count, value_bytes, separator, out,
+                    [digits, alphabet](uint64_t value, char* o) { return hex_digits_scalar(value, digits, alphabet, o); });
+}
+
+#ifdef HAS_X86_KERNELS
+// The byte shuffle spreads each byte over the 8 digits it makes, which
+// test one bit each: '0' minus the all-ones of a set bit is '1'
+
+// 16 binary digits of 2 bytes. PSHUFB is SSSE3, part of the SSE4.2 level.
+__attribute__((target("ssse3")))
+static inline __m128i binary_chars_ssse3(uint64_t two_bytes)
+{
+    const __m128i spread = _mm_setr_epi8(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i bits = _mm_set1_epi64x(0x0102040810204080ll);
+    __m128i bytes = _mm_shuffle_epi8(_mm_cvtsi32_si128(int(two_bytes)), spread);
+    __m128i set = _mm_cmpeq_epi8(_mm_and_si128(bytes, bits), bits);
+    return _mm_sub_epi8(_mm_set1_epi8('0'), set);
+}
+
+__attribute__((target("ssse3")))
+static inline char* binary_digits_sse42(uint64_t value, unsigned int digits, char* out)
+{
+    char* const last = out + digits;
+    char* end = last;
+    for(; digits >= 16; digits -= 16, value >>= 16)
+    {
+        end -= 16;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(end), binary_chars_ssse3(value & 0xffff));
+    }
+    binary_bytes(value, digits, end);
+    return last;
+}
+
+// The 16 hex digits of a value: the most significant byte first, each
+// byte split in its two nibbles, which index the digits
+__attribute__((target("ssse3")))
+static inline char* hex_digits_sse42(uint64_t value, unsigned int digits, const char* alphabet, char* out)
+{
+    if(digits != 16)
+        return hex_digits_scalar(value, digits, alphabet, out);
+    const __m128i low_nibbles = _mm_set1_epi8(0x0f);
+    __m128i v = _mm_set_epi64x(0, static_cast<long long>(byte_swap(value)));
+    __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), low_nibbles);
+    __m128i low = _mm_and_si128(v, low_nibbles);
+    __m128i nibbles = _mm_unpacklo_epi8(high, low);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(alphabet)), nibbles));
+    return out + 16;
+}
+
+// flatten: the lambda has no target attribute, which otherwise keeps the
+// digits of each value a call away
+__attribute__((target("ssse3"), flatten))
+static char* format_binary_sse42(const void* values, size_t count, unsigned int value_bytes,
+                                 unsigned int digits, char separator, char* out)
+{
+    return dispatch(values, count, value_bytes, separator, out,
+                    [digits](uint64_t value, char* o) { return binary_digits_sse42(value, digits, o); });
+}
+
+__attribute__((target("ssse3"), flatten))
+static char* format_hex_sse42(const void* values, size_t count, unsigned int value_bytes,
+                              unsigned int digits, char separator, const char* alphabet, char* out)
+{
+    return dispatch(values, count, value_bytes, separator, out,
+                    [digits, alphabet](uint64_t value, char* o) { return hex_digits_sse42(value, digits, alphabet, o); });
+}
+
+// 32 binary digits of 4 bytes: the shuffle works within each 128-bit
+// half, both of which hold the 4 bytes
+__attribute__((target("avx2")))
+static inline __m256i binary_chars_avx2(uint64_t four_bytes)
+{
+    const __m256i spread = _mm256_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+                                            1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i bits = _mm256_set1_epi64x(0x0102040810204080ll);
+    __m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32(int(four_bytes)), spread);
+    __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bits), bits);
+    return _mm256_sub_epi8(_mm256_set1_epi8('0'), set);
+}
+
+__attribute__((target("avx2")))
+static inline char* binary_digits_avx2(uint64_t value, unsigned int digits, char* out)
+{
+    char* const last = out + digits;
+    char* end = last;
+    for(; digits >= 32; digits -= 32, value >>= 32)
+    {
+        end -= 32;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(end), binary_chars_avx2(value & 0xffffffff));
+    }
+    binary_bytes(value, digits, end);
+    return last;
+}
+
+__attribute__((target("avx2"), flatten))
+static char* format_binary_avx2(const void* values, size_t count, unsigned int value_bytes,
+                                unsigned int digits, char separator, char* out)
+{
+    return dispatch(values, count, value_bytes, separator, out,
+                    [digits](uint64_t value, char* o) { return binary_digits_avx2(value, digits, o); });
+}
+#endif
+
+static const Kernel<char* (*)(const void*, size_t, unsigned int, unsigned int, char, char*)> binary_kernel(
+    "int_format.binary", format_binary_scalar, X86_KERNEL(format_binary_sse42), X86_KERNEL(format_binary_avx2), nullptr);
+
+// 16 hex digits are one SSE vector: AVX2 would only help by pairs of values
+static const Kernel<char* (*)(const void*, size_t, unsigned int, unsigned int, char, const char*, char*)> hex_kernel(
+    "int_format.hex", format_hex_scalar, X86_KERNEL(format_hex_sse42), nullptr, nullptr);
+
+static void check_value_bytes(unsigned int value_bytes)
+{
+    if(value_bytes != 1 && value_bytes != 2 && value_bytes != 4 && value_bytes != 8)
+        throw invalid_argument("values of " + to_string(value_bytes) + " bytes: 1, 2, 4 or 8 expected");
+}
+
+char* format_binary(const void* values, size_t count, unsigned int value_bytes,
+                    unsigned int digits, char separator, char* out)
+{
+    check_value_bytes(value_bytes);
+    if(digits > max_binary_digits)
+        throw invalid_argument(to_string(digits) + " binary digits: at most 64");
+    return binary_kernel(values, count, value_bytes, digits, separator, out);
+}
+
+char* format_hex(const void* values, size_t count, unsigned int value_bytes,
+                 unsigned int digits, char separator, bool upper_case, char* out)
+{
+    check_value_bytes(value_bytes);
+    if(digits > max_hex_digits)
+        throw invalid_argument(to_string(digits) + " hex digits: at most 16");
+    return hex_kernel(values, count, value_bytes, digits, separator, upper_case ? hex_upper : hex_lower, out);
+}
+
+void demo_int_format()
+{
+    demo_out() << endl << "************* Integer format *************" << endl;
+
+    // Straight into a buffer, no stream or bitset on the way
+    char text[80];
+    demo_out() << "uint8_t 106 : " << string(text, format_binary(uint8_t(106), text)) << endl;
+    demo_out() << "int8_t -73  : " << string(text, format_binary(int8_t(-73), text)) << endl;
+    demo_out() << "Low 12 bits of 3000 : " << string(text, format_binary(3000, text, 12)) << endl;
+    demo_out() << "0xbeef on 8 digits  : " << string(text, format_hex(0xbeef, text, 8)) << endl;
+    demo_out() << "int -1 in hex       : " << to_hex_string(-1) << endl;
+
+    // A hash, FNV-1a of the program name
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(char c : string("DemoCpp11"))
+        hash = (hash ^ uint8_t(c)) * 0x100000001b3ull;
+    demo_out() << "Hash : " << to_hex_string(hash, 16, true) << endl;
+
+    // Whole arrays: a small bitmap, one row per line, and a hex dump
+    const uint16_t glyph[] = {0x0180, 0x03c0, 0x07e0, 0x0db0, 0x1ff8, 0x0240, 0x05a0, 0x0a50};
+    char rows[8 * 17];
+    char* end = format_binary(glyph, 8, '\n', rows);
+    demo_out() << string(rows, end) << endl;
+    const string bytes = "DemoCpp11";
+    end = format_hex(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), ' ', text);
+    demo_out() << "Hex dump of \"" << bytes << "\" : " << string(text, end) << endl;
+
+    try
+    {
+        format_binary(&hash, 1, 3, 24, '\0', text);
+    }
+    catch(invalid_argument const& e)
+    {
+        demo_out() << "Error : " << e.what() << endl;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef _INT_FORMAT_H_
+#define _INT_FORMAT_H_
+
+#include <cstddef> // for size_t
+#include <string>
+#include <type_traits> // for is_integral
+
+/// Integer formatting demo: bitmaps and hashes dumped in binary and hex
+void demo_int_format();
+
+/// Largest number of digits of one value
+const unsigned int max_binary_digits = 64;
+const unsigned int max_hex_digits = 16;
+
+// Fixed-width, zero-padded text of integers of 1, 2, 4 or 8 bytes, written
+// straight to a caller buffer, most significant digit first and without a
+// terminating zero. A value gets its low `digits` digits: fewer than its
+// width drops the high ones, more pads with zeros. Signed values are
+// written as their two's complement bits. The kernels use lookup tables
+// of the bytes (binary) and nibbles (hex), then SSSE3 and AVX2 expansion
+// of whole bytes into characters (see cpu_features.h).
+
+/// Writes the count values of value_bytes each at values, separated by
+/// separator unless it is '\0'. Returns the end of the text:
+/// out + count * digits + (count - 1) separators. Throws std::invalid_argument
+/// for another size of value, or more digits than max_binary_digits.
+char* format_binary(const void* values, size_t count, unsigned int value_bytes,
+                    unsigned int digits, char separator, char* out);
+
+/// Same, with hex digits; at most max_hex_digits
+char* format_hex(const void* values, size_t count, unsigned int value_bytes,
+                 unsigned int digits, char separator, bool upper_case, char* out);
+
+/// One value, by default as wide as its type
+template<typename T>
+char* format_binary(T value, char* out, unsigned int digits = 8 * sizeof(T))
+{
+    static_assert(std::is_integral<T>::value, "integers only");
+    return format_binary(&value, 1, sizeof(T), digits, '\0', out);
+}
+
+template<typename T>
+char* format_hex(T value, char* out, unsigned int digits = 2 * sizeof(T), bool upper_case = false)
+{
+    static_assert(std::is_integral<T>::value, "integers only");
+    return format_hex(&value, 1, sizeof(T), digits, '\0', upper_case, out);
+}
+
+/// Whole arrays, each value as wide as its type
+template<typename T>
+char* format_binary(const T* values, size_t count, char separator, char* out)
+{
+    static_assert(std::is_integral<T>::value, "integers only");
+    return format_binary(values, count, sizeof(T), 8 * sizeof(T), separator, out);
+}
+
+template<typename T>
+char* format_hex(const T* values, size_t count, char separator, char* out, bool upper_case = false)
+{
+    static_assert(std::is_integral<T>::value, "integers only");
+    return format_hex(values, count, sizeof(T), 2 * sizeof(T), separator, upper_case, out);
+}
+
+/// As strings, e.g. to stream them
+template<typename T>
+std::string to_binary_string(T value, unsigned int digits = 8 * sizeof(T))
+{
+    std::string text(digits, '0');
+    format_binary(value, &text[0], digits);
+    return text;
+}
+
+template<typename T>
+std::string to_hex_string(T value, unsigned int digits = 2 * sizeof(T), bool upper_case = false)
+{
+    std::string text(digits, '0');
+    format_hex(value, &text[0], digits, upper_case);
+    return text;
+}
+
+#endif /* _INT_FORMAT_H_ */
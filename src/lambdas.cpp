@@ -1,4 +1,9 @@
 #include "lambdas.h"
+#include "demo_output.h"
+#include "latency.h"
+#include "lookup_tables.h"
+#include "perf_counters.h"
+#include "stats_counters.h"
 #include <algorithm>
 #include <functional>
 #include <iostream>
@@ -20,7 +25,7 @@ void test_functor(void (*pStringFunc)(const string&), const std::string& name)
 
 void test_functor(double (*pBinaryOp)(double, double), double a, double b)
 {
-    cout << "Result of " << a << " / " << b << " is " << pBinaryOp(a, b) << endl;
+    demo_out() << "Result of " << a << " / " << b << " is " << pBinaryOp(a, b) << endl;
 }
 
 class ObjectLambdaTest
@@ -35,32 +40,34 @@ public:
         // Other local variables can be captures by value
         auto objLambda1 = [this, five](){
             _four = 8;
-            cout << _four << " + " << five << " = "
+            demo_out() << _four << " + " << five << " = "
                     << _four + five<< endl;
         };
         objLambda1();
-        cout << "_four is now " << _four << endl;
-        cout << "five is now " << five << endl;
+        demo_out() << "_four is now " << _four << endl;
+        demo_out() << "five is now " << five << endl;
 
         // Local variables can also be captured by reference like so.
         // 'this' can only be captured by value;
         auto objLambda2 = [&, this](){
             _four = 4;
             five = 10;
-            cout << _four << " + " << five << " = "
+            demo_out() << _four << " + " << five << " = "
                     << _four + five<< endl;
         };
         objLambda2();
-        cout << "_four is now " << _four << endl;
-        cout << "five is now " << five << endl;
+        demo_out() << "_four is now " << _four << endl;
+        demo_out() << "five is now " << five << endl;
 
     }
 };
 
 bool is_prime(unsigned int n)
 {
-    if(n < 4)
-        return n >= 2;
+    LATENCY_PROBE("lambdas.is_prime");
+    // One bit of a compile-time table below 2^16
+    if(n < LookupTables::prime_limit)
+        return table_is_prime(n);
     if(n % 2 == 0 || n % 3 == 0)
         return false;
 
@@ -73,33 +80,17 @@ bool is_prime(unsigned int n)
     return true;
 }
 
-template <typename T>
-size_t count_in_list(function<bool(T)> predicate, const list<T> & in_list)
-{
-    // Decorate the predicate using lambda
-    function<bool(T)> predicate_and_print = [predicate](T t) {
-        bool is_valid = predicate(t);
-        if (is_valid)
-            cout << t << " ";
-        return is_valid;
-    };
-    // Apply the decorated predicate using the algorithm
-    size_t total_count = count_if(in_list.begin(), in_list.end(), predicate_and_print);
-    cout << endl;
-    return total_count;
-}
-
 void demo_lambdas()
 {
-    cout << endl << "*************** Lambdas ******************" << endl;
+    demo_out() << endl << "*************** Lambdas ******************" << endl;
 
     // Lambda: Creating, calling and passing as argument
-    auto fn_hello = [](){ cout << "Hello !" << endl; };
+    auto fn_hello = [](){ demo_out() << "Hello !" << endl; };
     fn_hello();
     test_functor(fn_hello);
-    test_functor([](){ cout << "Goodbye !" << endl; });
+    test_functor([](){ demo_out() << "Goodbye !" << endl; });
 
-    auto fn_greet = [](const string& name){ cout << "Hello " << name << endl; };
+    auto fn_greet = [](const string& name){ demo_out() << "Hello " << name << endl; };
     fn_greet("James");
     test_functor(fn_greet, "Katherin");
 
@@ -110,7 +101,7 @@ void demo_lambdas()
             return 0;
         return a/b;
     };
-    cout << fn_divide(10.0, 5.0) << endl;
+    demo_out() << fn_divide(10.0, 5.0) << endl;
     test_functor(fn_divide, 7, 3);
 
     int one = 1;
@@ -118,41 +109,41 @@ void demo_lambdas()
     int three = 3;
 
     // Capture one and two by value; call the lambda directly
-    [one, two]() { cout << one << " + " << two << " = " << one+two << endl; }();
+    [one, two]() { demo_out() << one << " + " << two << " = " << one+two << endl; }();
 
     // Capture all local variables by value
-    [=]() { cout << one << " + " << two << " + " << three << " = "
+    [=]() { demo_out() << one << " + " << two << " + " << three << " = "
         << one+two+three << endl; }();
 
     // Capture all local variables by value, but capture three by reference
     [=, &three]() {
         three = 7;
-        cout << one << " + " << two << " + " << three << " = "
+        demo_out() << one << " + " << two << " + " << three << " = "
             << one+two+three << endl;
     }();
-    cout << "three is now " << three << endl;
+    demo_out() << "three is now " << three << endl;
 
     // Capture all local variables by reference
     [&]() {
         one = 2;
         two = 4;
         three = 6;
-        cout << one << " + " << two << " + " << three << " = "
+        demo_out() << one << " + " << two << " + " << three << " = "
         << one+two+three << endl;
     }();
-    cout << "one is now " << one << endl;
-    cout << "two is now " << two << endl;
-    cout << "three is now " << three << endl;
+    demo_out() << "one is now " << one << endl;
+    demo_out() << "two is now " << two << endl;
+    demo_out() << "three is now " << three << endl;
 
     // Capture all local variables by reference, except for two and three - by reference
     [&, two, three]() {
         one = 3;
         // Will not compile: local variables captured by value
         // two = 6; three = 9;
-        cout << one << " + " << two << " + " << three << " = "
+        demo_out() << one << " + " << two << " + " << three << " = "
         << one+two+three << endl;
     }();
-    cout << "one is now " << one << endl;
+    demo_out() << "one is now " << one << endl;
 
     // Demonstrate the capturing of 'this' inside objects
     ObjectLambdaTest test1;
@@ -162,20 +153,25 @@ void demo_lambdas()
     // Note that the variables that have static storage are
     // available in the body of the lambda as if captured by reference
     list<unsigned int> numbers(40);
-    static unsigned int n = 0;
-    generate(numbers.begin(), numbers.end(), []{ return n++; });
-    cout << "Initial list: " << endl;
+    static StatCounter& n = stat_counter("lambdas.generated");
+    generate(numbers.begin(), numbers.end(), []{ return (unsigned int)n.next(); });
+    demo_out() << "Initial list: " << endl;
     for(unsigned int i : numbers)
     {
-        cout << i << " ";
+        demo_out() << i << " ";
     }
-    cout << endl;
+    demo_out() << endl;
 
     // Filter list of numbers using functor
     bool (*fptr_filter)(unsigned int) = &is_prime;
-    cout << "Filtered list: " << endl;
-    size_t n_primes = count_in_list<unsigned int>(fptr_filter, numbers);
-    cout << "Total prime numbers : " << n_primes << endl;
+    demo_out() << "Filtered list: " << endl;
+    size_t n_primes = 0;
+    {
+        // Node-by-node traversal of the list, through two std::function layers
+        PERF_REGION("lambdas.count_in_list");
+        n_primes = count_in_list<unsigned int>(fptr_filter, numbers);
+    }
+    demo_out() << "Total prime numbers : " << n_primes << endl;
 
     // By default variables captures by value are not modifiable inside the lambda:
     // Does not compile
@@ -188,6 +184,6 @@ void demo_lambdas()
     int counter = 0;
     [&, counter] (int a) mutable { sum = ++counter + a; }(4);
     // Value of counter is unchanged
-    cout << sum << endl << counter << endl;
+    demo_out() << sum << endl << counter << endl;
 
 }
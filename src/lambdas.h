@@ -1,9 +1,40 @@
 #ifndef _LAMBDAS_H_
 #define _LAMBDAS_H_
 
+#include <algorithm> // for count_if
+#include <cstddef> // for size_t
+#include <functional>
+#include <list>
+#include "demo_output.h"
+#include "stats_counters.h"
+#include "trace.h"
+
 // Use of lambdas and function objects in modern C++
 // [](), std::function
 void demo_lambdas();
 
+// Primality test by trial division with the divisors 6k-1 and 6k+1
+bool is_prime(unsigned int n);
+
+// Counts the elements of the list that verify the predicate,
+// printing each of them
+template <typename T>
+size_t count_in_list(std::function<bool(T)> predicate, const std::list<T> & in_list)
+{
+    TRACE_SPAN("lambdas.count_in_list");
+    STAT_ADD("lambdas.count_in_list.elements", in_list.size());
+    // Decorate the predicate using lambda
+    std::function<bool(T)> predicate_and_print = [predicate](T t) {
+        bool is_valid = predicate(t);
+        if (is_valid)
+            demo_out() << t << " ";
+        return is_valid;
+    };
+    // Apply the decorated predicate using the algorithm
+    size_t total_count = std::count_if(in_list.begin(), in_list.end(), predicate_and_print);
+    demo_out() << std::endl;
+    return total_count;
+}
+
 
 #endif /* _LAMBDAS_H_ */
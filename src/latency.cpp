@@ -0,0 +1,137 @@
+#include "latency.h"
+#include <algorithm> // for sort, min
+#include <cstdlib> // for malloc
+#include <memory> // for unique_ptr
+#include <new> // for placement new
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram()
+{
+    for(auto& c : _counts)
+        c.store(0, memory_order_relaxed);
+    _count.store(0, memory_order_relaxed);
+    _sum.store(0, memory_order_relaxed);
+    _max.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t bucket)
+{
+    if(bucket < sub_buckets)
+        return bucket;
+    unsigned int shift = bucket / sub_buckets - 1;
+    uint64_t lowest = uint64_t(bucket % sub_buckets + sub_buckets) << shift;
+    return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for(size_t i = 0; i < bucket_count; ++i)
+        bump(_counts[i], other._counts[i].load(memory_order_relaxed));
+    bump(_count, other.count());
+    bump(_sum, other.sum());
+    if(other.max() > max())
+        _max.store(other.max(), memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double pct) const
+{
+    uint64_t total = count();
+    if(total == 0)
+        return 0;
+    // Rank of the record, from 1; e.g. the p50 of 2 records is the first one
+    uint64_t rank = uint64_t(pct / 100 * total + 0.5);
+    rank = min(total, std::max<uint64_t>(rank, 1));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < bucket_count; ++i)
+    {
+        seen += _counts[i].load(memory_order_relaxed);
+        if(seen >= rank)
+            return min(bucket_upper(i), max());
+    }
+    return max();
+}
+
+atomic<bool> latency_probes_on(false);
+
+void enable_latency_probes()
+{
+    latency_probes_on = true;
+}
+
+// Probes, numbered in the order of their first call
+static const size_t max_probes = 64;
+static atomic<const char*> probe_names[max_probes];
+static atomic<size_t> registered_probes(0);
+
+// Histograms of all the threads, in a list pushed to without locking.
+// They are allocated with malloc, not operator new, so that they do not
+// show in the allocations of the demos (see alloc_tracker.h), and never
+// freed, since they are read after their thread ended.
+struct ThreadHistogram
+{
+    size_t probe;
+    ThreadHistogram* next;
+    LatencyHistogram histogram;
+};
+
+static atomic<ThreadHistogram*> all_histograms(nullptr);
+static thread_local LatencyHistogram* thread_histograms[max_probes];
+
+LatencyProbe::LatencyProbe(const char* name)
+:_index(registered_probes.fetch_add(1))
+{
+    if(_index < max_probes)
+        probe_names[_index].store(name, memory_order_release);
+}
+
+LatencyHistogram* LatencyProbe::local()
+{
+    if(_index >= max_probes)
+        return nullptr;
+    LatencyHistogram* histogram = thread_histograms[_index];
+    if(histogram)
+        return histogram;
+    void* memory = malloc(sizeof(ThreadHistogram));
+    if(!memory)
+        return nullptr;
+    ThreadHistogram* node = new (memory) ThreadHistogram;
+    node->probe = _index;
+    node->next = all_histograms.load(memory_order_relaxed);
+    while(!all_histograms.compare_exchange_weak(node->next, node, memory_order_release))
+        ;
+    return thread_histograms[_index] = &node->histogram;
+}
+
+vector<LatencySummary> latency_summaries()
+{
+    size_t probes = min(registered_probes.load(), max_probes);
+    vector<unique_ptr<LatencyHistogram>> merged(probes);
+    for(auto& m : merged)
+        m.reset(new LatencyHistogram);
+    for(ThreadHistogram* node = all_histograms.load(memory_order_acquire); node; node = node->next)
+        merged[node->probe]->merge(node->histogram);
+
+    double ns_per_tick = trace_ns_per_tick();
+    vector<LatencySummary> summaries;
+    for(size_t i = 0; i < probes; ++i)
+    {
+        const LatencyHistogram& h = *merged[i];
+        if(h.count())
+        {
+            LatencySummary s;
+            s.name = probe_names[i].load(memory_order_acquire);
+            s.count = h.count();
+            s.mean_ns = ns_per_tick * h.sum() / h.count();
+            s.p50_ns = ns_per_tick * h.percentile(50);
+            s.p99_ns = ns_per_tick * h.percentile(99);
+            s.p999_ns = ns_per_tick * h.percentile(99.9);
+            s.max_ns = ns_per_tick * h.max();
+            summaries.push_back(s);
+        }
+    }
+    sort(summaries.begin(), summaries.end(), [](const LatencySummary& a, const LatencySummary& b) {
+        return a.name < b.name;
+    });
+    return summaries;
+}
@@ -0,0 +1,138 @@
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <atomic>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <string>
+#include <vector>
+#include "trace.h" // for trace_ticks
+
+/// Log-linear (HDR) histogram: exact below 2^precision_bits, then each
+/// power of two is split in 2^precision_bits buckets, so that any value
+/// is known within 1/2^precision_bits (3%) over the whole 64-bit range.
+/// One thread records, any thread reads: the counts are atomics
+/// updated with relaxed loads and stores, without locked instructions.
+class LatencyHistogram
+{
+public:
+    static const unsigned int precision_bits = 5;
+    static const size_t sub_buckets = size_t(1) << precision_bits;
+    static const size_t bucket_count = (64 - precision_bits + 1) * sub_buckets;
+
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    static size_t bucket_of(uint64_t value)
+    {
+        if(value < sub_buckets)
+            return size_t(value);
+        unsigned int exponent = 63 - __builtin_clzll(value);
+        unsigned int shift = exponent - precision_bits;
+        return (shift + 1) * sub_buckets + (size_t(value >> shift) - sub_buckets);
+    }
+    /// Highest value falling in the bucket
+    static uint64_t bucket_upper(size_t bucket);
+
+    /// Single writer: the thread owning the histogram
+    void record(uint64_t value)
+    {
+        bump(_counts[bucket_of(value)], 1);
+        bump(_count, 1);
+        bump(_sum, value);
+        if(value > _max.load(std::memory_order_relaxed))
+            _max.store(value, std::memory_order_relaxed);
+    }
+
+    /// Adds the records of the other histogram; single writer too
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+    uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+    /// Value that pct percent of the records do not exceed (0 < pct <= 100),
+    /// as the upper bound of its bucket, but at most max()
+    uint64_t percentile(double pct) const;
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> _counts[bucket_count];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+    std::atomic<uint64_t> _max;
+};
+
+/// Set by enable_latency_probes; read by every probe
+extern std::atomic<bool> latency_probes_on;
+
+/// Switches the probes on for the whole program. Off by default, in which
+/// case a LATENCY_PROBE costs a predictable branch on entry and on exit.
+void enable_latency_probes();
+inline bool latency_probes_enabled() { return latency_probes_on.load(std::memory_order_relaxed); }
+
+/// Named probe, with one histogram per thread that records through it.
+/// The histograms are merged by latency_summaries.
+class LatencyProbe
+{
+public:
+    /// The name must outlive the program, e.g. a literal
+    explicit LatencyProbe(const char* name);
+    LatencyProbe(const LatencyProbe&) = delete;
+    LatencyProbe& operator=(const LatencyProbe&) = delete;
+    /// Histogram of the calling thread; nullptr beyond the supported probes
+    LatencyHistogram* local();
+private:
+    size_t _index;
+};
+
+/// Records the time from construction to destruction of the object, in ticks
+class LatencyTimer
+{
+public:
+    explicit LatencyTimer(LatencyProbe& probe)
+    :_probe(probe), _start(latency_probes_enabled() ? trace_ticks() : 0)
+    {}
+    ~LatencyTimer()
+    {
+        if(_start)
+        {
+            uint64_t elapsed = trace_ticks() - _start;
+            if(LatencyHistogram* histogram = _probe.local())
+                histogram->record(elapsed);
+        }
+    }
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+private:
+    LatencyProbe& _probe;
+    uint64_t _start;
+};
+
+/// Distribution of the latencies of one probe, over all the threads
+struct LatencySummary
+{
+    std::string name;
+    uint64_t count = 0;
+    double mean_ns = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double p999_ns = 0;
+    double max_ns = 0;
+};
+
+/// Summaries of the probes recorded so far, sorted by name
+std::vector<LatencySummary> latency_summaries();
+
+#define LATENCY_CONCAT_(a, b) a##b
+#define LATENCY_CONCAT(a, b) LATENCY_CONCAT_(a, b)
+/// Records the latency of the rest of the enclosing scope under the given name
+#define LATENCY_PROBE(name) \
+    static LatencyProbe LATENCY_CONCAT(latency_probe_, __LINE__)(name); \
+    LatencyTimer LATENCY_CONCAT(latency_timer_, __LINE__)(LATENCY_CONCAT(latency_probe_, __LINE__))
+
+#endif /* _LATENCY_H_ */
@@ -0,0 +1,127 @@
+#include "lifecycle_probe.h"
+#include <cstdlib> // for malloc, free
+#include <cstring> // for memcpy, strlen
+#include <iostream>
+#include <new> // for bad_alloc
+#include <cxxabi.h> // for __cxa_demangle
+
+using namespace std;
+
+thread_local uint64_t lifecycle_thread_counts[nLifecycleEvents];
+
+const char* to_string(Lifecycle event)
+{
+    switch(event)
+    {
+    case Lifecycle::Construction: return "constructions";
+    case Lifecycle::Copy: return "copies";
+    case Lifecycle::Move: return "moves";
+    case Lifecycle::CopyAssignment: return "copy_assignments";
+    case Lifecycle::MoveAssignment: return "move_assignments";
+    case Lifecycle::Destruction: return "destructions";
+    default: return "unknown";
+    }
+}
+
+// The counter names are built at run time, while the registry keeps
+// pointers to them: they are kept for the lifetime of the program. They
+// and the arrays of counters of the types are allocated with malloc, not
+// operator new, so that they do not show in the allocations of the demos
+// that first use a probed type (see alloc_tracker.h).
+
+// Counter "lifecycle.<name>.<event>"
+static StatCounter* counter_for(const char* name, Lifecycle event)
+{
+    static const char prefix[] = "lifecycle.";
+    const char* suffix = to_string(event);
+    size_t name_size = strlen(name), suffix_size = strlen(suffix);
+    char* full_name = static_cast<char*>(malloc(sizeof(prefix) + name_size + 1 + suffix_size));
+    if(!full_name)
+        throw bad_alloc();
+    memcpy(full_name, prefix, sizeof(prefix) - 1);
+    memcpy(full_name + sizeof(prefix) - 1, name, name_size);
+    full_name[sizeof(prefix) - 1 + name_size] = '.';
+    memcpy(full_name + sizeof(prefix) + name_size, suffix, suffix_size + 1);
+    StatCounter& counter = stat_counter(full_name);
+    // The counter existed, under a name kept by an earlier call
+    if(counter.name() != full_name)
+        free(full_name);
+    return &counter;
+}
+
+static void make_counters(const char* name, StatCounter** counters)
+{
+    for(unsigned int i = 0; i < nLifecycleEvents; ++i)
+        counters[i] = counter_for(name, Lifecycle(i));
+}
+
+StatCounter* const* lifecycle_type_counters(const type_info& type)
+{
+    StatCounter** counters = static_cast<StatCounter**>(malloc(nLifecycleEvents * sizeof(StatCounter*)));
+    if(!counters)
+        throw bad_alloc();
+    // Allocated with malloc too
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    make_counters(status == 0 ? demangled : type.name(), counters);
+    free(demangled);
+    return counters;
+}
+
+LifecycleSiteCounters::LifecycleSiteCounters(const char* site)
+{
+    make_counters(site, counters);
+}
+
+LifecycleSite::LifecycleSite(LifecycleSiteCounters& site)
+:_site(site)
+{
+    for(unsigned int i = 0; i < nLifecycleEvents; ++i)
+        _start[i] = lifecycle_thread_counts[i];
+}
+
+LifecycleSite::~LifecycleSite()
+{
+    for(unsigned int i = 0; i < nLifecycleEvents; ++i)
+    {
+        uint64_t n = lifecycle_thread_counts[i] - _start[i];
+        if(n)
+            _site.counters[i]->add(n);
+    }
+}
+
+LifecycleExpectation::LifecycleExpectation(const char* what, const char* file, int line,
+    unsigned int events, uint64_t max_count)
+:_what(what), _file(file), _line(line), _events(events), _max_count(max_count), _start(0)
+{
+    _start = count();
+}
+
+uint64_t LifecycleExpectation::count() const
+{
+    uint64_t total = 0;
+    for(unsigned int i = 0; i < nLifecycleEvents; ++i)
+        if(_events & (1u << i))
+            total += lifecycle_thread_counts[i];
+    return total;
+}
+
+static StatCounter& violations_counter()
+{
+    static StatCounter& counter = stat_counter("lifecycle.violations");
+    return counter;
+}
+
+LifecycleExpectation::~LifecycleExpectation()
+{
+    uint64_t n = count() - _start;
+    if(n <= _max_count)
+        return;
+    violations_counter().add();
+    cerr << _file << ':' << _line << ": expected " << _what << ", got " << n << endl;
+}
+
+uint64_t lifecycle_violations()
+{
+    return violations_counter().total();
+}
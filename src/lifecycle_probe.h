@@ -0,0 +1,138 @@
+#ifndef _LIFECYCLE_PROBE_H_
+#define _LIFECYCLE_PROBE_H_
+
+#include <cstdint> // for uint64_t
+#include <typeinfo>
+#include "stats_counters.h"
+
+// Counts the special member function calls of the probed types, to catch
+// accidental copies: a type derives from LifecycleProbe<itself>, or holds
+// one as its last member when it must stay an aggregate. The counts go to
+// the statistics counters "lifecycle.<type>.<event>" (see stats_counters.h),
+// to the counters of the enclosing LIFECYCLE_SITE, and are checked by the
+// EXPECT_ macros below.
+
+/// What happened to an object
+enum class Lifecycle : unsigned int
+{
+    Construction = 0,   ///< any constructor but copy and move
+    Copy,
+    Move,
+    CopyAssignment,
+    MoveAssignment,
+    Destruction,
+    NumEvents // must be the last element
+};
+
+constexpr unsigned int nLifecycleEvents = static_cast<unsigned int>(Lifecycle::NumEvents);
+
+/// Name of the event in the counters, e.g. "copy_assignments"
+const char* to_string(Lifecycle event);
+
+/// Counters of the events of the type, created on first call
+StatCounter* const* lifecycle_type_counters(const std::type_info& type);
+
+/// Counts of the calling thread, over all the probed types
+extern thread_local uint64_t lifecycle_thread_counts[nLifecycleEvents];
+
+inline void lifecycle_record(StatCounter* const* counters, Lifecycle event)
+{
+    unsigned int e = static_cast<unsigned int>(event);
+    counters[e]->add();
+    ++lifecycle_thread_counts[e];
+}
+
+/// Base or member recording the lifecycle of the objects of T.
+/// A user-defined copy or move constructor of T must pass the other
+/// object on to it, like for any base, or the copy is counted as a construction.
+template<typename T>
+class LifecycleProbe
+{
+public:
+    LifecycleProbe() { record(Lifecycle::Construction); }
+    LifecycleProbe(const LifecycleProbe&) { record(Lifecycle::Copy); }
+    LifecycleProbe(LifecycleProbe&&) noexcept { record(Lifecycle::Move); }
+    LifecycleProbe& operator=(const LifecycleProbe&) { record(Lifecycle::CopyAssignment); return *this; }
+    LifecycleProbe& operator=(LifecycleProbe&&) noexcept { record(Lifecycle::MoveAssignment); return *this; }
+    ~LifecycleProbe() { record(Lifecycle::Destruction); }
+
+private:
+    static void record(Lifecycle event)
+    {
+        static StatCounter* const* counters = lifecycle_type_counters(typeid(T));
+        lifecycle_record(counters, event);
+    }
+};
+
+/// Counters "lifecycle.<site>.<event>" of one call site
+class LifecycleSiteCounters
+{
+public:
+    /// The name must outlive the program, e.g. a literal
+    explicit LifecycleSiteCounters(const char* site);
+    StatCounter* counters[nLifecycleEvents];
+};
+
+/// Adds the events of the calling thread, from construction to destruction,
+/// to the counters of the site
+class LifecycleSite
+{
+public:
+    explicit LifecycleSite(LifecycleSiteCounters& site);
+    ~LifecycleSite();
+    LifecycleSite(const LifecycleSite&) = delete;
+    LifecycleSite& operator=(const LifecycleSite&) = delete;
+private:
+    LifecycleSiteCounters& _site;
+    uint64_t _start[nLifecycleEvents];
+};
+
+/// Bit of the event in the masks of LifecycleExpectation
+constexpr unsigned int lifecycle_mask(Lifecycle event)
+{
+    return 1u << static_cast<unsigned int>(event);
+}
+
+/// Checks, when it is destroyed, that the calling thread recorded at most
+/// max_count of the given events since it was constructed. A violation is
+/// printed to std::cerr and counted in "lifecycle.violations".
+class LifecycleExpectation
+{
+public:
+    LifecycleExpectation(const char* what, const char* file, int line,
+        unsigned int events, uint64_t max_count);
+    ~LifecycleExpectation();
+    LifecycleExpectation(const LifecycleExpectation&) = delete;
+    LifecycleExpectation& operator=(const LifecycleExpectation&) = delete;
+private:
+    uint64_t count() const;
+    const char* _what;
+    const char* _file;
+    int _line;
+    unsigned int _events;
+    uint64_t _max_count;
+    uint64_t _start;
+};
+
+/// Number of violated expectations so far, over all the threads
+uint64_t lifecycle_violations();
+
+#define LIFECYCLE_CONCAT_(a, b) a##b
+#define LIFECYCLE_CONCAT(a, b) LIFECYCLE_CONCAT_(a, b)
+
+/// Attributes the events of the rest of the enclosing scope to the named site
+#define LIFECYCLE_SITE(name) \
+    static LifecycleSiteCounters LIFECYCLE_CONCAT(lifecycle_site_counters_, __LINE__)(name); \
+    LifecycleSite LIFECYCLE_CONCAT(lifecycle_site_, __LINE__)(LIFECYCLE_CONCAT(lifecycle_site_counters_, __LINE__))
+
+/// The rest of the enclosing scope copies no probed object (construction or assignment)
+#define EXPECT_NO_COPIES() \
+    LifecycleExpectation LIFECYCLE_CONCAT(lifecycle_expectation_, __LINE__)("no copies", \
+        __FILE__, __LINE__, lifecycle_mask(Lifecycle::Copy) | lifecycle_mask(Lifecycle::CopyAssignment), 0)
+
+/// The rest of the enclosing scope performs at most n moves (construction or assignment)
+#define EXPECT_AT_MOST_MOVES(n) \
+    LifecycleExpectation LIFECYCLE_CONCAT(lifecycle_expectation_, __LINE__)("at most " #n " moves", \
+        __FILE__, __LINE__, lifecycle_mask(Lifecycle::Move) | lifecycle_mask(Lifecycle::MoveAssignment), n)
+
+#endif /* _LIFECYCLE_PROBE_H_ */
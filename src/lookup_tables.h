@@ -0,0 +1,119 @@
+#ifndef _LOOKUP_TABLES_H_
+#define _LOOKUP_TABLES_H_
+
+#include <array>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t, uint8_t
+#include <utility> // for index_sequence
+#include "bit_ops.h"
+
+// Lookup tables computed at compile time, for the numeric kernels whose
+// result over a small domain is cheaper to load than to compute.
+
+template<typename T, size_t N, typename Generator, size_t... I>
+constexpr std::array<T, N> make_table(Generator generate, std::index_sequence<I...>)
+{
+    return {{T(generate(I))...}};
+}
+
+/// Table of the N values generate(0) ... generate(N - 1), e.g.
+/// constexpr auto squares = make_table<unsigned int, 256>(square);
+/// The generator is a function, or an object with a constexpr operator()
+/// (C++14 lambdas are not constexpr). Each value is computed on its own,
+/// through a pack expansion rather than a recursion, so N is bounded by the
+/// constexpr operation limits of the compiler, not by its recursion depth.
+/// A constexpr table is data in .rodata: no code runs at startup, and a
+/// lookup is one indexed load.
+template<typename T, size_t N, typename Generator>
+constexpr std::array<T, N> make_table(Generator generate)
+{
+    return make_table<T, N>(generate, std::make_index_sequence<N>());
+}
+
+// Generators of the ready tables
+
+constexpr uint8_t byte_popcount_entry(size_t byte) { return uint8_t(bit_count(uint8_t(byte))); }
+constexpr uint8_t byte_reverse_entry(size_t byte) { return bit_reverse(uint8_t(byte)); }
+
+/// Integer square root, one bit of the root at a time from the highest
+constexpr uint8_t isqrt_entry(size_t n)
+{
+    unsigned int root = 0;
+    for(unsigned int bit = 1u << 7; bit != 0; bit >>= 1)
+        if((root | bit) * (root | bit) <= n)
+            root |= bit;
+    return uint8_t(root);
+}
+
+/// Bit i of word w: whether 64 * w + i is prime, by trial division by 6k +- 1
+constexpr uint64_t prime_bits_entry(size_t word)
+{
+    uint64_t bits = 0;
+    for(unsigned int i = 0; i < 64; ++i)
+    {
+        uint64_t n = 64 * word + i;
+        bool prime = n >= 2 && (n < 4 || (n % 2 != 0 && n % 3 != 0));
+        for(uint64_t d = 5; prime && d * d <= n; d += 6)
+            prime = n % d != 0 && n % (d + 2) != 0;
+        bits |= uint64_t(prime) << i;
+    }
+    return bits;
+}
+
+/// The ready tables. Static members of a class template: one definition of
+/// each in the program, whatever the number of translation units using it,
+/// and usable in constant expressions.
+template<typename Unused = void>
+struct LookupTablesOf
+{
+    static const size_t isqrt_size = size_t(1) << 12;
+    static const size_t prime_limit = size_t(1) << 16;
+
+    static constexpr std::array<uint8_t, 256> byte_popcount = make_table<uint8_t, 256>(byte_popcount_entry);
+    static constexpr std::array<uint8_t, 256> byte_reverse = make_table<uint8_t, 256>(byte_reverse_entry);
+    static constexpr std::array<uint8_t, isqrt_size> isqrt = make_table<uint8_t, isqrt_size>(isqrt_entry);
+    /// 8 KiB: one bit per integer
+    static constexpr std::array<uint64_t, prime_limit / 64> prime_bits =
+        make_table<uint64_t, prime_limit / 64>(prime_bits_entry);
+};
+
+template<typename Unused>
+const size_t LookupTablesOf<Unused>::isqrt_size;
+template<typename Unused>
+const size_t LookupTablesOf<Unused>::prime_limit;
+template<typename Unused>
+constexpr std::array<uint8_t, 256> LookupTablesOf<Unused>::byte_popcount;
+template<typename Unused>
+constexpr std::array<uint8_t, 256> LookupTablesOf<Unused>::byte_reverse;
+template<typename Unused>
+constexpr std::array<uint8_t, LookupTablesOf<Unused>::isqrt_size> LookupTablesOf<Unused>::isqrt;
+template<typename Unused>
+constexpr std::array<uint64_t, LookupTablesOf<Unused>::prime_limit / 64> LookupTablesOf<Unused>::prime_bits;
+
+typedef LookupTablesOf<> LookupTables;
+
+/// Number of set bits of a byte
+constexpr unsigned int table_popcount(uint8_t byte)
+{
+    return LookupTables::byte_popcount[byte];
+}
+
+/// Bits of a byte in reverse order
+constexpr uint8_t table_bit_reverse(uint8_t byte)
+{
+    return LookupTables::byte_reverse[byte];
+}
+
+/// Integer square root of n < LookupTables::isqrt_size
+constexpr unsigned int table_isqrt(size_t n)
+{
+    return LookupTables::isqrt[n];
+}
+
+/// Whether n < LookupTables::prime_limit is prime
+constexpr bool table_is_prime(size_t n)
+{
+    return (LookupTables::prime_bits[n / 64] >> (n % 64)) & 1;
+}
+
+#endif /* _LOOKUP_TABLES_H_ */
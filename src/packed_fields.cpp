@@ -0,0 +1,312 @@
+#include <algorithm> // for min
+#include <bitset>
+#include <cstring> // for memcpy
+#include <iostream>
+#include <vector>
+#include "packed_fields.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+
+using namespace std;
+
+const unsigned int PackedLayout::max_fields;
+
+// Batch kernels, one variant per instruction set. Each loop is a template
+// on the lane type, and the variant of each level picks the loop of the
+// layout's lanes once per call.
+
+// Calls Loop<Lane>::run(args...)
+template<template<typename> class Loop, typename... Args>
+static void dispatch(const PackedLayout& layout, Args... args)
+{
+    switch(layout.lane_bytes)
+    {
+    case 1: Loop<uint8_t>::run(layout, args...); break;
+    case 2: Loop<uint16_t>::run(layout, args...); break;
+    case 4: Loop<uint32_t>::run(layout, args...); break;
+    default: Loop<uint64_t>::run(layout, args...); break;
+    }
+}
+
+// Baseline: one shift and one mask per field
+template<typename Lane>
+struct PackScalar
+{
+    static void run(const PackedLayout& layout, const void* records, size_t n, uint64_t* words)
+    {
+        const Lane* values = static_cast<const Lane*>(records);
+        for(size_t r = 0; r < n; ++r, values += layout.field_count)
+        {
+            uint64_t word = 0;
+            for(unsigned int f = 0; f < layout.field_count; ++f)
+                word |= (uint64_t(values[f]) & layout.masks[f]) << layout.offsets[f];
+            words[r] = word;
+        }
+    }
+};
+
+template<typename Lane>
+struct UnpackScalar
+{
+    static void run(const PackedLayout& layout, const uint64_t* words, size_t n, void* records)
+    {
+        Lane* values = static_cast<Lane*>(records);
+        for(size_t r = 0; r < n; ++r, values += layout.field_count)
+        {
+            for(unsigned int f = 0; f < layout.field_count; ++f)
+                values[f] = Lane((words[r] >> layout.offsets[f]) & layout.masks[f]);
+        }
+    }
+};
+
+template<typename Lane>
+struct UnpackColumnsScalar
+{
+    static void run(const PackedLayout& layout, const uint64_t* words, size_t n, void* const* columns)
+    {
+        for(size_t r = 0; r < n; ++r)
+        {
+            for(unsigned int f = 0; f < layout.field_count; ++f)
+            {
+                if(columns[f])
+                    static_cast<Lane*>(columns[f])[r] = Lane((words[r] >> layout.offsets[f]) & layout.masks[f]);
+            }
+        }
+    }
+};
+
+static void pack_scalar(const PackedLayout& layout, const void* records, size_t n, uint64_t* words)
+{
+    dispatch<PackScalar>(layout, records, n, words);
+}
+
+static void unpack_scalar(const PackedLayout& layout, const uint64_t* words, size_t n, void* records)
+{
+    dispatch<UnpackScalar>(layout, words, n, records);
+}
+
+static void unpack_columns_scalar(const PackedLayout& layout, const uint64_t* words, size_t n, void* const* columns)
+{
+    dispatch<UnpackColumnsScalar>(layout, words, n, columns);
+}
+
+#ifdef HAS_X86_KERNELS
+// Records whose chunks can be read or written whole: a partial last chunk
+// overlaps the records after it, so the last records, as many as it
+// overlaps, go through the scalar loop
+static size_t whole_chunk_records(const PackedLayout& layout, size_t n)
+{
+    size_t record_bytes = layout.field_count * layout.lane_bytes;
+    size_t overlapped = (layout.chunk_count * 8 - record_bytes + record_bytes - 1) / record_bytes;
+    return n > overlapped ? n - overlapped : 0;
+}
+
+// One PEXT per 64-bit chunk of the record: it gathers the low bits of
+// each lane next to each other, in the order of the fields. The part of
+// a partial chunk past the record is not in its mask.
+template<typename Lane>
+struct PackAVX2
+{
+    __attribute__((target("bmi,bmi2")))
+    static void run(const PackedLayout& layout, const void* records, size_t n, uint64_t* words)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(records);
+        size_t record_bytes = layout.field_count * sizeof(Lane);
+        size_t whole = whole_chunk_records(layout, n);
+        for(size_t r = 0; r < whole; ++r, bytes += record_bytes)
+        {
+            uint64_t word = 0;
+            for(unsigned int c = 0; c < layout.chunk_count; ++c)
+            {
+                uint64_t chunk;
+                memcpy(&chunk, bytes + 8 * c, sizeof(chunk));
+                word |= _pext_u64(chunk, layout.chunk_masks[c]) << layout.chunk_offsets[c];
+            }
+            words[r] = word;
+        }
+        PackScalar<Lane>::run(layout, bytes, n - whole, words + whole);
+    }
+};
+
+// One PDEP per chunk, spreading the fields back to their lanes. The part
+// of a partial chunk past the record is written with zeros, then with the
+// next record.
+template<typename Lane>
+struct UnpackAVX2
+{
+    __attribute__((target("bmi,bmi2")))
+    static void run(const PackedLayout& layout, const uint64_t* words, size_t n, void* records)
+    {
+        uint8_t* bytes = static_cast<uint8_t*>(records);
+        size_t record_bytes = layout.field_count * sizeof(Lane);
+        size_t whole = whole_chunk_records(layout, n);
+        for(size_t r = 0; r < whole; ++r, bytes += record_bytes)
+        {
+            for(unsigned int c = 0; c < layout.chunk_count; ++c)
+            {
+                uint64_t chunk = _pdep_u64(words[r] >> layout.chunk_offsets[c], layout.chunk_masks[c]);
+                memcpy(bytes + 8 * c, &chunk, sizeof(chunk));
+            }
+        }
+        UnpackScalar<Lane>::run(layout, words + whole, n - whole, bytes);
+    }
+};
+
+__attribute__((target("bmi,bmi2")))
+static void pack_avx2(const PackedLayout& layout, const void* records, size_t n, uint64_t* words)
+{
+    dispatch<PackAVX2>(layout, records, n, words);
+}
+
+__attribute__((target("bmi,bmi2")))
+static void unpack_avx2(const PackedLayout& layout, const uint64_t* words, size_t n, void* records)
+{
+    dispatch<UnpackAVX2>(layout, words, n, records);
+}
+
+BEGIN_AVX512_KERNELS
+// Stores the selected 64-bit lanes of v, narrowed to the column type
+__attribute__((target("avx512f")))
+static inline void store_lanes(uint8_t* p, __mmask8 lanes, __m512i v) { _mm512_mask_cvtepi64_storeu_epi8(p, lanes, v); }
+__attribute__((target("avx512f")))
+static inline void store_lanes(uint16_t* p, __mmask8 lanes, __m512i v) { _mm512_mask_cvtepi64_storeu_epi16(p, lanes, v); }
+__attribute__((target("avx512f")))
+static inline void store_lanes(uint32_t* p, __mmask8 lanes, __m512i v) { _mm512_mask_cvtepi64_storeu_epi32(p, lanes, v); }
+__attribute__((target("avx512f")))
+static inline void store_lanes(uint64_t* p, __mmask8 lanes, __m512i v) { _mm512_mask_storeu_epi64(p, lanes, v); }
+
+// Field by field over blocks of 256 words (2 KiB, read again from L1 for
+// each field): 8 records per shift, mask and narrowing store, the tail
+// of each block under a mask
+template<typename Lane>
+struct UnpackColumnsAVX512
+{
+    __attribute__((target("avx512f")))
+    static void run(const PackedLayout& layout, const uint64_t* words, size_t n, void* const* columns)
+    {
+        const size_t block = 256;
+        for(size_t first = 0; first < n; first += block)
+        {
+            size_t count = min(block, n - first);
+            for(unsigned int f = 0; f < layout.field_count; ++f)
+            {
+                if(!columns[f])
+                    continue;
+                __m128i shift = _mm_cvtsi32_si128(int(layout.offsets[f]));
+                __m512i mask = _mm512_set1_epi64(static_cast<long long>(layout.masks[f]));
+                Lane* column = static_cast<Lane*>(columns[f]) + first;
+                for(size_t i = 0; i < count; i += 8)
+                {
+                    __mmask8 lanes = count - i >= 8 ? __mmask8(0xff) : __mmask8((1u << (count - i)) - 1);
+                    __m512i v = _mm512_maskz_loadu_epi64(lanes, words + first + i);
+                    store_lanes(column + i, lanes, _mm512_and_si512(_mm512_srl_epi64(v, shift), mask));
+                }
+            }
+        }
+    }
+};
+
+__attribute__((target("avx512f")))
+static void unpack_columns_avx512(const PackedLayout& layout, const uint64_t* words, size_t n, void* const* columns)
+{
+    dispatch<UnpackColumnsAVX512>(layout, words, n, columns);
+}
+END_AVX512_KERNELS
+#endif
+
+static const Kernel<void (*)(const PackedLayout&, const void*, size_t, uint64_t*)> pack_kernel(
+    "packed_fields.pack", pack_scalar, nullptr, X86_KERNEL(pack_avx2), nullptr);
+
+static const Kernel<void (*)(const PackedLayout&, const uint64_t*, size_t, void*)> unpack_kernel(
+    "packed_fields.unpack", unpack_scalar, nullptr, X86_KERNEL(unpack_avx2), nullptr);
+
+// Into columns, PDEP saves nothing: each value still needs its own store
+static const Kernel<void (*)(const PackedLayout&, const uint64_t*, size_t, void* const*)> unpack_columns_kernel(
+    "packed_fields.unpack_columns", unpack_columns_scalar, nullptr, nullptr, X86_KERNEL(unpack_columns_avx512));
+
+void pack_records(const PackedLayout& layout, const void* records, size_t n, uint64_t* words)
+{
+    pack_kernel(layout, records, n, words);
+}
+
+void unpack_records(const PackedLayout& layout, const uint64_t* words, size_t n, void* records)
+{
+    unpack_kernel(layout, words, n, records);
+}
+
+void unpack_columns(const PackedLayout& layout, const uint64_t* words, size_t n, void* const* columns)
+{
+    unpack_columns_kernel(layout, words, n, columns);
+}
+
+// An order as usually declared, one int per field
+struct Order
+{
+    bool paid;
+    bool shipped;
+    int priority;   // 0..7
+    int region;     // 0..31
+    int quantity;   // 0..4095
+    int day;        // 1..31
+};
+
+// The same fields, in 27 bits
+typedef PackedFields<Field<1>, Field<1>, Field<3>, Field<5>, Field<12>, Field<5>> PackedOrder;
+enum OrderField { Paid, Shipped, Priority, Region, Quantity, Day };
+
+void demo_packed_fields()
+{
+    demo_out() << endl << "************** Packed fields *************" << endl;
+
+    demo_out() << "Order : " << sizeof(Order) << " bytes as a struct, "
+               << PackedOrder::total_width << " bits packed (in a " << sizeof(uint64_t) << "-byte word)" << endl;
+    for(size_t f = 0; f < PackedOrder::field_count; ++f)
+        demo_out() << "Field " << f << " : offset " << PackedOrder::offset(f) << ", mask "
+                   << bitset<PackedOrder::total_width>(PackedOrder::mask(f)) << endl;
+
+    Order order{true, false, 5, 17, 1200, 24};
+    uint64_t word = PackedOrder::pack({{order.paid, order.shipped, uint16_t(order.priority),
+                                        uint16_t(order.region), uint16_t(order.quantity), uint16_t(order.day)}});
+    demo_out() << "Packed order : 0x" << hex << word << dec << endl;
+    demo_out() << "Quantity : " << PackedOrder::get<Quantity>(word)
+               << ", region : " << PackedOrder::get<Region>(word) << endl;
+    word = PackedOrder::set<Shipped>(word, 1);
+    // Too wide: truncated to the 12 bits of the field
+    word = PackedOrder::set<Quantity>(word, 4096 + 1300);
+    PackedOrder::Record record = PackedOrder::unpack(word);
+    demo_out() << "Shipped, 1300 more : paid " << record[Paid] << ", shipped " << record[Shipped]
+               << ", quantity " << record[Quantity] << ", day " << record[Day] << endl;
+
+    // The byte masks of an int are the layout of 4 fields of 8 bits
+    typedef PackedFields<Field<8>, Field<8>, Field<8>, Field<8>> IntBytes;
+    for(size_t f = 0; f < IntBytes::field_count; ++f)
+        demo_out() << "Byte " << f << " : " << bitset<32>(IntBytes::mask(f)) << endl;
+    static_assert(IntBytes::get<1>(0x12345678) == 0x56 && PackedOrder::pack({{1, 0, 7}}) == 0x1d,
+        "layouts are usable at compile time");
+    constexpr IntBytes::Record int_bytes = IntBytes::unpack(0x12345678);
+    static_assert(int_bytes[0] == 0x78 && int_bytes[3] == 0x12, "records unpack at compile time");
+
+    // A batch of orders: packed with PEXT, unpacked into columns to scan
+    // one field at a time
+    const size_t n = 1000;
+    vector<PackedOrder::Record> records(n);
+    for(size_t i = 0; i < n; ++i)
+        records[i] = {{uint16_t(i % 3 != 0), uint16_t(i % 2), uint16_t(i % 8),
+                       uint16_t(i % 32), uint16_t(i * 7 % 4096), uint16_t(i % 31 + 1)}};
+    vector<uint64_t> words(n);
+    PackedOrder::pack(records.data(), n, words.data());
+    demo_out() << n << " orders : " << n * sizeof(Order) << " bytes as structs, "
+               << n * sizeof(uint64_t) << " bytes packed" << endl;
+
+    // Only the columns of the query
+    vector<uint16_t> paid(n), quantities(n);
+    PackedOrder::unpack_columns(words.data(), n, {{paid.data(), nullptr, nullptr, nullptr, quantities.data(), nullptr}});
+    uint64_t paid_quantity = 0;
+    for(size_t i = 0; i < n; ++i)
+        paid_quantity += paid[i] * quantities[i];
+    demo_out() << "Quantity of the paid orders : " << paid_quantity << endl;
+
+    vector<PackedOrder::Record> unpacked(n);
+    PackedOrder::unpack(words.data(), n, unpacked.data());
+    demo_out() << "Unpacked back unchanged ? " << (unpacked == records ? "true" : "false") << endl;
+}
@@ -0,0 +1,174 @@
+#ifndef _PACKED_FIELDS_H_
+#define _PACKED_FIELDS_H_
+
+#include <array>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t, uint32_t, uint16_t, uint8_t
+#include <type_traits> // for conditional
+#include <utility> // for index_sequence
+
+/// Packed fields demo: records of flags and small integers in 64-bit words
+void demo_packed_fields();
+
+/// Field of a packed record, Width bits wide
+template<unsigned int Width>
+struct Field
+{
+    static_assert(Width >= 1 && Width <= 64, "a field has 1 to 64 bits");
+    static const unsigned int width = Width;
+};
+
+/// Run-time description of a layout, for the batch kernels. Field 0 is in
+/// the lowest bits of the word, each next field right above the previous.
+/// An unpacked record is an array of lanes of lane_bytes each, one value
+/// per lane; read as little-endian 64-bit chunks, its values are deposited
+/// in and extracted from the word with one PDEP/PEXT per chunk.
+struct PackedLayout
+{
+    static const unsigned int max_fields = 64;
+
+    unsigned int field_count;
+    unsigned int total_width;   ///< bits used in the word
+    unsigned int lane_bytes;    ///< 1, 2, 4 or 8: the narrowest that fits every field
+    unsigned int chunk_count;   ///< 64-bit chunks of an unpacked record, the last one partial
+    uint8_t offsets[max_fields];
+    uint64_t masks[max_fields];         ///< low bits of each field's value
+    uint8_t chunk_offsets[max_fields];  ///< offset of the first field of each chunk
+    uint64_t chunk_masks[max_fields];   ///< bits of each chunk holding the values of its fields
+};
+
+/// Layout of the fields of the given widths, in this order
+template<size_t N>
+constexpr PackedLayout make_packed_layout(const unsigned int (&widths)[N])
+{
+    PackedLayout layout{};
+    layout.field_count = N;
+    unsigned int widest = 0;
+    for(size_t f = 0; f < N; ++f)
+        widest = widths[f] > widest ? widths[f] : widest;
+    layout.lane_bytes = widest <= 8 ? 1 : widest <= 16 ? 2 : widest <= 32 ? 4 : 8;
+    unsigned int lanes_per_chunk = 8 / layout.lane_bytes;
+    layout.chunk_count = (N + lanes_per_chunk - 1) / lanes_per_chunk;
+    unsigned int offset = 0;
+    for(size_t f = 0; f < N; ++f)
+    {
+        layout.offsets[f] = uint8_t(offset); // meaningful if the fields fit
+        layout.masks[f] = widths[f] == 64 ? ~uint64_t(0) : (uint64_t(1) << widths[f]) - 1;
+        size_t chunk = f / lanes_per_chunk;
+        if(f % lanes_per_chunk == 0)
+            layout.chunk_offsets[chunk] = uint8_t(offset);
+        layout.chunk_masks[chunk] |= layout.masks[f] << (f % lanes_per_chunk * layout.lane_bytes * 8);
+        offset += widths[f];
+    }
+    layout.total_width = offset;
+    return layout;
+}
+
+// Batch kernels (packed_fields.cpp): PEXT/PDEP with BMI2, shifts and masks
+// otherwise. The records are arrays of layout.field_count lanes.
+void pack_records(const PackedLayout& layout, const void* records, size_t n, uint64_t* words);
+void unpack_records(const PackedLayout& layout, const uint64_t* words, size_t n, void* records);
+/// columns[f] receives the n values of field f, in lanes of layout.lane_bytes;
+/// the fields whose column is nullptr are skipped
+void unpack_columns(const PackedLayout& layout, const uint64_t* words, size_t n, void* const* columns);
+
+/// Compile-time layout of records made of small fields packed in a 64-bit
+/// word, e.g. PackedFields<Field<1>, Field<3>, Field<12>> for a flag, a
+/// 3-bit and a 12-bit integer in 16 bits. Generalizes byte masks: the
+/// fields may have any width, as long as they fit in 64 bits together.
+///
+/// One record is packed and unpacked with shifts and masks, at compile time
+/// too. Arrays of records go through the batch kernels, which use the
+/// BMI2 PEXT/PDEP instructions when the host has them (see cpu_features.h),
+/// and unpack whole arrays into columns, one array per field.
+/// Values wider than their field are truncated to it, like bit-fields.
+template<typename... Fields>
+class PackedFields
+{
+public:
+    static const size_t field_count = sizeof...(Fields);
+    static_assert(field_count <= PackedLayout::max_fields, "at most 64 fields");
+
+    static constexpr PackedLayout layout = make_packed_layout({Fields::width...});
+    static const unsigned int total_width = layout.total_width;
+    static_assert(total_width <= 64, "the fields fit in 64 bits");
+
+    /// Unsigned type of the values, the narrowest that fits every field
+    typedef typename std::conditional<layout.lane_bytes == 1, uint8_t,
+            typename std::conditional<layout.lane_bytes == 2, uint16_t,
+            typename std::conditional<layout.lane_bytes == 4, uint32_t, uint64_t>::type>::type>::type value_type;
+    /// Unpacked record: the value of each field
+    typedef std::array<value_type, field_count> Record;
+    static_assert(sizeof(Record) == field_count * sizeof(value_type), "records are arrays of lanes");
+
+    static constexpr unsigned int offset(size_t f) { return layout.offsets[f]; }
+    /// Bits of the field in the word
+    static constexpr uint64_t mask(size_t f) { return layout.masks[f] << layout.offsets[f]; }
+
+    template<size_t F>
+    static constexpr value_type get(uint64_t word)
+    {
+        static_assert(F < field_count, "field index out of range");
+        return value_type((word >> offset(F)) & layout.masks[F]);
+    }
+
+    template<size_t F>
+    static constexpr uint64_t set(uint64_t word, uint64_t value)
+    {
+        static_assert(F < field_count, "field index out of range");
+        return (word & ~mask(F)) | ((value & layout.masks[F]) << offset(F));
+    }
+
+    static constexpr uint64_t pack(const Record& record)
+    {
+        uint64_t word = 0;
+        for(size_t f = 0; f < field_count; ++f)
+            word |= (uint64_t(record[f]) & layout.masks[f]) << offset(f);
+        return word;
+    }
+
+    static constexpr Record unpack(uint64_t word)
+    {
+        return unpack(word, std::make_index_sequence<field_count>());
+    }
+
+    /// Batch forms: words[i] is the packed records[i]
+    static void pack(const Record* records, size_t n, uint64_t* words)
+    {
+        pack_records(layout, records, n, words);
+    }
+
+    static void unpack(const uint64_t* words, size_t n, Record* records)
+    {
+        unpack_records(layout, words, n, records);
+    }
+
+    /// columns[f][i] is field f of words[i]; nullptr skips the field
+    static void unpack_columns(const uint64_t* words, size_t n, const std::array<value_type*, field_count>& columns)
+    {
+        void* column_pointers[field_count];
+        for(size_t f = 0; f < field_count; ++f)
+            column_pointers[f] = columns[f];
+        ::unpack_columns(layout, words, n, column_pointers);
+    }
+
+private:
+    // One initializer per field: C++14 cannot assign the elements of a
+    // std::array in a constant expression
+    template<size_t... F>
+    static constexpr Record unpack(uint64_t word, std::index_sequence<F...>)
+    {
+        return {{value_type((word >> offset(F)) & layout.masks[F])...}};
+    }
+};
+
+template<typename... Fields>
+const size_t PackedFields<Fields...>::field_count;
+
+template<typename... Fields>
+constexpr PackedLayout PackedFields<Fields...>::layout;
+
+template<typename... Fields>
+const unsigned int PackedFields<Fields...>::total_width;
+
+#endif /* _PACKED_FIELDS_H_ */
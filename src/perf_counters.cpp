@@ -0,0 +1,236 @@
+#include "perf_counters.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring> // for memset, strerror
+#include <map>
+#include <mutex>
+#include <linux/perf_event.h>
+#include <sys/syscall.h> // for SYS_perf_event_open
+#include <unistd.h> // for syscall, read, close
+
+using namespace std;
+
+const char* to_string(PerfEvent event)
+{
+    switch(event)
+    {
+    case PerfEvent::Cycles: return "cycles";
+    case PerfEvent::Instructions: return "instructions";
+    case PerfEvent::L1DMisses: return "l1d_misses";
+    case PerfEvent::LLCMisses: return "llc_misses";
+    case PerfEvent::BranchMisses: return "branch_misses";
+    case PerfEvent::ContextSwitches: return "context_switches";
+    default: return "unknown";
+    }
+}
+
+bool PerfCounts::any() const
+{
+    for(unsigned int i = 0; i < nPerfEvents; ++i)
+        if(available[i])
+            return true;
+    return false;
+}
+
+double PerfCounts::ipc() const
+{
+    if(!has(PerfEvent::Cycles) || !has(PerfEvent::Instructions) || (*this)[PerfEvent::Cycles] == 0)
+        return 0.0;
+    return double((*this)[PerfEvent::Instructions]) / (*this)[PerfEvent::Cycles];
+}
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other)
+{
+    for(unsigned int i = 0; i < nPerfEvents; ++i)
+    {
+        values[i] += other.values[i];
+        available[i] = available[i] || other.available[i];
+    }
+    return *this;
+}
+
+PerfCounts PerfCounts::operator-(const PerfCounts& other) const
+{
+    PerfCounts diff;
+    for(unsigned int i = 0; i < nPerfEvents; ++i)
+    {
+        diff.available[i] = available[i] && other.available[i];
+        diff.values[i] = diff.available[i] && values[i] > other.values[i]
+            ? values[i] - other.values[i] : 0;
+    }
+    return diff;
+}
+
+// perf_event_open type and config of each PerfEvent
+struct EventConfig
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+static const EventConfig event_configs[nPerfEvents] =
+{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}
+};
+
+// Counters of the calling thread, one file descriptor per event.
+// The events are not grouped: a host that cannot count one of them
+// (typically the cache events in a VM) still counts the others.
+class ThreadCounters
+{
+public:
+    ThreadCounters()
+    {
+        for(unsigned int i = 0; i < nPerfEvents; ++i)
+        {
+            _fds[i] = open_event(event_configs[i], _errors[i]);
+        }
+    }
+    ~ThreadCounters()
+    {
+        for(int fd : _fds)
+            if(fd >= 0)
+                close(fd);
+    }
+    ThreadCounters(const ThreadCounters&) = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+    PerfCounts read_all() const
+    {
+        PerfCounts counts;
+        for(unsigned int i = 0; i < nPerfEvents; ++i)
+        {
+            // value, time enabled, time running (see PERF_FORMAT_TOTAL_TIME_*)
+            uint64_t data[3];
+            if(_fds[i] < 0 || ::read(_fds[i], data, sizeof(data)) != sizeof(data))
+                continue;
+            counts.available[i] = true;
+            // Scale up when the kernel multiplexed more events than the PMU has counters
+            counts.values[i] = data[2] && data[2] < data[1]
+                ? uint64_t(double(data[0]) * data[1] / data[2]) : data[0];
+        }
+        return counts;
+    }
+
+    // errno of the failure to open the event, 0 if it is counted
+    int error(unsigned int i) const { return _errors[i]; }
+
+private:
+    static int open_event(const EventConfig& event, int& error)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event.type;
+        attr.config = event.config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_hv = 1;
+        // Context switches happen in the kernel; unprivileged users
+        // may only count user space, so retry without it
+        for(int exclude_kernel = 0; exclude_kernel <= 1; ++exclude_kernel)
+        {
+            attr.exclude_kernel = exclude_kernel;
+            // pid 0, cpu -1: the calling thread, on any CPU
+            int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if(fd >= 0)
+            {
+                error = 0;
+                return fd;
+            }
+            error = errno;
+        }
+        return -1;
+    }
+
+    int _fds[nPerfEvents];
+    int _errors[nPerfEvents];
+};
+
+static atomic<bool> counters_enabled(false);
+
+static const ThreadCounters& thread_counters()
+{
+    static thread_local ThreadCounters counters;
+    return counters;
+}
+
+// Why the event could not be opened, from the errno of perf_event_open
+static string explain(int error)
+{
+    string reason = strerror(error);
+    if(error == EACCES || error == EPERM)
+        reason += " (see /proc/sys/kernel/perf_event_paranoid)";
+    else if(error == ENOENT || error == ENODEV || error == EOPNOTSUPP)
+        reason += " (no performance monitoring unit, e.g. in a VM or container)";
+    return reason;
+}
+
+bool enable_perf_counters(string& reason)
+{
+    const ThreadCounters& counters = thread_counters();
+    PerfCounts counts = counters.read_all();
+    // Events not counted, grouped by reason
+    map<int, string> missing;
+    for(unsigned int i = 0; i < nPerfEvents; ++i)
+    {
+        if(counts.available[i])
+            continue;
+        string& events = missing[counters.error(i)];
+        events += string(events.empty() ? "" : ", ") + to_string(PerfEvent(i));
+    }
+    reason.clear();
+    for(const auto& m : missing)
+        reason += (reason.empty() ? "" : "; ") + m.second + ": " + explain(m.first);
+    counters_enabled = counts.any();
+    return counters_enabled;
+}
+
+bool perf_counters_enabled()
+{
+    return counters_enabled.load(memory_order_relaxed);
+}
+
+PerfCounts perf_counters_now()
+{
+    if(!perf_counters_enabled())
+        return PerfCounts();
+    return thread_counters().read_all();
+}
+
+// Totals of the regions, by name
+static mutex regions_mutex;
+static map<string, PerfRegionTotals> regions;
+
+PerfRegion::PerfRegion(const char* name)
+:_name(perf_counters_enabled() ? name : nullptr)
+{
+    if(_name)
+        _start = perf_counters_now();
+}
+
+PerfRegion::~PerfRegion()
+{
+    if(!_name)
+        return;
+    PerfCounts counts = perf_counters_now() - _start;
+    lock_guard<mutex> lock(regions_mutex);
+    PerfRegionTotals& totals = regions[_name];
+    totals.name = _name;
+    ++totals.calls;
+    totals.counts += counts;
+}
+
+vector<PerfRegionTotals> perf_region_totals()
+{
+    lock_guard<mutex> lock(regions_mutex);
+    vector<PerfRegionTotals> totals;
+    for(const auto& r : regions)
+        totals.push_back(r.second);
+    return totals;
+}
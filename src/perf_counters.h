@@ -0,0 +1,85 @@
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+#include <cstdint> // for uint64_t
+#include <string>
+#include <vector>
+
+/// Events counted around each demo and each marked region
+enum class PerfEvent : unsigned int
+{
+    Cycles = 0,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+    ContextSwitches,
+    NumEvents // must be the last element
+};
+
+constexpr unsigned int nPerfEvents = static_cast<unsigned int>(PerfEvent::NumEvents);
+
+/// Name of the event in the reports, e.g. "l1d_misses"
+const char* to_string(PerfEvent event);
+
+/// Values of the counters; an event the host cannot count is marked unavailable
+struct PerfCounts
+{
+    uint64_t values[nPerfEvents] = {};
+    bool available[nPerfEvents] = {};
+
+    uint64_t operator[](PerfEvent e) const { return values[static_cast<unsigned int>(e)]; }
+    bool has(PerfEvent e) const { return available[static_cast<unsigned int>(e)]; }
+    bool any() const;
+    /// Instructions per cycle; 0 if either counter is unavailable
+    double ipc() const;
+
+    PerfCounts& operator+=(const PerfCounts& other);
+    PerfCounts operator-(const PerfCounts& other) const;
+};
+
+/// Switches the counters on for the whole program. Off by default, in which
+/// case perf_counters_now() and PERF_REGION cost a predictable branch.
+/// Returns false if the host counts none of the events, e.g. in a container
+/// or with kernel.perf_event_paranoid > 2. The reason lists the events
+/// that cannot be counted and why; it is empty if all of them are.
+bool enable_perf_counters(std::string& reason);
+bool perf_counters_enabled();
+
+/// Current values of the counters of the calling thread, which are
+/// opened with perf_event_open on first use. Each counts kernel code too
+/// where the host allows it, user space only otherwise (e.g. with
+/// kernel.perf_event_paranoid > 1)
+PerfCounts perf_counters_now();
+
+/// Counts of the code between construction and destruction of the object,
+/// added to the named region. The name must outlive the program, e.g. a literal.
+class PerfRegion
+{
+public:
+    explicit PerfRegion(const char* name);
+    ~PerfRegion();
+    PerfRegion(const PerfRegion&) = delete;
+    PerfRegion& operator=(const PerfRegion&) = delete;
+private:
+    const char* _name;
+    PerfCounts _start;
+};
+
+/// Totals of a marked region over all its executions
+struct PerfRegionTotals
+{
+    std::string name;
+    uint64_t calls = 0;
+    PerfCounts counts;
+};
+
+/// Totals of all the regions executed so far, sorted by name
+std::vector<PerfRegionTotals> perf_region_totals();
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+/// Marks the rest of the enclosing scope as a region measured by the counters
+#define PERF_REGION(name) PerfRegion PERF_CONCAT(perf_region_, __LINE__)(name)
+
+#endif /* _PERF_COUNTERS_H_ */
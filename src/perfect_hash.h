@@ -0,0 +1,203 @@
+#ifndef _PERFECT_HASH_H_
+#define _PERFECT_HASH_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t, int32_t
+#include <stdexcept> // for invalid_argument
+
+// Hashes of the perfect hash tables. A key is hashed once, FNV-1a over its
+// bytes; the bucket and the slot are then mixes of that hash, so a lookup
+// reads the key twice: once to hash it, once to compare it.
+
+/// FNV-1a hash of the size bytes of the key
+constexpr uint64_t perfect_hash_bytes(const char* key, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; ++i)
+        hash = (hash ^ uint8_t(key[i])) * 0x100000001b3ull;
+    return hash;
+}
+
+/// Mix of the hash of a key with a seed (MurmurHash3 finalizer)
+constexpr uint64_t perfect_hash_mix(uint64_t hash, uint64_t seed)
+{
+    hash ^= seed * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdull;
+    hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 33);
+}
+
+/// Maps the high 32 bits of a hash to [0, n) with a multiplication, not a division
+constexpr size_t perfect_hash_reduce(uint64_t hash, size_t n)
+{
+    return size_t(((hash >> 32) * n) >> 32);
+}
+
+/// Minimal perfect hash set of N strings, built at compile time (CHD, Belazzougui,
+/// Botelho, Dietzfelbinger, "Hash, displace, and compress"): each of the N keys
+/// lands in one of N buckets, then each bucket gets the first seed that moves
+/// all its keys to free slots of the table, largest buckets first. The keys of
+/// a single-key bucket take the remaining slots directly. A lookup is one hash
+/// of the key, one seed and one slot read, and one string compare: O(1) against
+/// the O(N) cx_strcmp of a linear scan, in constant expressions and at run time.
+///
+/// The set keeps pointers to the keys, which must outlive it: string literals.
+/// index_of gives the position of the key in the list the set was built from.
+/// A duplicate key throws std::invalid_argument, i.e. fails to compile when
+/// the set is constexpr, as does a list whose keys cannot be separated.
+template<size_t N>
+class PerfectHashSet
+{
+public:
+    static_assert(N > 0, "a perfect hash set has at least one key");
+    static_assert(N < (size_t(1) << 31), "a perfect hash set has fewer than 2^31 keys");
+
+    /// Index of a key not in the set
+    static const size_t npos = size_t(-1);
+    /// Seeds tried per bucket before giving up
+    static const int32_t max_seed = 1 << 16;
+
+    constexpr explicit PerfectHashSet(const char* const (&keys)[N])
+        : _seeds{}, _keys{}, _sizes{}, _indexes{}
+    {
+        uint64_t hashes[N] = {};
+        size_t sizes[N] = {};
+        // Buckets of the keys, each bucket's keys contiguous in members
+        size_t bucket_starts[N + 1] = {};
+        size_t members[N] = {};
+        size_t largest = 0;
+        for(size_t i = 0; i < N; ++i)
+        {
+            while(keys[i][sizes[i]] != '\0')
+                ++sizes[i];
+            hashes[i] = perfect_hash_bytes(keys[i], sizes[i]);
+            ++bucket_starts[bucket_of(hashes[i]) + 1];
+        }
+        for(size_t b = 0; b < N; ++b)
+        {
+            largest = bucket_starts[b + 1] > largest ? bucket_starts[b + 1] : largest;
+            bucket_starts[b + 1] += bucket_starts[b];
+        }
+        size_t filled[N] = {};
+        for(size_t i = 0; i < N; ++i)
+        {
+            size_t b = bucket_of(hashes[i]);
+            members[bucket_starts[b] + filled[b]++] = i;
+        }
+
+        bool taken[N] = {};
+        // Slots stamped with the attempt that took them: catches two keys
+        // of a bucket landing in the same slot
+        size_t stamps[N] = {};
+        size_t attempt = 0;
+        // Seeds of the buckets of several keys, largest first
+        for(size_t bucket_size = largest; bucket_size >= 2; --bucket_size)
+            for(size_t b = 0; b < N; ++b)
+            {
+                if(bucket_starts[b + 1] - bucket_starts[b] != bucket_size)
+                    continue;
+                const size_t* bucket = members + bucket_starts[b];
+                // Keys of the same hash are never separated
+                for(size_t k = 1; k < bucket_size; ++k)
+                    for(size_t j = 0; j < k; ++j)
+                        if(hashes[bucket[j]] == hashes[bucket[k]])
+                            throw std::invalid_argument("perfect hash: duplicate key");
+                int32_t seed = 1;
+                for(;; ++seed)
+                {
+                    if(seed > max_seed)
+                        throw std::invalid_argument("perfect hash: no seed found");
+                    ++attempt;
+                    bool free = true;
+                    for(size_t k = 0; k < bucket_size && free; ++k)
+                    {
+                        size_t slot = slot_of(hashes[bucket[k]], seed);
+                        free = !taken[slot] && stamps[slot] != attempt;
+                        stamps[slot] = attempt;
+                    }
+                    if(free)
+                        break;
+                }
+                for(size_t k = 0; k < bucket_size; ++k)
+                {
+                    size_t slot = slot_of(hashes[bucket[k]], seed);
+                    taken[slot] = true;
+                    place(slot, keys, sizes, bucket[k]);
+                }
+                _seeds[b] = seed;
+            }
+        // Single-key buckets: the free slots in turn, as -(slot + 1)
+        size_t slot = 0;
+        for(size_t b = 0; b < N; ++b)
+        {
+            if(bucket_starts[b + 1] - bucket_starts[b] != 1)
+                continue;
+            while(taken[slot])
+                ++slot;
+            taken[slot] = true;
+            place(slot, keys, sizes, members[bucket_starts[b]]);
+            _seeds[b] = -int32_t(slot) - 1;
+        }
+    }
+
+    constexpr size_t size() const { return N; }
+
+    /// Position of the key in the list the set was built from, npos if absent
+    constexpr size_t index_of(const char* key, size_t size) const
+    {
+        uint64_t hash = perfect_hash_bytes(key, size);
+        int32_t seed = _seeds[bucket_of(hash)];
+        size_t slot = seed < 0 ? size_t(-(seed + 1)) : slot_of(hash, seed);
+        if(_sizes[slot] != size)
+            return npos;
+        for(size_t i = 0; i < size; ++i)
+            if(_keys[slot][i] != key[i])
+                return npos;
+        return _indexes[slot];
+    }
+
+    /// Same for a '\0'-terminated key
+    constexpr size_t index_of(const char* key) const
+    {
+        size_t size = 0;
+        while(key[size] != '\0')
+            ++size;
+        return index_of(key, size);
+    }
+
+    constexpr bool contains(const char* key, size_t size) const { return index_of(key, size) != npos; }
+    constexpr bool contains(const char* key) const { return index_of(key) != npos; }
+
+private:
+    static constexpr size_t bucket_of(uint64_t hash) { return perfect_hash_reduce(perfect_hash_mix(hash, 0), N); }
+    static constexpr size_t slot_of(uint64_t hash, int32_t seed) { return perfect_hash_reduce(perfect_hash_mix(hash, uint64_t(seed)), N); }
+
+    constexpr void place(size_t slot, const char* const (&keys)[N], const size_t (&sizes)[N], size_t index)
+    {
+        _keys[slot] = keys[index];
+        _sizes[slot] = sizes[index];
+        _indexes[slot] = index;
+    }
+
+    int32_t _seeds[N];      ///< per bucket: seed of its slots, or -(slot + 1) of its single key
+    const char* _keys[N];   ///< per slot
+    size_t _sizes[N];
+    size_t _indexes[N];     ///< position of the key in the list
+};
+
+/// Set of the keys of a list: constexpr auto set = make_perfect_hash_set(list);
+template<size_t N>
+constexpr PerfectHashSet<N> make_perfect_hash_set(const char* const (&keys)[N])
+{
+    return PerfectHashSet<N>(keys);
+}
+
+/// Set of the given string literals: make_perfect_hash_set("do", "re", "mi")
+template<typename... Keys>
+constexpr PerfectHashSet<sizeof...(Keys)> make_perfect_hash_set(const Keys&... keys)
+{
+    const char* const list[] = {keys...};
+    return PerfectHashSet<sizeof...(Keys)>(list);
+}
+
+#endif /* _PERFECT_HASH_H_ */
@@ -1,4 +1,6 @@
 #include "pitfalls.h"
+#include "demo_output.h"
+#include "perf_counters.h"
 #include <algorithm>
 #include <iostream>
 #include <list>
@@ -8,14 +10,14 @@ using namespace std;
 int increment( int& nValue )
 {
     ++nValue;
-    cout << "Incremented value is " << nValue << endl;
+    demo_out() << "Incremented value is " << nValue << endl;
     return nValue;
 }
 
 int makeDouble( int &nValue )
 {
     nValue *= 2;
-    cout << "Doubled value is " << nValue << endl;
+    demo_out() << "Doubled value is " << nValue << endl;
     return nValue;
 }
 
@@ -67,13 +69,13 @@ public:
 // version 1
 void processing(string a, bool flag = true)
 {
-    cout << "call to processing version 1 with arguments " 
+    demo_out() << "call to processing version 1 with arguments " 
         << a << " and " << flag << endl;
 }
 // version 2
 void processing(string a, string b, bool flag = true)
 {
-    cout << "call to processing version 2 with arguments " 
+    demo_out() << "call to processing version 2 with arguments " 
         << a << ", " << b << " and " << flag << endl;
 }
 
@@ -99,7 +101,7 @@ private:
 
 void demo_pitfalls()
 {
-    cout << endl << "*************** Pitfalls *****************" << endl;
+    demo_out() << endl << "*************** Pitfalls *****************" << endl;
 
     // Uninitialized value incremented => no compiler warning
     // The compiler will warn 'Wuninitialized' only if variable is used 
@@ -122,7 +124,7 @@ void demo_pitfalls()
 
     // Automated conversion from signed to unsigned => no compiler warning
     // int constant is promoted to unsigned int; result is unsigned int
-    cout << "Value should be -5 : " << 10 - 15u << endl;
+    demo_out() << "Value should be -5 : " << 10 - 15u << endl;
 
     // 'delete' used in place of 'delete[]' => memory leak; no compiler warning
     // Only first element of the array is properly destroyed
@@ -133,16 +135,16 @@ void demo_pitfalls()
     // Result of the expression depends of order in which the side effects complete.
     // Here both multiply and makeDouble have a side effect => no compiler warning
     int nZ = 5;
-    cout << "Is value 18 or 21 ? " <<  increment(nZ) + makeDouble(nZ) << endl;
-    // cout << "Is value 30 or 36 ? " <<  multiply(nZ, ++nZ) << endl; // warning Wsequence-point
+    demo_out() << "Is value 18 or 21 ? " <<  increment(nZ) + makeDouble(nZ) << endl;
+    // demo_out() << "Is value 30 or 36 ? " <<  multiply(nZ, ++nZ) << endl; // warning Wsequence-point
 
     // '++nW' will be evaluated only if first operant of && is true => no compiler warning
     // Any operator that has a side effect (e.g. ++, --, += etc.) should be in its own statement
     int nT = 0, nW = 1;
     if( nT == 1 && incrAndTestEqual2(nW))
-        cout << "Yes : nT is " << nT << " and nW is " << nW << endl;
+        demo_out() << "Yes : nT is " << nT << " and nW is " << nW << endl;
     else
-        cout << "No : nT is " << nT << " and nW is " << nW << endl;
+        demo_out() << "No : nT is " << nT << " and nW is " << nW << endl;
 
     // Missing break statement at the end of a switch-case block => no compiler warning
     int nValue = 2;
@@ -154,13 +156,16 @@ void demo_pitfalls()
         case 3: eColor = Color::GREEN;
         default: eColor = Color::RED;
     }
-    cout << "Color should be 2 (PURPLE) it is " << eColor << endl;
+    demo_out() << "Color should be 2 (PURPLE) it is " << eColor << endl;
 
     // Virtual method is called in constructor => no compiler warning
     // Since derived class is not yet fully constructed when virtual method is called
     // the base class version of virtual method 'generateClassID' is called
-    Derived xDerived;
-    cout << "ID should be 2 it is " << xDerived.getID() << endl;
+    {
+        PERF_REGION("pitfalls.virtual_call_in_constructor");
+        Derived xDerived;
+        demo_out() << "ID should be 2 it is " << xDerived.getID() << endl;
+    }
 
 
     // Version 1 of the overloaded function is called, not version 2 => no compiler warning
@@ -173,7 +178,7 @@ void demo_pitfalls()
     string b();
     // Remember to omit the () for the default constructor.
     // The compiler will complain here:
-    // cout << "b is " << b << endl;
+    // demo_out() << "b is " << b << endl;
 
     // Crashes the program with "pure virtual method called"
     //Point p;
@@ -0,0 +1,191 @@
+#include "profiler.h"
+#include "symbols.h"
+#include <algorithm> // for min
+#include <atomic>
+#include <cerrno>
+#include <csignal> // for sigaction, SIGPROF
+#include <cstdlib> // for calloc
+#include <cstring> // for strerror
+#include <fstream>
+#include <map>
+#include <stdexcept> // for runtime_error
+#include <execinfo.h> // for backtrace
+#include <sys/stat.h> // for mkdir
+#include <sys/time.h> // for setitimer
+
+using namespace std;
+
+// One call stack, as recorded by the signal handler
+static const int sample_depth = 64;
+
+struct Sample
+{
+    atomic<bool> ready;
+    const char* tag;
+    int scope_depth;    // frames of the ProfileScope constructor and its callers
+    int depth;
+    void* frames[sample_depth];
+};
+
+// Preallocated, since the handler must not allocate; the slots are
+// claimed in turn with an atomic increment, by whichever thread is sampled
+static const size_t sample_capacity = 1 << 15;
+static Sample* samples = nullptr;
+static atomic<size_t> next_sample(0);
+static atomic<uint64_t> outside_samples(0);
+
+// Scope of the calling thread. Read by the handler, which interrupts the
+// thread itself: a signal fence is enough to order the accesses.
+static thread_local const char* scope_tag = nullptr;
+static thread_local int scope_depth = 0;
+
+static void on_sigprof(int, siginfo_t*, void*)
+{
+    int saved_errno = errno;
+    const char* tag = scope_tag;
+    if(!tag)
+        outside_samples.fetch_add(1, memory_order_relaxed);
+    else
+    {
+        size_t i = next_sample.fetch_add(1, memory_order_relaxed);
+        if(i < sample_capacity)
+        {
+            Sample& s = samples[i];
+            s.tag = tag;
+            s.scope_depth = scope_depth;
+            s.depth = backtrace(s.frames, sample_depth);
+            s.ready.store(true, memory_order_release);
+        }
+    }
+    errno = saved_errno;
+}
+
+bool start_profiler(unsigned int hz, string& reason)
+{
+    if(hz == 0 || hz > 1000000)
+    {
+        reason = "the rate must be between 1 and 1000000 Hz";
+        return false;
+    }
+    if(!samples)
+    {
+        // Zeroed by calloc: no slot is ready
+        samples = static_cast<Sample*>(calloc(sample_capacity, sizeof(Sample)));
+        if(!samples)
+        {
+            reason = "cannot allocate the sample buffer";
+            return false;
+        }
+    }
+    // backtrace loads its unwinder on first use, which the handler must not do
+    void* frame;
+    backtrace(&frame, 1);
+
+    struct sigaction action = {};
+    action.sa_sigaction = on_sigprof;
+    action.sa_flags = SA_SIGINFO | SA_RESTART; // do not interrupt the I/O of the demos
+    sigemptyset(&action.sa_mask);
+    if(sigaction(SIGPROF, &action, nullptr) != 0)
+    {
+        reason = string("sigaction: ") + strerror(errno);
+        return false;
+    }
+    itimerval timer = {};
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / hz;
+    timer.it_value = timer.it_interval;
+    if(setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+    {
+        reason = string("setitimer: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void stop_profiler()
+{
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+ProfileScope::ProfileScope(const char* tag)
+:_previous_tag(scope_tag), _previous_depth(scope_depth)
+{
+    // This constructor is frame 0: the caller and its callers are the others
+    void* frames[sample_depth];
+    int depth = backtrace(frames, sample_depth);
+    scope_depth = depth < sample_depth ? depth - 1 : 0;
+    atomic_signal_fence(memory_order_seq_cst);
+    scope_tag = tag;
+    atomic_signal_fence(memory_order_seq_cst);
+}
+
+ProfileScope::~ProfileScope()
+{
+    atomic_signal_fence(memory_order_seq_cst);
+    scope_tag = _previous_tag;
+    atomic_signal_fence(memory_order_seq_cst);
+    scope_depth = _previous_depth;
+}
+
+// Folded representation of the sample, from the outermost frame within the
+// scope to the interrupted one: "demo_lambdas;count_in_list<unsigned int>;is_prime"
+static string fold(const Sample& s, map<void*, string>& names)
+{
+    // Frame 0 is the handler and frame 1 the signal trampoline. Without
+    // the frames of the scope owner, unless the stack was truncated.
+    int end = s.depth;
+    if(s.depth < sample_depth && s.scope_depth > 0 && s.scope_depth < s.depth)
+        end = s.depth - s.scope_depth;
+    string folded;
+    bool within_library_entry = true;
+    for(int i = end - 1; i >= 2; --i)
+    {
+        // Return addresses point after the call: look up the call itself
+        void* address = i > 2 ? static_cast<char*>(s.frames[i]) - 1 : s.frames[i];
+        auto found = names.find(address);
+        if(found == names.end())
+            found = names.emplace(address, symbol_name(address)).first;
+        // Skip the std::function frames between the scope and the code it runs
+        if(within_library_entry && is_library_symbol(found->second) && i > 2)
+            continue;
+        within_library_entry = false;
+        if(!folded.empty())
+            folded += ';';
+        folded += found->second;
+    }
+    return folded;
+}
+
+ProfileSummary write_folded_stacks(const string& dir)
+{
+    ProfileSummary summary;
+    summary.outside = outside_samples.load(memory_order_relaxed);
+    size_t taken = next_sample.load(memory_order_relaxed);
+    if(taken > sample_capacity)
+        summary.dropped = taken - sample_capacity;
+    if(mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+        throw runtime_error("cannot create " + dir + ": " + strerror(errno));
+
+    map<string, map<string, uint64_t>> stacks_by_tag;
+    map<void*, string> names;
+    for(size_t i = 0; samples && i < min(taken, sample_capacity); ++i)
+    {
+        const Sample& s = samples[i];
+        if(!s.ready.load(memory_order_acquire))
+            continue;
+        ++stacks_by_tag[s.tag][fold(s, names)];
+        ++summary.samples;
+    }
+    for(const auto& tag : stacks_by_tag)
+    {
+        string file_name = dir + "/" + tag.first + ".folded";
+        ofstream out(file_name);
+        if(!out)
+            throw runtime_error("cannot write " + file_name);
+        for(const auto& stack : tag.second)
+            out << stack.first << ' ' << stack.second << '\n';
+        ++summary.files;
+    }
+    return summary;
+}
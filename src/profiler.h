@@ -0,0 +1,50 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <cstdint> // for uint64_t
+#include <string>
+
+// In-process sampling profiler: setitimer(ITIMER_PROF) sends SIGPROF at a
+// fixed rate of CPU time, and the handler records the call stack of the
+// interrupted thread into a preallocated buffer. The stacks are attributed
+// to the ProfileScope the thread is in, and written as folded stacks
+// (one "caller;callee count" line each), the input of flamegraph.pl,
+// speedscope or inferno.
+
+/// Starts sampling all the threads, hz times per second of CPU time each.
+/// Returns false, with the reason, if the timer cannot be set.
+bool start_profiler(unsigned int hz, std::string& reason);
+
+/// Stops the timer; the samples taken so far are kept
+void stop_profiler();
+
+/// Attributes the samples of the calling thread to the given tag (e.g. a demo
+/// name) for the lifetime of the object. The tag must outlive the program.
+/// The frames of the function creating the scope and of its callers are
+/// left out of the stacks, which start at the code run within the scope.
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* tag);
+    ~ProfileScope();
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+    const char* _previous_tag;
+    int _previous_depth;
+};
+
+/// What write_folded_stacks found
+struct ProfileSummary
+{
+    uint64_t samples = 0;   ///< written, over all the tags
+    uint64_t outside = 0;   ///< taken outside any ProfileScope
+    uint64_t dropped = 0;   ///< lost because the buffer was full
+    unsigned int files = 0;
+};
+
+/// Writes the samples of each tag to DIR/<tag>.folded, creating DIR if needed.
+/// Throws std::runtime_error if a file cannot be written.
+ProfileSummary write_folded_stacks(const std::string& dir);
+
+#endif /* _PROFILER_H_ */
@@ -0,0 +1,296 @@
+#include <algorithm> // for copy, min, sort
+#include <array>
+#include <cstdint> // for uint8_t to uint64_t
+#include <iostream>
+#include <list>
+#include <stdexcept> // for invalid_argument
+#include <string>
+#include <thread>
+#include <vector>
+#include "radix_sort.h"
+#include "demo_output.h"
+
+using namespace std;
+
+// Bits of the key in the unsigned order of the kind
+template<RadixKey kind, typename Bits>
+static inline Bits ordered(Bits bits)
+{
+    const Bits sign = Bits(Bits(1) << (8 * sizeof(Bits) - 1));
+    return kind == RadixKey::Unsigned ? bits
+        : kind == RadixKey::Signed ? Bits(bits ^ sign)
+        : bits & sign ? Bits(~bits) : Bits(bits | sign);
+}
+
+// Value type when the keys are sorted alone
+struct NoValue {};
+
+// Below this, an insertion sort beats the passes over the 256 counters
+static const size_t small_sort = 64;
+// Keys per thread below which another thread is not worth starting
+static const size_t keys_per_thread = size_t(1) << 18;
+
+// Runs f(0) to f(count - 1), f(0) on the calling thread
+template<typename F>
+static void run_threads(unsigned int count, F f)
+{
+    vector<thread> workers;
+    for(unsigned int t = 1; t < count; ++t)
+        workers.emplace_back(f, t);
+    f(0);
+    for(auto& worker : workers)
+        worker.join();
+}
+
+template<typename Bits, RadixKey kind, typename Value>
+struct RadixSorter
+{
+    static const unsigned int digits = sizeof(Bits);
+    static const bool with_values = !is_same<Value, NoValue>::value;
+    typedef array<array<size_t, 256>, sizeof(Bits)> Counts;
+
+    static unsigned int digit(Bits key, unsigned int d)
+    {
+        return (ordered<kind>(key) >> (8 * d)) & 0xff;
+    }
+
+    static void insertion_sort(Bits* keys, Value* values, size_t n)
+    {
+        for(size_t i = 1; i < n; ++i)
+        {
+            Bits key = keys[i];
+            Value value = with_values ? values[i] : Value();
+            size_t j = i;
+            for(; j > 0 && ordered<kind>(keys[j - 1]) > ordered<kind>(key); --j)
+            {
+                keys[j] = keys[j - 1];
+                if(with_values)
+                    values[j] = values[j - 1];
+            }
+            keys[j] = key;
+            if(with_values)
+                values[j] = value;
+        }
+    }
+
+    // Counts of the bytes of every digit, in one pass
+    static void count(const Bits* keys, size_t n, Counts& counts)
+    {
+        for(auto& c : counts)
+            c.fill(0);
+        for(size_t i = 0; i < n; ++i)
+        {
+            Bits key = ordered<kind>(keys[i]);
+            for(unsigned int d = 0; d < digits; ++d)
+                ++counts[d][(key >> (8 * d)) & 0xff];
+        }
+    }
+
+    // Stable distribution of the keys by digit d, from the first offset of each byte
+    static void scatter(const Bits* from, const Value* from_values, size_t n, unsigned int d,
+                        array<size_t, 256>& offsets, Bits* to, Value* to_values)
+    {
+        for(size_t i = 0; i < n; ++i)
+        {
+            size_t position = offsets[digit(from[i], d)]++;
+            to[position] = from[i];
+            if(with_values)
+                to_values[position] = from_values[i];
+        }
+    }
+
+    static void run(Bits* keys, Value* values, size_t n, unsigned int threads)
+    {
+        if(n < small_sort)
+            return insertion_sort(keys, values, n);
+        threads = unsigned(min<size_t>(threads, max<size_t>(1, n / keys_per_thread)));
+        size_t slice = (n + threads - 1) / threads;
+        auto slice_of = [&](unsigned int t, size_t& first, size_t& last) {
+            first = min(n, t * slice);
+            last = min(n, first + slice);
+        };
+
+        // The counts per digit are the same whatever the order: they
+        // tell the digits to skip once for all the passes
+        vector<Counts> counts(threads);
+        run_threads(threads, [&](unsigned int t) {
+            size_t first, last;
+            slice_of(t, first, last);
+            count(keys + first, last - first, counts[t]);
+        });
+        Counts total = counts[0];
+        for(unsigned int t = 1; t < threads; ++t)
+            for(unsigned int d = 0; d < digits; ++d)
+                for(unsigned int b = 0; b < 256; ++b)
+                    total[d][b] += counts[t][d][b];
+
+        vector<Bits> key_buffer(n);
+        vector<Value> value_buffer(with_values ? n : 0);
+        Bits* from = keys;
+        Bits* to = key_buffer.data();
+        Value* from_values = values;
+        Value* to_values = value_buffer.data();
+        vector<array<size_t, 256>> offsets(threads);
+        bool moved = false;
+        for(unsigned int d = 0; d < digits; ++d)
+        {
+            if(total[d][digit(from[0], d)] == n)
+                continue;
+            // Once the keys have moved, the slices hold other keys than
+            // those counted, but for a single slice: the whole of them
+            if(moved && threads > 1)
+                run_threads(threads, [&](unsigned int t) {
+                    size_t first, last;
+                    slice_of(t, first, last);
+                    counts[t][d].fill(0);
+                    for(size_t i = first; i < last; ++i)
+                        ++counts[t][d][digit(from[i], d)];
+                });
+            // Byte b of thread t starts after the smaller bytes, then
+            // after byte b of the threads before
+            size_t offset = 0;
+            for(unsigned int b = 0; b < 256; ++b)
+                for(unsigned int t = 0; t < threads; ++t)
+                {
+                    offsets[t][b] = offset;
+                    offset += counts[t][d][b];
+                }
+            run_threads(threads, [&](unsigned int t) {
+                size_t first, last;
+                slice_of(t, first, last);
+                scatter(from + first, from_values + (with_values ? first : 0), last - first, d, offsets[t], to,
+                        to_values);
+            });
+            swap(from, to);
+            swap(from_values, to_values);
+            moved = true;
+        }
+        if(from != keys)
+        {
+            copy(from, from + n, keys);
+            if(with_values)
+                copy(from_values, from_values + n, values);
+        }
+    }
+};
+
+template<typename Bits, RadixKey kind>
+static void dispatch_values(void* keys, size_t n, void* values, unsigned int value_bytes, unsigned int threads)
+{
+    Bits* k = static_cast<Bits*>(keys);
+    if(!values)
+        return RadixSorter<Bits, kind, NoValue>::run(k, nullptr, n, threads);
+    switch(value_bytes)
+    {
+    case 1: return RadixSorter<Bits, kind, uint8_t>::run(k, static_cast<uint8_t*>(values), n, threads);
+    case 2: return RadixSorter<Bits, kind, uint16_t>::run(k, static_cast<uint16_t*>(values), n, threads);
+    case 4: return RadixSorter<Bits, kind, uint32_t>::run(k, static_cast<uint32_t*>(values), n, threads);
+    case 8: return RadixSorter<Bits, kind, uint64_t>::run(k, static_cast<uint64_t*>(values), n, threads);
+    default:
+        throw invalid_argument("radix sort: values of " + to_string(value_bytes) + " bytes");
+    }
+}
+
+template<typename Bits>
+static void dispatch_kind(void* keys, size_t n, RadixKey kind, void* values, unsigned int value_bytes,
+                          unsigned int threads)
+{
+    switch(kind)
+    {
+    case RadixKey::Unsigned: return dispatch_values<Bits, RadixKey::Unsigned>(keys, n, values, value_bytes, threads);
+    case RadixKey::Signed: return dispatch_values<Bits, RadixKey::Signed>(keys, n, values, value_bytes, threads);
+    default:
+        if(sizeof(Bits) < 4)
+            throw invalid_argument("radix sort: floating-point keys of " + to_string(sizeof(Bits)) + " bytes");
+        return dispatch_values<Bits, RadixKey::Float>(keys, n, values, value_bytes, threads);
+    }
+}
+
+void radix_sort(void* keys, size_t n, unsigned int key_bytes, RadixKey kind,
+                void* values, unsigned int value_bytes, unsigned int threads)
+{
+    if(threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    switch(key_bytes)
+    {
+    case 1: return dispatch_kind<uint8_t>(keys, n, kind, values, value_bytes, threads);
+    case 2: return dispatch_kind<uint16_t>(keys, n, kind, values, value_bytes, threads);
+    case 4: return dispatch_kind<uint32_t>(keys, n, kind, values, value_bytes, threads);
+    case 8: return dispatch_kind<uint64_t>(keys, n, kind, values, value_bytes, threads);
+    default:
+        throw invalid_argument("radix sort: keys of " + to_string(key_bytes) + " bytes");
+    }
+}
+
+void demo_radix_sort()
+{
+    demo_out() << endl << "************** Radix sort **************" << endl;
+
+    // The IDs of the reversed list of range_based_loops: a list is copied
+    // to a vector to be sorted in place, then back
+    list<unsigned int> lData { 2, 3, 5, 6, 11, 3, 17 };
+    vector<unsigned int> ids(lData.begin(), lData.end());
+    radix_sort(ids);
+    lData.assign(ids.begin(), ids.end());
+    demo_out() << "Sorted IDs : ";
+    for(unsigned int id : lData)
+        demo_out() << id << " ";
+    demo_out() << endl;
+
+    // Beyond the small sort: the passes of the bytes that differ
+    vector<uint64_t> large(1000);
+    uint64_t seed = 1;
+    for(auto& v : large)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        v = (seed >> 40) % 100000;
+    }
+    vector<uint64_t> expected = large;
+    sort(expected.begin(), expected.end());
+    radix_sort(large);
+    demo_out() << large.size() << " 64-bit IDs below 100000 (3 passes of 8) sorted ? "
+               << (large == expected ? "true" : "false") << endl;
+
+    vector<int> temperatures { 12, -3, 0, 27, -15, 8, -3 };
+    radix_sort(temperatures);
+    demo_out() << "Signed : ";
+    for(int t : temperatures)
+        demo_out() << t << " ";
+    demo_out() << endl;
+
+    vector<double> prices { 3.5, -0.25, 100.0, 0.0, -7.75, 1e-3, 2.5 };
+    radix_sort(prices);
+    demo_out() << "Floating point : ";
+    for(double p : prices)
+        demo_out() << p << " ";
+    demo_out() << endl;
+
+    // Key-value: the names follow their scores, equal scores in their order
+    vector<uint16_t> scores { 70, 95, 70, 82 };
+    vector<const char*> names { "Ana", "Bo", "Cy", "Di" };
+    radix_sort(scores, names);
+    demo_out() << "Pairs : ";
+    for(size_t i = 0; i < scores.size(); ++i)
+        demo_out() << scores[i] << " " << names[i] << ", ";
+    demo_out() << endl;
+
+    vector<unsigned int> many(1 << 20);
+    for(auto& v : many)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        v = uint32_t(seed >> 32);
+    }
+    parallel_radix_sort(many);
+    demo_out() << many.size() << " IDs sorted in parallel ? "
+               << (is_sorted(many.begin(), many.end()) ? "true" : "false") << endl;
+
+    try
+    {
+        names.pop_back();
+        radix_sort(scores, names);
+    }
+    catch(invalid_argument const& e)
+    {
+        demo_out() << "Error : " << e.what() << endl;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef _RADIX_SORT_H_
+#define _RADIX_SORT_H_
+
+#include <cstddef> // for size_t
+#include <stdexcept> // for invalid_argument
+#include <string> // for to_string
+#include <type_traits> // for is_arithmetic, is_floating_point, is_signed
+#include <vector>
+
+/// Radix sort demo: unsigned IDs, signed and floating-point keys, pairs
+void demo_radix_sort();
+
+/// How the bits of a key are read as an unsigned integer of the same order
+enum class RadixKey : unsigned int
+{
+    Unsigned,   ///< as they are
+    Signed,     ///< sign bit flipped: the negative keys first
+    Float       ///< IEEE 754: sign bit flipped for the positive keys, all bits for the negative ones
+};
+
+// Least significant digit radix sort: the keys are distributed by each
+// byte in turn, from the lowest, each pass stable. One pre-pass counts
+// the bytes of every digit at once; a digit whose byte is the same in all
+// keys is skipped (e.g. the high bytes of small IDs), so 64-bit keys of
+// small range cost a pass or two. O(n) for n keys, plus a buffer of
+// n keys (and values). Stable: equal keys keep their order, and the values
+// of key-value sorts follow their keys. -0.0 sorts before 0.0, the NaNs
+// after +infinity if their sign bit is clear, before -infinity if set.
+
+/// Sorts n keys of key_bytes (1, 2, 4 or 8), and the values of value_bytes
+/// (1, 2, 4 or 8) with them unless values is null, on up to threads threads
+/// (0 for the hardware concurrency). Throws std::invalid_argument for other
+/// sizes, and for floating-point keys of other than 4 or 8 bytes.
+void radix_sort(void* keys, size_t n, unsigned int key_bytes, RadixKey kind,
+                void* values, unsigned int value_bytes, unsigned int threads);
+
+/// The key kind of an arithmetic type
+template<typename T>
+constexpr RadixKey radix_key()
+{
+    static_assert(std::is_arithmetic<T>::value, "radix sort: integer or floating-point keys only");
+    return std::is_floating_point<T>::value ? RadixKey::Float
+        : std::is_signed<T>::value ? RadixKey::Signed : RadixKey::Unsigned;
+}
+
+template<typename T>
+void radix_sort(T* keys, size_t n)
+{
+    radix_sort(keys, n, sizeof(T), radix_key<T>(), nullptr, 0, 1);
+}
+
+template<typename T>
+void radix_sort(std::vector<T>& keys)
+{
+    radix_sort(keys.data(), keys.size());
+}
+
+/// Sorts the keys, and values[i] along with keys[i]: values of a
+/// trivially copyable type of 1, 2, 4 or 8 bytes, e.g. indexes or pointers
+template<typename K, typename V>
+void radix_sort(K* keys, V* values, size_t n)
+{
+    static_assert(std::is_trivially_copyable<V>::value, "radix sort: values are moved as bytes");
+    radix_sort(keys, n, sizeof(K), radix_key<K>(), values, sizeof(V), 1);
+}
+
+/// Throws std::invalid_argument unless there are as many values as keys
+template<typename K, typename V>
+void radix_sort(std::vector<K>& keys, std::vector<V>& values)
+{
+    if(keys.size() != values.size())
+        throw std::invalid_argument("radix sort: " + std::to_string(keys.size()) + " keys but "
+                                    + std::to_string(values.size()) + " values");
+    radix_sort(keys.data(), values.data(), keys.size());
+}
+
+/// Multi-threaded: each pass counts and distributes a slice of the keys
+/// per thread. Worth it from about a million keys; fewer are sorted on
+/// the calling thread.
+template<typename T>
+void parallel_radix_sort(T* keys, size_t n, unsigned int threads = 0)
+{
+    radix_sort(keys, n, sizeof(T), radix_key<T>(), nullptr, 0, threads);
+}
+
+template<typename T>
+void parallel_radix_sort(std::vector<T>& keys, unsigned int threads = 0)
+{
+    parallel_radix_sort(keys.data(), keys.size(), threads);
+}
+
+#endif /* _RADIX_SORT_H_ */
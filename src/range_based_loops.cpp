@@ -1,4 +1,5 @@
 #include "range_based_loops.h"
+#include "demo_output.h"
 #include <iostream>
 #include <vector>
 #include <list>
@@ -32,37 +33,37 @@ Reversed<TContainer> make_reversed(const TContainer& c)
 
 void demo_range_based_loops()
 {
-    cout << endl << "*************** Range Based Loops ********" << endl;
+    demo_out() << endl << "*************** Range Based Loops ********" << endl;
     // Basic 10-element integer array.
     int aData[10] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
 
     // Access by value using a copy declared as a specific type.
     for( int y : aData ) {
-        cout << y << " ";
+        demo_out() << y << " ";
     }
-    cout << endl;
+    demo_out() << endl;
 
     // The auto keyword causes type inference to be used. Preferred.
     // Each element of 'aData' is copied int y, almost always undesirable
     for( auto y : aData ) {
-        cout << y << " ";
+        demo_out() << y << " ";
     }
-    cout << endl;
+    demo_out() << endl;
 
     // Type inference by reference. Preferred when modify is needed.
     for( auto& y : aData ) {
         y+=5;
-        cout << y << " ";
+        demo_out() << y << " ";
     }
-    cout << endl;
+    demo_out() << endl;
 
     // Type inference by constant reference. Preferred when no modify is needed.
     for( const auto& y : aData ) {
-        cout << y << " ";
+        demo_out() << y << " ";
     }
-    cout << endl;
-    cout << "end of integer array test" << endl;
-    cout << endl;
+    demo_out() << endl;
+    demo_out() << "end of integer array test" << endl;
+    demo_out() << endl;
 
     // Create a vector object that contains 10 elements.
     vector<double> vData;
@@ -72,29 +73,29 @@ void demo_range_based_loops()
 
     // Range-based for loop to iterate through the vector, observing in-place.
     for( const auto &j : vData ) {
-        cout << j << " ";
+        demo_out() << j << " ";
     }
-    cout << endl;
-    cout << "end of vector test" << endl;
-    cout << endl;
+    demo_out() << endl;
+    demo_out() << "end of vector test" << endl;
+    demo_out() << endl;
 
     // Range-based for loop to iterate backwards through a list, observing in-place.
     list<unsigned int> lData { 2, 3, 5, 6, 11, 3, 17 };
     for (const auto & k : make_reversed(lData))
     {
-        cout << k << " ";
+        demo_out() << k << " ";
     }
-    cout << endl;
-    cout << "end of reversed list test" << endl;
-    cout << endl;
+    demo_out() << endl;
+    demo_out() << "end of reversed list test" << endl;
+    demo_out() << endl;
 
     map<int, char> m {{1, 'a'}, {3, 'b'}, {5, 'c'}, {7, 'd'}};
     for(const auto & v : m)
     {
-        cout << v.first << " -> " << v.second << endl;
+        demo_out() << v.first << " -> " << v.second << endl;
     }
 
-    cout << "end of map test" << endl;
-    cout << endl;
+    demo_out() << "end of map test" << endl;
+    demo_out() << endl;
 }
 
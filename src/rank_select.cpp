@@ -0,0 +1,221 @@
+#include <iostream>
+#include <utility> // for std::move
+#include "rank_select.h"
+#include "bit_manipulation.h" // for popcount_words
+#include "cpu_features.h"
+#include "demo_output.h"
+
+using namespace std;
+
+const size_t RankSelect::npos;
+const size_t RankSelect::block_bits;
+const size_t RankSelect::superblock_bits;
+const size_t RankSelect::select_sample;
+
+static const size_t block_words = RankSelect::block_bits / 64;
+static const size_t superblock_words = RankSelect::superblock_bits / 64;
+static const size_t superblocks_per_count = size_t(1) << 21;  // 2^32 bits
+
+// Counts of the first 3 blocks of a superblock, in its entry
+static unsigned int block_count(uint64_t entry, size_t block)
+{
+    return (entry >> (32 + 10 * block)) & 0x3ff;
+}
+
+// In-block kernels, one variant per instruction set. The blocks are one
+// cache line: counting them takes at most 8 popcounts.
+
+// Set bits among the first bits of the words (bits < 512).
+// Baseline: the builtin of bit_count is a call to libgcc.
+static size_t popcount_prefix_scalar(const uint64_t* words, size_t bits)
+{
+    size_t total = 0;
+    for(size_t w = 0; w < bits / 64; ++w)
+        total += bit_count(words[w]);
+    if(bits % 64)
+        total += bit_count(words[bits / 64] & ((uint64_t(1) << (bits % 64)) - 1));
+    return total;
+}
+
+// Offset of the k-th set bit of the words, known to be among them:
+// whole words are skipped by their count, then the lowest set bits
+// are stripped off the word until the k-th is the lowest
+static size_t select_in_block_scalar(const uint64_t* words, size_t k)
+{
+    for(size_t w = 0; ; ++w)
+    {
+        unsigned int n = bit_count(words[w]);
+        if(k < n)
+        {
+            uint64_t word = words[w];
+            for(; k; --k)
+                word = strip_lowest_set_bit(word);
+            return w * 64 + count_trailing_zeros(word);
+        }
+        k -= n;
+    }
+}
+
+#ifdef HAS_X86_KERNELS
+// Same code, where bit_count is the POPCNT instruction
+__attribute__((target("popcnt")))
+static size_t popcount_prefix_sse42(const uint64_t* words, size_t bits)
+{
+    size_t total = 0;
+    for(size_t w = 0; w < bits / 64; ++w)
+        total += bit_count(words[w]);
+    if(bits % 64)
+        total += bit_count(words[bits / 64] & ((uint64_t(1) << (bits % 64)) - 1));
+    return total;
+}
+
+__attribute__((target("popcnt")))
+static size_t select_in_block_sse42(const uint64_t* words, size_t k)
+{
+    for(size_t w = 0; ; ++w)
+    {
+        unsigned int n = bit_count(words[w]);
+        if(k < n)
+        {
+            uint64_t word = words[w];
+            for(; k; --k)
+                word = strip_lowest_set_bit(word);
+            return w * 64 + count_trailing_zeros(word);
+        }
+        k -= n;
+    }
+}
+
+// In-word select in constant time: PDEP deposits the single bit of 1 << k
+// at the position of the k-th set bit of the word, TZCNT reads it back
+__attribute__((target("popcnt,bmi,bmi2")))
+static size_t select_in_block_avx2(const uint64_t* words, size_t k)
+{
+    for(size_t w = 0; ; ++w)
+    {
+        unsigned int n = bit_count(words[w]);
+        if(k < n)
+            return w * 64 + count_trailing_zeros(_pdep_u64(uint64_t(1) << k, words[w]));
+        k -= n;
+    }
+}
+#endif
+
+static const Kernel<size_t (*)(const uint64_t*, size_t)> popcount_prefix_kernel(
+    "rank_select.popcount_prefix", popcount_prefix_scalar, X86_KERNEL(popcount_prefix_sse42), nullptr, nullptr);
+
+static const Kernel<size_t (*)(const uint64_t*, size_t)> select_in_block_kernel(
+    "rank_select.select_in_block", select_in_block_scalar, X86_KERNEL(select_in_block_sse42),
+    X86_KERNEL(select_in_block_avx2), nullptr);
+
+RankSelect::RankSelect(DynamicBitset bits)
+:_bits(std::move(bits)), _ones(0)
+{
+    const uint64_t* words = _bits.data();
+    size_t word_count = _bits.word_count();
+    // One more superblock than needed, starting at size(), so that rank1(size()) reads an entry
+    size_t superblocks = word_count / superblock_words + 1;
+    _superblocks.reserve(superblocks);
+    size_t next_sample = 0;
+    for(size_t s = 0; s < superblocks; ++s)
+    {
+        if(s % superblocks_per_count == 0)
+            _counts.push_back(_ones);
+        uint64_t entry = _ones - _counts.back();
+        size_t superblock_ones = 0;
+        for(size_t b = 0; b < 4; ++b)
+        {
+            size_t first = s * superblock_words + b * block_words;
+            // The word count is a multiple of the block: no partial block
+            size_t n = first < word_count ? popcount_words(words + first, block_words) : 0;
+            if(b < 3)
+                entry |= uint64_t(n) << (32 + 10 * b);
+            superblock_ones += n;
+        }
+        _superblocks.push_back(entry);
+        _ones += superblock_ones;
+        for(; next_sample < _ones; next_sample += select_sample)
+            _samples.push_back(uint32_t(s));
+    }
+}
+
+size_t RankSelect::rank1(size_t i) const
+{
+    size_t superblock = i / superblock_bits;
+    size_t rank = superblock_rank(superblock);
+    uint64_t entry = _superblocks[superblock];
+    size_t block = (i / block_bits) % 4;
+    for(size_t b = 0; b < block; ++b)
+        rank += block_count(entry, b);
+    if(i % block_bits)
+        rank += popcount_prefix_kernel(_bits.data() + i / block_bits * block_words, i % block_bits);
+    return rank;
+}
+
+size_t RankSelect::select1(size_t k) const
+{
+    if(k >= _ones)
+        return npos;
+    // The last superblock starting at or before the k-th set bit lies
+    // between the samples around it: binary search in between
+    size_t sample = k / select_sample;
+    size_t low = _samples[sample];
+    size_t high = sample + 1 < _samples.size() ? _samples[sample + 1] : _superblocks.size() - 1;
+    while(low < high)
+    {
+        size_t middle = low + (high - low + 1) / 2;
+        if(superblock_rank(middle) <= k)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    k -= superblock_rank(low);
+    uint64_t entry = _superblocks[low];
+    size_t block = 0;
+    for(; block < 3 && k >= block_count(entry, block); ++block)
+        k -= block_count(entry, block);
+    size_t first_word = low * superblock_words + block * block_words;
+    return first_word * 64 + select_in_block_kernel(_bits.data() + first_word, k);
+}
+
+size_t RankSelect::index_bytes() const
+{
+    return _counts.size() * sizeof(uint64_t) + _superblocks.size() * sizeof(uint64_t)
+         + _samples.size() * sizeof(uint32_t);
+}
+
+void demo_rank_select()
+{
+    demo_out() << endl << "*************** Rank/Select **************" << endl;
+
+    // 1000 customer IDs scattered over a space of a million:
+    // the ID of the customer number i is i*i + 7
+    size_t id_space = 1000000;
+    DynamicBitset id_bits(id_space);
+    for(size_t i = 0; i < 1000; ++i)
+        id_bits.set(i * i + 7);
+    RankSelect ids(std::move(id_bits));
+    demo_out() << "IDs : " << ids.count() << " among " << ids.size() << endl;
+    demo_out() << "Bits: " << ids.bits().word_count() * sizeof(uint64_t) << " bytes, index: "
+               << ids.index_bytes() << " bytes" << endl;
+
+    // rank1 maps the IDs to dense indexes, e.g. into an array of 1000
+    // records, and select1 maps the indexes back to the IDs
+    size_t id = 500 * 500 + 7;
+    demo_out() << "Index of ID " << id << " : " << ids.rank1(id) << endl;
+    demo_out() << "ID of index 500 : " << ids.select1(500) << endl;
+    demo_out() << "Is 250008 an ID ? " << (ids[250008] ? "true" : "false")
+               << ", IDs below it : " << ids.rank1(250008) << endl;
+    demo_out() << "Unused IDs below " << id << " : " << ids.rank0(id) << endl;
+    demo_out() << "Last ID : " << ids.select1(999) << ", index 1000 is "
+               << (ids.select1(1000) == RankSelect::npos ? "past the end" : "an ID") << endl;
+
+    demo_out() << "First IDs :";
+    for(size_t i : ids)
+    {
+        if(i > 100)
+            break;
+        demo_out() << ' ' << i;
+    }
+    demo_out() << endl;
+}
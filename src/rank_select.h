@@ -0,0 +1,72 @@
+#ifndef _RANK_SELECT_H_
+#define _RANK_SELECT_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t, uint32_t
+#include <vector>
+#include "dynamic_bitset.h"
+
+/// Rank/select demo: a sparse ID space mapped to dense indexes
+void demo_rank_select();
+
+/// Succinct index over a bit vector: rank1(i), the number of set bits
+/// below i, in constant time, and select1(k), the position of the k-th
+/// set bit, with a short search. The bits are not modified after
+/// construction; they and the index share nothing else.
+///
+/// Layout of the index (Zhou, Andersen, Kaminsky, "Space-Efficient,
+/// High-Performance Rank & Select Structures on Uncompressed Bit Sequences"):
+/// the bits are cut in 512-bit blocks (one cache line) grouped by 4 in
+/// superblocks. One 64-bit entry per superblock interleaves its count
+/// (the set bits before it, 32 bits) with the counts of its first 3
+/// blocks (10 bits each), and one 64-bit count per 2^32 bits completes
+/// the entries. A rank is then one entry, one cache line of bits and at
+/// most 8 popcounts. select1 starts from the superblock of a sampled set
+/// bit, every 8192, and ends with an in-word select (PDEP with BMI2).
+/// The index takes about 3.2% of the size of the bits, plus 0.4% at most
+/// for the samples.
+class RankSelect
+{
+public:
+    static const size_t npos = DynamicBitset::npos;
+    static const size_t block_bits = 512;
+    static const size_t superblock_bits = 4 * block_bits;
+    static const size_t select_sample = 8192;
+
+    explicit RankSelect(DynamicBitset bits);
+
+    size_t size() const { return _bits.size(); }
+    /// Number of set bits
+    size_t count() const { return _ones; }
+    bool operator[](size_t i) const { return _bits[i]; }
+    const DynamicBitset& bits() const { return _bits; }
+
+    /// Set bits at the positions below i, for i <= size()
+    size_t rank1(size_t i) const;
+    /// Clear bits at the positions below i, for i <= size()
+    size_t rank0(size_t i) const { return i - rank1(i); }
+    /// Position of the k-th set bit, from 0; npos if k >= count()
+    size_t select1(size_t k) const;
+
+    /// Memory used by the index, beside the bits
+    size_t index_bytes() const;
+
+    /// Positions of the set bits, e.g. for(size_t i : ids)
+    SetBitIterator begin() const { return _bits.begin(); }
+    SetBitIterator end() const { return _bits.end(); }
+
+private:
+    /// Set bits before the superblock
+    size_t superblock_rank(size_t superblock) const
+    {
+        return _counts[superblock >> 21] + uint32_t(_superblocks[superblock]);
+    }
+
+    DynamicBitset _bits;
+    size_t _ones;
+    std::vector<uint64_t> _counts;      ///< set bits before each 2^32 bits
+    std::vector<uint64_t> _superblocks; ///< one per superblock, plus one past the end
+    std::vector<uint32_t> _samples;     ///< superblock of every select_sample-th set bit
+};
+
+#endif /* _RANK_SELECT_H_ */
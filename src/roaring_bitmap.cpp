@@ -0,0 +1,668 @@
+#include <algorithm> // for lower_bound, upper_bound, binary_search
+#include <iostream>
+#include <stdexcept> // for invalid_argument
+#include <utility> // for std::move
+#include "roaring_bitmap.h"
+#include "demo_output.h"
+
+using namespace std;
+
+const size_t RoaringBitmap::max_array_size;
+
+static const size_t chunk_bits = 65536;
+static const size_t bitmap_bytes = chunk_bits / 8;
+static const size_t not_found = static_cast<size_t>(-1);
+
+bool RoaringBitmap::Container::contains(uint16_t value) const
+{
+    switch(type)
+    {
+    case ContainerType::Array:
+        return binary_search(values.begin(), values.end(), value);
+    case ContainerType::Bitmap:
+        return bitmap[value];
+    default:
+    {
+        // Last run starting at or before the value
+        size_t low = 0, high = values.size() / 2;
+        while(low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if(values[2 * middle] <= value)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low > 0 && value <= uint32_t(values[2 * (low - 1)]) + values[2 * (low - 1) + 1];
+    }
+    }
+}
+
+void RoaringBitmap::Container::add(uint16_t value)
+{
+    switch(type)
+    {
+    case ContainerType::Array:
+    {
+        auto position = lower_bound(values.begin(), values.end(), value);
+        if(position != values.end() && *position == value)
+            return;
+        if(cardinality < max_array_size)
+        {
+            values.insert(position, value);
+            ++cardinality;
+            return;
+        }
+        // The 4097th value: a bitmap is now smaller
+        *this = to_bitmap(*this);
+        add(value);
+        return;
+    }
+    case ContainerType::Bitmap:
+        if(!bitmap[value])
+        {
+            bitmap.set(value);
+            ++cardinality;
+        }
+        return;
+    default:
+        if(!contains(value))
+        {
+            *this = expand_runs(*this);
+            add(value);
+        }
+        return;
+    }
+}
+
+// Runs of consecutive values. In a bitmap word, a run starts at each set
+// bit whose lower neighbour, in the word or at the top of the previous
+// one, is clear.
+size_t RoaringBitmap::Container::run_count() const
+{
+    switch(type)
+    {
+    case ContainerType::Array:
+    {
+        size_t runs = values.empty() ? 0 : 1;
+        for(size_t i = 1; i < values.size(); ++i)
+            runs += values[i] != values[i - 1] + 1;
+        return runs;
+    }
+    case ContainerType::Bitmap:
+    {
+        size_t runs = 0;
+        uint64_t carry = 0;
+        const uint64_t* words = bitmap.data();
+        for(size_t w = 0; w < chunk_bits / 64; ++w)
+        {
+            runs += bit_count(words[w] & ~((words[w] << 1) | carry));
+            carry = words[w] >> 63;
+        }
+        return runs;
+    }
+    default:
+        return values.size() / 2;
+    }
+}
+
+// As serialized
+size_t RoaringBitmap::Container::size_in_bytes() const
+{
+    switch(type)
+    {
+    case ContainerType::Array: return cardinality * sizeof(uint16_t);
+    case ContainerType::Bitmap: return bitmap_bytes;
+    default: return sizeof(uint16_t) + values.size() * sizeof(uint16_t);
+    }
+}
+
+RoaringBitmap::Container RoaringBitmap::to_bitmap(const Container& c)
+{
+    Container bitmap;
+    bitmap.type = ContainerType::Bitmap;
+    bitmap.cardinality = c.cardinality;
+    bitmap.bitmap = DynamicBitset(chunk_bits);
+    c.for_each([&bitmap](uint32_t v) { bitmap.bitmap.set(v); });
+    return bitmap;
+}
+
+RoaringBitmap::Container RoaringBitmap::to_array(const Container& c)
+{
+    Container array;
+    array.cardinality = c.cardinality;
+    array.values.reserve(c.cardinality);
+    c.for_each([&array](uint32_t v) { array.values.push_back(uint16_t(v)); });
+    return array;
+}
+
+RoaringBitmap::Container RoaringBitmap::expand_runs(const Container& c)
+{
+    return c.cardinality > max_array_size ? to_bitmap(c) : to_array(c);
+}
+
+RoaringBitmap::Container RoaringBitmap::normalized(Container c)
+{
+    if(c.type == ContainerType::Bitmap && c.cardinality <= max_array_size)
+        return to_array(c);
+    if(c.type == ContainerType::Array && c.cardinality > max_array_size)
+        return to_bitmap(c);
+    return c;
+}
+
+// Merge of two sorted arrays
+static vector<uint16_t> combine_arrays(BitOp op, const vector<uint16_t>& a, const vector<uint16_t>& b)
+{
+    vector<uint16_t> result;
+    result.reserve(op == BitOp::And ? min(a.size(), b.size()) : a.size() + b.size());
+    size_t i = 0, j = 0;
+    while(i < a.size() && j < b.size())
+    {
+        if(a[i] < b[j])
+        {
+            if(op != BitOp::And)
+                result.push_back(a[i]);
+            ++i;
+        }
+        else if(b[j] < a[i])
+        {
+            if(op == BitOp::Or || op == BitOp::Xor)
+                result.push_back(b[j]);
+            ++j;
+        }
+        else
+        {
+            if(op == BitOp::And || op == BitOp::Or)
+                result.push_back(a[i]);
+            ++i;
+            ++j;
+        }
+    }
+    if(op != BitOp::And)
+        result.insert(result.end(), a.begin() + i, a.end());
+    if(op == BitOp::Or || op == BitOp::Xor)
+        result.insert(result.end(), b.begin() + j, b.end());
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::combine(BitOp op, const Container& a, const Container& b)
+{
+    // Runs take part as arrays or bitmaps
+    if(a.type == ContainerType::Run)
+        return combine(op, expand_runs(a), b);
+    if(b.type == ContainerType::Run)
+        return combine(op, a, expand_runs(b));
+
+    Container result;
+    if(a.type == ContainerType::Array && b.type == ContainerType::Array)
+    {
+        result.values = combine_arrays(op, a.values, b.values);
+        result.cardinality = uint32_t(result.values.size());
+        return normalized(std::move(result));
+    }
+
+    // An array filtered by a bitmap, where the result is a subset of the array
+    bool keep_in_bitmap = true;
+    const Container* array = nullptr;
+    const Container* bitmap = nullptr;
+    if(op == BitOp::And)
+    {
+        array = a.type == ContainerType::Array ? &a : b.type == ContainerType::Array ? &b : nullptr;
+        bitmap = array == &a ? &b : &a;
+    }
+    else if(op == BitOp::AndNot && a.type == ContainerType::Array)
+    {
+        array = &a;
+        bitmap = &b;
+        keep_in_bitmap = false;
+    }
+    if(array)
+    {
+        for(uint16_t v : array->values)
+        {
+            if(bitmap->bitmap[v] == keep_in_bitmap)
+                result.values.push_back(v);
+        }
+        result.cardinality = uint32_t(result.values.size());
+        return result;
+    }
+
+    // Otherwise as bitmaps, with the SIMD kernels
+    result = a.type == ContainerType::Bitmap ? a : to_bitmap(a);
+    if(b.type == ContainerType::Bitmap)
+        result.bitmap.apply(op, b.bitmap);
+    else
+        result.bitmap.apply(op, to_bitmap(b).bitmap);
+    result.cardinality = uint32_t(result.bitmap.count());
+    return normalized(std::move(result));
+}
+
+RoaringBitmap::RoaringBitmap(initializer_list<uint32_t> values)
+{
+    for(uint32_t v : values)
+        add(v);
+}
+
+size_t RoaringBitmap::find(uint16_t key) const
+{
+    auto position = lower_bound(_keys.begin(), _keys.end(), key);
+    return position != _keys.end() && *position == key ? size_t(position - _keys.begin()) : not_found;
+}
+
+RoaringBitmap::Container& RoaringBitmap::container_for(uint16_t key)
+{
+    auto position = lower_bound(_keys.begin(), _keys.end(), key);
+    size_t index = position - _keys.begin();
+    if(position == _keys.end() || *position != key)
+    {
+        _keys.insert(position, key);
+        _containers.insert(_containers.begin() + index, Container());
+    }
+    return _containers[index];
+}
+
+void RoaringBitmap::add(uint32_t value)
+{
+    container_for(uint16_t(value >> 16)).add(uint16_t(value));
+}
+
+void RoaringBitmap::add_range(uint32_t first, uint32_t last)
+{
+    if(first > last)
+        return;
+    for(uint32_t key = first >> 16; key <= last >> 16; ++key)
+    {
+        uint32_t low = key == first >> 16 ? first & 0xffff : 0;
+        uint32_t high = key == last >> 16 ? last & 0xffff : 0xffff;
+        Container run;
+        run.type = ContainerType::Run;
+        run.cardinality = high - low + 1;
+        run.values = {uint16_t(low), uint16_t(high - low)};
+        Container& c = container_for(uint16_t(key));
+        c = c.cardinality == 0 ? std::move(run) : combine(BitOp::Or, c, run);
+    }
+}
+
+bool RoaringBitmap::contains(uint32_t value) const
+{
+    size_t index = find(uint16_t(value >> 16));
+    return index != not_found && _containers[index].contains(uint16_t(value));
+}
+
+size_t RoaringBitmap::cardinality() const
+{
+    size_t total = 0;
+    for(const Container& c : _containers)
+        total += c.cardinality;
+    return total;
+}
+
+void RoaringBitmap::run_optimize()
+{
+    for(Container& c : _containers)
+    {
+        if(c.type == ContainerType::Run)
+            continue;
+        size_t runs = c.run_count();
+        if(sizeof(uint16_t) + 2 * runs * sizeof(uint16_t) >= c.size_in_bytes())
+            continue;
+        Container run;
+        run.type = ContainerType::Run;
+        run.cardinality = c.cardinality;
+        run.values.reserve(2 * runs);
+        c.for_each([&run](uint32_t v) {
+            size_t n = run.values.size();
+            if(n && uint32_t(run.values[n - 2]) + run.values[n - 1] + 1 == v)
+                ++run.values[n - 1];
+            else
+            {
+                run.values.push_back(uint16_t(v));
+                run.values.push_back(0);
+            }
+        });
+        c = std::move(run);
+    }
+}
+
+RoaringBitmap RoaringBitmap::combine(BitOp op, const RoaringBitmap& a, const RoaringBitmap& b)
+{
+    // Chunks present on one side only are copied or dropped, according to the operation
+    RoaringBitmap result;
+    size_t i = 0, j = 0;
+    while(i < a._keys.size() || j < b._keys.size())
+    {
+        if(j == b._keys.size() || (i < a._keys.size() && a._keys[i] < b._keys[j]))
+        {
+            if(op != BitOp::And)
+            {
+                result._keys.push_back(a._keys[i]);
+                result._containers.push_back(a._containers[i]);
+            }
+            ++i;
+        }
+        else if(i == a._keys.size() || b._keys[j] < a._keys[i])
+        {
+            if(op == BitOp::Or || op == BitOp::Xor)
+            {
+                result._keys.push_back(b._keys[j]);
+                result._containers.push_back(b._containers[j]);
+            }
+            ++j;
+        }
+        else
+        {
+            Container c = combine(op, a._containers[i], b._containers[j]);
+            if(c.cardinality)
+            {
+                result._keys.push_back(a._keys[i]);
+                result._containers.push_back(std::move(c));
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+vector<uint32_t> RoaringBitmap::to_vector() const
+{
+    vector<uint32_t> values;
+    values.reserve(cardinality());
+    for_each([&values](uint32_t v) { values.push_back(v); });
+    return values;
+}
+
+size_t RoaringBitmap::size_in_bytes() const
+{
+    size_t total = _keys.size() * sizeof(uint16_t);
+    for(const Container& c : _containers)
+        total += c.size_in_bytes();
+    return total;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap& other) const
+{
+    return _keys == other._keys && to_vector() == other.to_vector();
+}
+
+// Serialization, in the format specified by the Roaring libraries
+// (github.com/RoaringBitmap/RoaringFormatSpec): a header with the chunk
+// keys, cardinalities and container offsets, then the containers.
+// Without runs, a chunk of more than 4096 values is a bitmap, else an array.
+
+static const uint32_t cookie_no_runs = 12346;
+static const uint32_t cookie_runs = 12347;
+// With runs, the offsets are written only from this number of containers
+static const size_t no_offset_threshold = 4;
+
+static void put16(vector<uint8_t>& out, uint16_t v)
+{
+    out.push_back(uint8_t(v));
+    out.push_back(uint8_t(v >> 8));
+}
+
+static void put32(vector<uint8_t>& out, uint32_t v)
+{
+    put16(out, uint16_t(v));
+    put16(out, uint16_t(v >> 16));
+}
+
+static void put64(vector<uint8_t>& out, uint64_t v)
+{
+    put32(out, uint32_t(v));
+    put32(out, uint32_t(v >> 32));
+}
+
+static void put_words(vector<uint8_t>& out, const DynamicBitset& bitmap)
+{
+    for(size_t w = 0; w < chunk_bits / 64; ++w)
+        put64(out, bitmap.data()[w]);
+}
+
+vector<uint8_t> RoaringBitmap::serialize() const
+{
+    size_t n = _keys.size();
+    bool has_runs = false;
+    for(const Container& c : _containers)
+        has_runs = has_runs || c.type == ContainerType::Run;
+
+    vector<uint8_t> out;
+    if(has_runs)
+    {
+        put32(out, cookie_runs | uint32_t(n - 1) << 16);
+        vector<uint8_t> run_flags((n + 7) / 8);
+        for(size_t c = 0; c < n; ++c)
+            if(_containers[c].type == ContainerType::Run)
+                run_flags[c / 8] |= uint8_t(1 << (c % 8));
+        out.insert(out.end(), run_flags.begin(), run_flags.end());
+    }
+    else
+    {
+        put32(out, cookie_no_runs);
+        put32(out, uint32_t(n));
+    }
+    for(size_t c = 0; c < n; ++c)
+    {
+        put16(out, _keys[c]);
+        put16(out, uint16_t(_containers[c].cardinality - 1));
+    }
+    bool has_offsets = !has_runs || n >= no_offset_threshold;
+    size_t offsets_at = out.size();
+    if(has_offsets)
+        out.resize(out.size() + 4 * n);
+
+    for(size_t c = 0; c < n; ++c)
+    {
+        const Container& container = _containers[c];
+        if(has_offsets)
+        {
+            uint32_t offset = uint32_t(out.size());
+            for(size_t b = 0; b < 4; ++b)
+                out[offsets_at + 4 * c + b] = uint8_t(offset >> (8 * b));
+        }
+        if(container.type == ContainerType::Run)
+        {
+            put16(out, uint16_t(container.values.size() / 2));
+            for(uint16_t v : container.values)
+                put16(out, v);
+        }
+        else if(container.cardinality > max_array_size)
+        {
+            if(container.type == ContainerType::Bitmap)
+                put_words(out, container.bitmap);
+            else
+                put_words(out, to_bitmap(container).bitmap);
+        }
+        else
+            container.for_each([&out](uint32_t v) { put16(out, uint16_t(v)); });
+    }
+    return out;
+}
+
+// Little-endian reader, checking the bounds
+class ByteReader
+{
+public:
+    ByteReader(const uint8_t* bytes, size_t size) : _bytes(bytes), _size(size), _position(0) {}
+
+    uint64_t get(size_t width)
+    {
+        if(_size - _position < width)
+            throw invalid_argument("roaring bitmap: truncated data at byte " + to_string(_position));
+        uint64_t v = 0;
+        for(size_t b = 0; b < width; ++b)
+            v |= uint64_t(_bytes[_position + b]) << (8 * b);
+        _position += width;
+        return v;
+    }
+    uint16_t get16() { return uint16_t(get(2)); }
+    uint32_t get32() { return uint32_t(get(4)); }
+    uint64_t get64() { return get(8); }
+    const uint8_t* skip(size_t n)
+    {
+        const uint8_t* at = _bytes + _position;
+        if(_size - _position < n)
+            throw invalid_argument("roaring bitmap: truncated data at byte " + to_string(_position));
+        _position += n;
+        return at;
+    }
+    size_t position() const { return _position; }
+
+private:
+    const uint8_t* _bytes;
+    size_t _size;
+    size_t _position;
+};
+
+RoaringBitmap RoaringBitmap::deserialize(const uint8_t* bytes, size_t size)
+{
+    ByteReader in(bytes, size);
+    uint32_t cookie = in.get32();
+    size_t n;
+    const uint8_t* run_flags = nullptr;
+    if((cookie & 0xffff) == cookie_runs)
+    {
+        n = (cookie >> 16) + 1;
+        run_flags = in.skip((n + 7) / 8);
+    }
+    else if(cookie == cookie_no_runs)
+    {
+        n = in.get32();
+        if(n > 65536)
+            throw invalid_argument("roaring bitmap: " + to_string(n) + " containers");
+    }
+    else
+        throw invalid_argument("roaring bitmap: unknown cookie " + to_string(cookie));
+
+    RoaringBitmap result;
+    result._keys.resize(n);
+    result._containers.resize(n);
+    for(size_t c = 0; c < n; ++c)
+    {
+        result._keys[c] = in.get16();
+        result._containers[c].cardinality = uint32_t(in.get16()) + 1;
+        if(c > 0 && result._keys[c] <= result._keys[c - 1])
+            throw invalid_argument("roaring bitmap: keys out of order");
+    }
+    // The containers follow each other: the offsets are not needed
+    if(!run_flags || n >= no_offset_threshold)
+        in.skip(4 * n);
+
+    for(size_t c = 0; c < n; ++c)
+    {
+        Container& container = result._containers[c];
+        if(run_flags && (run_flags[c / 8] >> (c % 8)) & 1)
+        {
+            container.type = ContainerType::Run;
+            size_t runs = in.get16();
+            if(runs == 0)
+                throw invalid_argument("roaring bitmap: empty run container " + to_string(c));
+            container.values.resize(2 * runs);
+            uint32_t cardinality = 0;
+            for(size_t r = 0; r < runs; ++r)
+            {
+                uint32_t start = container.values[2 * r] = in.get16();
+                uint32_t last = start + (container.values[2 * r + 1] = in.get16());
+                // Within the chunk, in order and disjoint
+                if(last > 0xffff)
+                    throw invalid_argument("roaring bitmap: run past the chunk in container " + to_string(c));
+                if(r > 0 && start <= uint32_t(container.values[2 * r - 2]) + container.values[2 * r - 1])
+                    throw invalid_argument("roaring bitmap: runs out of order in container " + to_string(c));
+                cardinality += last - start + 1;
+            }
+            container.cardinality = cardinality;
+        }
+        else if(container.cardinality > max_array_size)
+        {
+            container.type = ContainerType::Bitmap;
+            container.bitmap = DynamicBitset(chunk_bits);
+            uint64_t* words = container.bitmap.data();
+            for(size_t w = 0; w < chunk_bits / 64; ++w)
+                words[w] = in.get64();
+            if(container.bitmap.count() != container.cardinality)
+                throw invalid_argument("roaring bitmap: wrong cardinality of bitmap " + to_string(c));
+        }
+        else
+        {
+            container.values.resize(container.cardinality);
+            for(size_t i = 0; i < container.values.size(); ++i)
+            {
+                container.values[i] = in.get16();
+                // Strictly increasing, for the binary searches
+                if(i > 0 && container.values[i] <= container.values[i - 1])
+                    throw invalid_argument("roaring bitmap: values out of order in container " + to_string(c));
+            }
+        }
+    }
+    return result;
+}
+
+// Memory of a std::set<int> of the same values: a red-black tree
+// node per value, with its color, 3 links and the value
+struct SetNode
+{
+    int color;
+    void* links[3];
+    int value;
+};
+
+static void print_set(const char* name, const RoaringBitmap& set)
+{
+    demo_out() << name << set.cardinality() << " values, " << set.size_in_bytes()
+               << " bytes (std::set<int>: " << set.cardinality() * sizeof(SetNode) << " bytes)" << endl;
+}
+
+void demo_roaring_bitmap()
+{
+    demo_out() << endl << "************** Roaring bitmap ************" << endl;
+
+    // The ID sets of demo_initialization, at a larger scale
+    RoaringBitmap small {3, 4, 5, 6, 7};
+    demo_out() << "Small set :";
+    small.for_each([](uint32_t v) { demo_out() << ' ' << v; });
+    demo_out() << endl;
+
+    // Sparse: every 1000th ID up to 10 million, in arrays
+    RoaringBitmap sparse;
+    for(uint32_t id = 0; id < 10000000; id += 1000)
+        sparse.add(id);
+    print_set("Sparse : ", sparse);
+
+    // Dense: 3 IDs out of 4 from 2 to 3 million, in bitmaps
+    RoaringBitmap dense;
+    for(uint32_t id = 2000000; id < 3000000; ++id)
+        if(id % 4)
+            dense.add(id);
+    print_set("Dense  : ", dense);
+
+    // Ranges: a million consecutive IDs, in runs
+    RoaringBitmap range;
+    range.add_range(2500000, 3499999);
+    print_set("Range  : ", range);
+
+    demo_out() << "Sparse and dense : " << (sparse & dense).cardinality() << endl;
+    demo_out() << "Sparse or dense  : " << (sparse | dense).cardinality() << endl;
+    demo_out() << "Dense and range  : " << (dense & range).cardinality() << endl;
+    demo_out() << "Range - dense    : " << (range - dense).cardinality() << endl;
+    demo_out() << "Is 2500001 in dense - sparse ? " << ((dense - sparse).contains(2500001) ? "true" : "false") << endl;
+
+    // run_optimize turns the chunks of the range into runs, and keeps the
+    // bitmaps of the dense set, whose runs are 3 values long
+    RoaringBitmap all = sparse | dense | range;
+    print_set("Union  : ", all);
+    all.run_optimize();
+    print_set("Optimized : ", all);
+
+    vector<uint8_t> bytes = all.serialize();
+    RoaringBitmap copy = RoaringBitmap::deserialize(bytes.data(), bytes.size());
+    demo_out() << "Serialized in " << bytes.size() << " bytes, read back "
+               << (copy == all ? "equal" : "different") << endl;
+    try
+    {
+        RoaringBitmap::deserialize(bytes.data(), 10);
+    }
+    catch(invalid_argument const& e)
+    {
+        demo_out() << "Error: " << e.what() << endl;
+    }
+}
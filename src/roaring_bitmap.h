@@ -0,0 +1,143 @@
+#ifndef _ROARING_BITMAP_H_
+#define _ROARING_BITMAP_H_
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint32_t, uint16_t, uint8_t
+#include <initializer_list>
+#include <vector>
+#include "dynamic_bitset.h"
+
+/// Roaring bitmap demo: ID sets compared to std::set<int>
+void demo_roaring_bitmap();
+
+/// Compressed set of 32-bit integers (Chambi, Lemire, Kaser, Godin,
+/// "Better bitmap performance with Roaring bitmaps"). The values are
+/// split by their 16 high bits in chunks of 2^16, each stored in the
+/// smallest of 3 containers: a sorted array of the 16 low bits for up to
+/// 4096 values, else a bitmap of 2^16 bits (8 KiB), or, after
+/// run_optimize(), a list of runs of consecutive values. Sparse sets
+/// take 2 bytes per value, dense ones 1 bit, ranges 4 bytes per run.
+/// The bitmap operations run with the SIMD kernels of DynamicBitset.
+class RoaringBitmap
+{
+public:
+    /// Largest cardinality of an array container
+    static const size_t max_array_size = 4096;
+
+    RoaringBitmap() {}
+    RoaringBitmap(std::initializer_list<uint32_t> values);
+
+    void add(uint32_t value);
+    /// Adds the values in [first, last]
+    void add_range(uint32_t first, uint32_t last);
+    bool contains(uint32_t value) const;
+
+    size_t cardinality() const;
+    bool empty() const { return _keys.empty(); }
+
+    /// Converts the containers to runs where they are smaller so
+    /// (after add_range, or for clustered values)
+    void run_optimize();
+
+    /// Set algebra: And is the intersection, Or the union,
+    /// Xor the symmetric difference and AndNot the difference
+    static RoaringBitmap combine(BitOp op, const RoaringBitmap& a, const RoaringBitmap& b);
+
+    /// Calls f(value) for each value, in increasing order
+    template<typename F>
+    void for_each(F f) const
+    {
+        for(size_t c = 0; c < _containers.size(); ++c)
+        {
+            uint32_t high = uint32_t(_keys[c]) << 16;
+            _containers[c].for_each([&](uint32_t low) { f(high | low); });
+        }
+    }
+
+    std::vector<uint32_t> to_vector() const;
+
+    /// Memory used by the containers, in bytes
+    size_t size_in_bytes() const;
+
+    /// Portable serialized form: the format of the Roaring libraries,
+    /// little-endian whatever the host
+    std::vector<uint8_t> serialize() const;
+    /// Throws std::invalid_argument if the bytes are not a serialized bitmap
+    static RoaringBitmap deserialize(const uint8_t* bytes, size_t size);
+
+    /// Same values, whatever the containers
+    bool operator==(const RoaringBitmap& other) const;
+    bool operator!=(const RoaringBitmap& other) const { return !(*this == other); }
+
+private:
+    enum class ContainerType : uint8_t { Array, Bitmap, Run };
+
+    struct Container
+    {
+        ContainerType type = ContainerType::Array;
+        uint32_t cardinality = 0;
+        /// Array: the sorted values. Run: start, length - 1 of each run.
+        std::vector<uint16_t> values;
+        /// Bitmap: 2^16 bits
+        DynamicBitset bitmap;
+
+        bool contains(uint16_t value) const;
+        void add(uint16_t value);
+        size_t size_in_bytes() const;
+        size_t run_count() const;
+
+        template<typename F>
+        void for_each(F f) const
+        {
+            switch(type)
+            {
+            case ContainerType::Array:
+                for(uint16_t v : values)
+                    f(v);
+                break;
+            case ContainerType::Bitmap:
+                bitmap.for_each_set([&](size_t v) { f(uint32_t(v)); });
+                break;
+            case ContainerType::Run:
+                for(size_t r = 0; r < values.size(); r += 2)
+                    for(uint32_t v = values[r]; v <= uint32_t(values[r]) + values[r + 1]; ++v)
+                        f(v);
+                break;
+            }
+        }
+    };
+
+    static Container to_bitmap(const Container& c);
+    static Container to_array(const Container& c);
+    static Container expand_runs(const Container& c);
+    static Container combine(BitOp op, const Container& a, const Container& b);
+    static Container normalized(Container c);
+
+    size_t find(uint16_t key) const;
+    Container& container_for(uint16_t key);
+
+    std::vector<uint16_t> _keys;        ///< sorted high bits of the chunks
+    std::vector<Container> _containers; ///< none empty
+};
+
+inline RoaringBitmap operator&(const RoaringBitmap& a, const RoaringBitmap& b)
+{
+    return RoaringBitmap::combine(BitOp::And, a, b);
+}
+
+inline RoaringBitmap operator|(const RoaringBitmap& a, const RoaringBitmap& b)
+{
+    return RoaringBitmap::combine(BitOp::Or, a, b);
+}
+
+inline RoaringBitmap operator^(const RoaringBitmap& a, const RoaringBitmap& b)
+{
+    return RoaringBitmap::combine(BitOp::Xor, a, b);
+}
+
+inline RoaringBitmap operator-(const RoaringBitmap& a, const RoaringBitmap& b)
+{
+    return RoaringBitmap::combine(BitOp::AndNot, a, b);
+}
+
+#endif /* _ROARING_BITMAP_H_ */
@@ -4,6 +4,9 @@ rvalue-references-and-move-semantics-in-c++11.html'
 
 #include <iostream>
 #include "rvalues.h"
+#include "cpu_features.h"
+#include "demo_output.h"
+#include "latency.h"
 
 using namespace std;
 
@@ -14,86 +17,69 @@ int fn()
 
 void check(const int& ref)
 {
-    cout << "L-value version " << ref << endl;
+    demo_out() << "L-value version " << ref << endl;
 }
 
 void check(int&& ref)
 {
-    cout << "R-value version " << ref << endl;
+    demo_out() << "R-value version " << ref << endl;
 }
 
-class ArrayWrapper
+// Copy of an array of integers, one variant per instruction set
+
+static void copy_ints_scalar(int* destination, const int* source, size_t count)
 {
-public:
-    // Constructor from size with default value
-    explicit ArrayWrapper (size_t n)
-        : _p_vals( new int[ n ] )
-        , _size( n )
-    {}
-    // Destructor
-    ~ArrayWrapper() 
-    {
-        delete [] _p_vals;
-    }
-    // Copy constructor - copies from another object of the same type
-    ArrayWrapper(ArrayWrapper const& other)
-    :_p_vals(new int [other._size])
-    ,_size(other._size)
-    {
-        // Must allocate a new array and perform a deep copy
-        for ( size_t i = 0; i < _size; ++i )
-            _p_vals[ i ] = other._p_vals[ i ];
-        cout << "Performed a deep copy" << endl;
-    }
-    // Move constructor - plunders from a temporary object of the same type
-    ArrayWrapper(ArrayWrapper && temp_other)
-    :_p_vals(temp_other._p_vals)
-    ,_size(temp_other._size)
+    for(size_t i = 0; i < count; ++i)
+        destination[i] = source[i];
+}
+
+#ifdef HAS_X86_KERNELS
+__attribute__((target("avx2")))
+static void copy_ints_avx2(int* destination, const int* source, size_t count)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+    // The remainder with a masked load and store
+    if(i < count)
     {
-        // Since temp_other is a temporary, the program will no longer
-        // refer to it : it is ok to "steal" its internal array,
-        // no need to allocate a new array and perform a deep copy.
-
-        // However, since the descructor will be called on the temporary,
-        // we must reassign its _p_vals to avoid deleting the stolen array.
-        temp_other._p_vals = nullptr;
-        // Reassigning _size is not strictly necessary
-        temp_other._size = 0;
-
-        // Note that both _p_vals and _size are built-in data types.
-        // If the class had a field that is an object, - for instance
-        // Metadata _metadata, or std::string _name - then that field 
-        // must be transfered using with std::move (which invokes 
-        // its move constructor), like so: _metadata(std::move(other._metadata))
-        // The reason for this is that temp_other - and hence also
-        // temp_other._metadata - is an l-value for the duration of this 
-        // constructor, so we need to convert it to an r-value using std::move.
-
-        cout << "Performed a 'move' copy" << endl;
+        __m256i remaining = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(count - i)),
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        _mm256_maskstore_epi32(destination + i, remaining, _mm256_maskload_epi32(source + i, remaining));
     }
-    // Const accessor
-    int const& at(size_t i) const { return _p_vals[i]; }
-    // Mutable accessor
-    int& at(size_t i) 
-    { 
-        auto const_this = const_cast<ArrayWrapper const*>(this);
-        return const_cast<int&>(const_this->_p_vals[i]); 
-    }
-    // print method
-    void print() const
+}
+
+__attribute__((target("avx512f")))
+static void copy_ints_avx512(int* destination, const int* source, size_t count)
+{
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+        _mm512_storeu_si512(destination + i, _mm512_loadu_si512(source + i));
+    if(i < count)
     {
-        for ( size_t i = 0; i < _size; ++i )
-            cout << _p_vals[ i ] << " ";
-        cout << endl;
+        __mmask16 remaining = __mmask16((1u << (count - i)) - 1);
+        _mm512_mask_storeu_epi32(destination + i, remaining,
+            _mm512_maskz_loadu_epi32(remaining, source + i));
     }
+}
+#endif
+
+// Nothing to gain from SSE4.2: the baseline SSE2 already has 128-bit moves
+static const Kernel<void (*)(int*, const int*, size_t)> copy_ints_kernel("rvalues.copy_ints",
+    copy_ints_scalar, nullptr, X86_KERNEL(copy_ints_avx2), X86_KERNEL(copy_ints_avx512));
 
-private:
-    int* _p_vals;
-    size_t _size;
-};
+void copy_ints(int* destination, const int* source, size_t count)
+{
+    copy_ints_kernel(destination, source, count);
+}
 
 ArrayWrapper makeArray(size_t n, int value)
 {
+    LATENCY_PROBE("rvalues.makeArray");
+    LIFECYCLE_SITE("rvalues.makeArray");
+    // The local object is returned in place, or at worst moved
+    EXPECT_NO_COPIES();
     ArrayWrapper array(n);
     for(size_t i=0; i<n; ++i)
         array.at(i) = value;
@@ -102,7 +88,7 @@ ArrayWrapper makeArray(size_t n, int value)
 
 void printAddress (const int& v) // const ref to allow binding to rvalues
 {
-    cout << reinterpret_cast<const void*>( & v ) << endl;
+    demo_out() << reinterpret_cast<const void*>( & v ) << endl;
 }
 
 int x;
@@ -121,7 +107,7 @@ int && getRvalueInt ()
 
 void demo_rvalues()
 {
-    cout << endl << "*************** R-values *****************" << endl;
+    demo_out() << endl << "*************** R-values *****************" << endl;
 
     // Rule: whatever we can get an address of is an l-value
     // Otherwise it is an r-value
@@ -130,13 +116,13 @@ void demo_rvalues()
     int* k = new int(10);
     // Ok: variables are l-values
     int* ptr1 = &i;
-    cout << *ptr1 << endl;
+    demo_out() << *ptr1 << endl;
     // Ok: named constants are l-values
     const int* ptr2 = &j;
-    cout << *ptr2 << endl;
+    demo_out() << *ptr2 << endl;
     // Ok: pointers (variables holding an address) are l-values
     int** ptr3 = &k;
-    cout << *ptr3 << endl;
+    demo_out() << *ptr3 << endl;
 
     // KO: literal constants are r-values
     // compiler says: "error: lvalue required as unary ‘&’ operand"
@@ -147,7 +133,7 @@ void demo_rvalues()
 
     // Ok: The l-value is the variable after incrementation
     int* ptr6 = &++i;
-    cout << "Prefix incrementation returns l-value : " << *ptr6 << endl;
+    demo_out() << "Prefix incrementation returns l-value : " << *ptr6 << endl;
 
     // KO: The temporary value before incrementation is an r-value
     // int* ptr7 = &i++;
@@ -158,12 +144,12 @@ void demo_rvalues()
     // Ok: references are l-values
     int& refK = *k;
     int* ptr9 = &refK;
-    cout << "A reference is an l-value : " << *ptr9 << endl;
+    demo_out() << "A reference is an l-value : " << *ptr9 << endl;
 
     // Rule: references (called l-value references in modern C++)
     // can only be bound to l-values
     int& refI = i;
-    cout << "Reference bound to an l-value : " << refI << endl;
+    demo_out() << "Reference bound to an l-value : " << refI << endl;
 
     // KO: return of fn is an r-value
     // compiler says; "error: invalid initialization of non-const
@@ -174,52 +160,52 @@ void demo_rvalues()
     // The life of the r-value is then extended 
     // for as long as the reference exists
     const int& refRet = fn();
-    cout << "Reference to const bound to an r-value : " << refRet << endl;
+    demo_out() << "Reference to const bound to an r-value : " << refRet << endl;
     // Note: references to non-const can only be bound to mutable l-values.
     // References to const can be bound to l-values as well as r-values.
 
     // Rule: r-value references can be bound only to r-values, i.e. temporaries
     int &&rvrefN = 7;
-    cout << "R-value reference to literal constant : " << rvrefN << endl;
+    demo_out() << "R-value reference to literal constant : " << rvrefN << endl;
 
     // KO: i is an l-value
     // compiler says "error: cannot bind ‘int’ lvalue to ‘int&&’"
     // int &&rvrefI = i;
 
     int &&rvrefRet = fn();
-    cout << "R-value reference to return value: " << rvrefRet << endl;
+    demo_out() << "R-value reference to return value: " << rvrefRet << endl;
 
     // Using the overloaded function check(), one can determine if
     // a reference variablerefers to a terporary object (r-value) or to a 
     // permanent object (constant or mutable l-value)
-    cout << "Literal constant               : ";
+    demo_out() << "Literal constant               : ";
     check(6);
-    cout << "Function return value          : ";
+    demo_out() << "Function return value          : ";
     check(fn());
-    cout << "Postfix increment return value : ";
+    demo_out() << "Postfix increment return value : ";
     check(i++);
-    cout << "Prefix increment return value  : ";
+    demo_out() << "Prefix increment return value  : ";
     check(++i);
-    cout << "Variable                       : ";
+    demo_out() << "Variable                       : ";
     check(j);
-    cout << "Reference                      : ";
+    demo_out() << "Reference                      : ";
     check(refK);
 
     // Application : move constructor and move assignment operator
     ArrayWrapper a1(4);
     for(size_t i=0; i < 4; ++i)
         a1.at(i) = i;
-    cout <<"array a1 :" << endl;
+    demo_out() <<"array a1 :" << endl;
     a1.print();
     
     // Classic C++03 syntax, causes call to copy constructor
     ArrayWrapper a2 = a1;
-    cout <<"array a2 (copied from a1) :" << endl;
+    demo_out() <<"array a2 (copied from a1) :" << endl;
     a2.print();
     
     // We transform a1 to an r-value, thus forcing call to move constructor
     ArrayWrapper a3  = std::move(a1);
-    cout << "array a3 (moved from a1) :" << endl;
+    demo_out() << "array a3 (moved from a1) :" << endl;
     a3.print();
     // Since we have plundered object a1, the following causes a segfault:
     // a1.print();
@@ -227,7 +213,7 @@ void demo_rvalues()
     // Temporary object returned from a factory function :
     // here the compiler optimizes to avoid copy and move constructors
     ArrayWrapper a4  = makeArray(4, 7);
-    cout <<"array a4 (gotten from factory function) :" << endl;
+    demo_out() <<"array a4 (gotten from factory function) :" << endl;
     a4.print();
     // Note: the reason is the returned object is local to the factory function
 
@@ -1,9 +1,98 @@
 #ifndef _RVALUES_H_
 #define _RVALUES_H_
 
+#include <cstddef> // for size_t
+#include <ostream> // for endl
+#include <utility> // for std::move
+#include "demo_output.h"
+#include "lifecycle_probe.h"
+#include "stats_counters.h"
+#include "trace.h"
+
 /// R-values vs L-values and R-value references in modern C++
 /// &&, std::move
 void demo_rvalues();
 
+// Copies count integers, with the fastest instructions of the host
+void copy_ints(int* destination, const int* source, size_t count);
+
+// Owner of a heap-allocated array of integers, with a copy constructor
+// that performs a deep copy and a move constructor that steals the array
+class ArrayWrapper : public LifecycleProbe<ArrayWrapper>
+{
+public:
+    // Constructor from size with default value
+    explicit ArrayWrapper (size_t n)
+        : _p_vals( new int[ n ] )
+        , _size( n )
+    {}
+    // Destructor
+    ~ArrayWrapper() 
+    {
+        delete [] _p_vals;
+    }
+    // Copy constructor - copies from another object of the same type
+    ArrayWrapper(ArrayWrapper const& other)
+    :LifecycleProbe(other)
+    ,_p_vals(new int [other._size])
+    ,_size(other._size)
+    {
+        TRACE_SPAN("rvalues.ArrayWrapper_copy");
+        STAT_ADD("rvalues.deep_copy_bytes", _size * sizeof(int));
+        // Must allocate a new array and perform a deep copy
+        copy_ints(_p_vals, other._p_vals, _size);
+        demo_out() << "Performed a deep copy" << std::endl;
+    }
+    // Move constructor - plunders from a temporary object of the same type
+    ArrayWrapper(ArrayWrapper && temp_other)
+    :LifecycleProbe(std::move(temp_other))
+    ,_p_vals(temp_other._p_vals)
+    ,_size(temp_other._size)
+    {
+        // Since temp_other is a temporary, the program will no longer
+        // refer to it : it is ok to "steal" its internal array,
+        // no need to allocate a new array and perform a deep copy.
+
+        // However, since the descructor will be called on the temporary,
+        // we must reassign its _p_vals to avoid deleting the stolen array.
+        temp_other._p_vals = nullptr;
+        // Reassigning _size is not strictly necessary
+        temp_other._size = 0;
+
+        // Note that both _p_vals and _size are built-in data types.
+        // If the class had a field that is an object, - for instance
+        // Metadata _metadata, or std::string _name - then that field 
+        // must be transfered using with std::move (which invokes 
+        // its move constructor), like so: _metadata(std::move(other._metadata))
+        // The reason for this is that temp_other - and hence also
+        // temp_other._metadata - is an l-value for the duration of this 
+        // constructor, so we need to convert it to an r-value using std::move.
+
+        demo_out() << "Performed a 'move' copy" << std::endl;
+    }
+    // Const accessor
+    int const& at(size_t i) const { return _p_vals[i]; }
+    // Mutable accessor
+    int& at(size_t i) 
+    { 
+        auto const_this = const_cast<ArrayWrapper const*>(this);
+        return const_cast<int&>(const_this->_p_vals[i]); 
+    }
+    // print method
+    void print() const
+    {
+        for ( size_t i = 0; i < _size; ++i )
+            demo_out() << _p_vals[ i ] << " ";
+        demo_out() << std::endl;
+    }
+
+private:
+    int* _p_vals;
+    size_t _size;
+};
+
+// Factory function returning an ArrayWrapper of n times the given value
+ArrayWrapper makeArray(size_t n, int value);
+
 
 #endif /* _RVALUES_H_ */
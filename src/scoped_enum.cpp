@@ -1,7 +1,9 @@
-#include <iostream> // for std::cout
+#include <iostream> // for std::endl
 #include <type_traits> // for std::underlying_type
 #include <unordered_map>
 #include "scoped_enum.h"
+#include "demo_output.h"
+#include "latency.h"
 
 using namespace std;
 
@@ -30,6 +32,7 @@ enum class EButtonState : bool;
 // Solution1: Define operator<< for each constant
 ostream& operator<<(ostream& out, EMonth m)
 {
+    LATENCY_PROBE("scoped_enum.EMonth_operator<<");
     // create a static container with all the values an their print
     static unordered_map<EMonth, const char*> values = {
         {EMonth::Jan, "January"},
@@ -64,22 +67,22 @@ void iterate_over_enum()
     enum Note {Start, do_ = Start, re, mi, fa, sol, la, si, End};
     for(int n = Start; n < Note::End; ++n)
     {
-        cout << "note " << Note(n) << endl;
+        demo_out() << "note " << Note(n) << endl;
     }
 
     // Iteration over a sequence of values. Need not be consecutive.
     // However requires to maintain a duplicate of the enum list
-    constexpr initializer_list<Note> all_Notes =
+    static constexpr initializer_list<Note> all_Notes =
         { do_, re, mi, fa, sol, la, si};
     for (auto n : all_Notes)
     {
-        cout << "note " << n << endl;
+        demo_out() << "note " << n << endl;
     }
 }
 
 void demo_scoped_enum()
 {
-    cout << endl << "*************** Scoped Enum ***********" << endl;
+    demo_out() << endl << "*************** Scoped Enum ***********" << endl;
 
     // C++03 : Two constants coming from different enums
     // can be compared, substracted, assigned to int variables etc.
@@ -89,9 +92,9 @@ void demo_scoped_enum()
 
     // Compiler warning for the comparison, but no compile time error
     if (d == m)
-        cout << "Monday == January\n"; // This will be printed out
+        demo_out() << "Monday == January\n"; // This will be printed out
     else
-        cout << "Monday != January\n";
+        demo_out() << "Monday != January\n";
 
     // Compiler error: invalid conversion from int to Day => OK
     // d = 5;
@@ -101,14 +104,14 @@ void demo_scoped_enum()
 
     // No compiler warning: convertible to int => KO
     int day_nb = Monday + 3;
-    cout << "Monday + 3 = " << day_nb << endl;
+    demo_out() << "Monday + 3 = " << day_nb << endl;
 
     // Convertible to int : uses operator<< for int
-    cout << "Monday = " << Monday << endl;
+    demo_out() << "Monday = " << Monday << endl;
 
     // Size of enum is 4 bytes, because underlying type is int;
     // But actually it is even worse: it depends on the compiler
-    cout << "Size of Day enum: " << sizeof(Day) << endl;
+    demo_out() << "Size of Day enum: " << sizeof(Day) << endl;
 
 
     // C++11
@@ -125,9 +128,9 @@ void demo_scoped_enum()
     // No "==" operator is defined for the object type
     // So, in C++ 11, this is an compile time error => OK
     // if (day == month)
-    //     cout << "Tuesday == February\n";
+    //     demo_out() << "Tuesday == February\n";
     // else
-    //     cout << "Tuesday != February\n";
+    //     demo_out() << "Tuesday != February\n";
 
     // For unscoped enums, you can write the scope (compatible
     // with scoped enum) but also omit it (backward compatible)
@@ -141,23 +144,23 @@ void demo_scoped_enum()
     day_nb = static_cast<int>(EDay::Monday) + 3;
 
     // Size of enum is 1 byte : the size of the underlying type
-    cout << "Size of Month unscoped enum: " << sizeof(Month) << endl;
-    cout << "Size of EButtonState scoped enum: " << sizeof(EButtonState) << endl;
+    demo_out() << "Size of Month unscoped enum: " << sizeof(Month) << endl;
+    demo_out() << "Size of EButtonState scoped enum: " << sizeof(EButtonState) << endl;
 
     // No operator <<; compile error => OK
-    // cout << "Day is: " << day << endl;
+    // demo_out() << "Day is: " << day << endl;
 
     // Operator << defined => compiles and runs OK
-    cout << "Month 1 is: " << month << endl;
-    cout << "Month 13 is: " << bad_month << endl;
-    cout << "Month 67000 is converted to "
+    demo_out() << "Month 1 is: " << month << endl;
+    demo_out() << "Month 13 is: " << bad_month << endl;
+    demo_out() << "Month 67000 is converted to "
          << static_cast<int>(narrowing) << endl;
 
     // Operator << defined => compiles and runs OK
-    cout << "Button state is: " << EButtonState::On << endl;
+    demo_out() << "Button state is: " << EButtonState::On << endl;
 
     // Iterate over all defined values of an enum
     iterate_over_enum();
 
-    cout << "End of Scoped Enum demo" << endl;
+    demo_out() << "End of Scoped Enum demo" << endl;
 }
@@ -1,44 +1,58 @@
 #include <memory> // for unique_ptr
-#include <iostream> // for cout
+#include <iostream> // for endl
 #include <typeinfo> // for typeid
 #include <cxxabi.h> // for __cxa_demangle
 #include <string> // for string, to_string
+#include <cstdlib> // for free
+#include "smart_pointers.h"
+#include "demo_output.h"
+#include "lifecycle_probe.h"
+#include "stats_counters.h"
 
 using namespace std;
 
-class MyClass
+class MyClass : public LifecycleProbe<MyClass>
 {
 public:
     explicit MyClass(const std::string& name = "default")
     :_name(name)
     {
-        static unsigned int counter = 0;
-        _name += to_string(counter++);
-        cout << "Created " << _get_classname() << " object " << _name << endl;
+        // Numbered per shard of the counter, i.e. per thread up to
+        // StatCounter::max_shards threads, so that demos running at the same
+        // time neither race on the counter nor change each other's output;
+        // past them, threads sharing a shard share one sequence
+        static StatCounter& counter = stat_counter("smart_pointers.MyClass_created");
+        _name += to_string(counter.next());
+        demo_out() << "Created " << _get_classname() << " object " << _name << endl;
     }
 
     void greet()
     {
-        cout << "Hello from object " << _name << endl;
+        demo_out() << "Hello from object " << _name << endl;
     }
 
     ~MyClass()
     {
-        cout << "Destroyed " << _get_classname() << " object " << _name << endl;
+        demo_out() << "Destroyed " << _get_classname() << " object " << _name << endl;
     }
 private:
     string _name;
-    const char* _get_classname() const
+    string _get_classname() const
     {
         int status;
-        return abi::__cxa_demangle(typeid(*this).name(), 0, 0, &status);
+        // __cxa_demangle returns a buffer allocated with malloc, which
+        // the caller must free: copy it into a string before releasing it
+        char* demangled = abi::__cxa_demangle(typeid(*this).name(), 0, 0, &status);
+        string classname(demangled ? demangled : typeid(*this).name());
+        free(demangled);
+        return classname;
     }
 };
 
 
 void demo_smart_pointers()
 {
-    cout << endl << "*************** Smart Pointers ***********" << endl;
+    demo_out() << endl << "*************** Smart Pointers ***********" << endl;
 
     // Using unique_ptr with a single instance
     unique_ptr<MyClass> pObj(new MyClass("single"));
@@ -51,7 +65,7 @@ void demo_smart_pointers()
     shared_ptr<MyClass> pSharedObj1, pSharedObj2;
 
     { // Different scope, for instance a function called from this scope
-        cout << "Scope A started" << endl;
+        demo_out() << "Scope A started" << endl;
         shared_ptr<MyClass> pSharedObj3 = make_shared<MyClass>("shared");
         pSharedObj3->greet();
 
@@ -59,27 +73,27 @@ void demo_smart_pointers()
         pSharedObj1 = pSharedObj2 = pSharedObj3;
 
         // Display reference count to the object
-        cout << "Object has " << pSharedObj3.use_count() << " references" << endl;
+        demo_out() << "Object has " << pSharedObj3.use_count() << " references" << endl;
 
         // Therefore object will not be destroyed when pSharedObj3 goes out of scope
-        cout << "Scope A ended" << endl;
+        demo_out() << "Scope A ended" << endl;
     }
     pSharedObj1->greet();
     // Display reference count to the object
-    cout << "Object has " << pSharedObj1.use_count() << " references" << endl;
+    demo_out() << "Object has " << pSharedObj1.use_count() << " references" << endl;
     // Explicitely destroy one reference
     pSharedObj2.reset();
-    cout << "Object has " << pSharedObj1.use_count() << " references" << endl;
+    demo_out() << "Object has " << pSharedObj1.use_count() << " references" << endl;
 
     // Releasing from a unique_ptr
     MyClass* pUnmanagedObj(nullptr);
     { // Different scope, like a factory method
-        cout << "Scope B started" << endl;
+        demo_out() << "Scope B started" << endl;
         unique_ptr<MyClass> pUniqueObj1(new MyClass("scoped"));
         unique_ptr<MyClass> pUniqueObj2(new MyClass("released"));
         // Release object so that it will not be deleted at end of scope
         pUnmanagedObj = pUniqueObj2.release();
-        cout << "Scope B ended" << endl;
+        demo_out() << "Scope B ended" << endl;
     }
     pUnmanagedObj->greet();
     delete pUnmanagedObj;
@@ -96,5 +110,5 @@ void demo_smart_pointers()
     });
     pMallocedObj->greet();
 
-    cout << "End of Smart Pointers demo" << endl;
+    demo_out() << "End of Smart Pointers demo" << endl;
 }
@@ -0,0 +1,77 @@
+#include "stats_counters.h"
+#include <algorithm> // for sort
+#include <cstring> // for strcmp
+#include <mutex>
+#include <stdexcept> // for length_error
+
+using namespace std;
+
+// Counters live in static storage, which honours their cache-line alignment,
+// and are never destroyed: references to them stay valid
+static const size_t max_counters = 128;
+static StatCounter counters[max_counters];
+static atomic<size_t> registered_counters(0);
+static mutex registry_mutex;
+
+// Threads take the shards in turn, at their first count
+static atomic<size_t> next_shard(0);
+
+size_t StatCounter::shard_index()
+{
+    // Constant-initialized: no guard on each access
+    static thread_local size_t index = max_shards;
+    if(index == max_shards)
+        index = next_shard.fetch_add(1) % max_shards;
+    return index;
+}
+
+uint64_t StatCounter::total() const
+{
+    uint64_t sum = 0;
+    for(const Shard& s : _shards)
+        sum += s.value.load(memory_order_relaxed);
+    return sum;
+}
+
+StatCounter& stat_counter(const char* name)
+{
+    lock_guard<mutex> lock(registry_mutex);
+    size_t count = registered_counters.load(memory_order_relaxed);
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(strcmp(counters[i].name(), name) == 0)
+            return counters[i];
+    }
+    if(count == max_counters)
+        throw length_error(string("too many statistics counters for ") + name);
+    counters[count]._name.store(name, memory_order_release);
+    registered_counters.store(count + 1, memory_order_release);
+    return counters[count];
+}
+
+static vector<StatValue> snapshot(bool local)
+{
+    vector<StatValue> values;
+    size_t count = registered_counters.load(memory_order_acquire);
+    for(size_t i = 0; i < count; ++i)
+    {
+        StatValue v;
+        v.name = counters[i].name();
+        v.value = local ? counters[i].local() : counters[i].total();
+        values.push_back(v);
+    }
+    sort(values.begin(), values.end(), [](const StatValue& a, const StatValue& b) {
+        return a.name < b.name;
+    });
+    return values;
+}
+
+vector<StatValue> stat_counters_total()
+{
+    return snapshot(false);
+}
+
+vector<StatValue> stat_counters_local()
+{
+    return snapshot(true);
+}
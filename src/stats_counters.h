@@ -0,0 +1,71 @@
+#ifndef _STATS_COUNTERS_H_
+#define _STATS_COUNTERS_H_
+
+#include <atomic>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <string>
+#include <vector>
+
+/// Named event counter, split in one shard per thread so that threads
+/// counting the same event do not share a cache line. Increments are
+/// relaxed atomic additions on the shard of the calling thread; reading
+/// the total sums the shards, which makes it a snapshot, not a barrier.
+/// Beyond max_shards threads, shards are shared (the counts stay exact).
+class StatCounter
+{
+public:
+    static const size_t max_shards = 64;
+
+    void add(uint64_t n = 1) { shard().fetch_add(n, std::memory_order_relaxed); }
+    /// Increments the counter and returns the previous count of the shard of
+    /// the calling thread, e.g. to number objects: 0, 1, 2... on each thread
+    /// while there are at most max_shards; past them, the threads sharing a
+    /// shard draw from one sequence, each number still going to one call
+    uint64_t next() { return shard().fetch_add(1, std::memory_order_relaxed); }
+    /// Count of the shard of the calling thread: its own while there are at
+    /// most max_shards threads
+    uint64_t local() { return shard().load(std::memory_order_relaxed); }
+    /// Count over all the threads
+    uint64_t total() const;
+    const char* name() const { return _name.load(std::memory_order_acquire); }
+
+private:
+    friend StatCounter& stat_counter(const char* name);
+
+    static size_t shard_index();
+    std::atomic<uint64_t>& shard() { return _shards[shard_index()].value; }
+
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value;
+    };
+    Shard _shards[max_shards];
+    std::atomic<const char*> _name;
+};
+
+/// Counter of the given name, created at the first call. The name must
+/// outlive the program, e.g. a literal. The lookup takes a lock:
+/// keep the reference, e.g. in a static (see STAT_ADD).
+/// Throws std::length_error when the registry is full.
+StatCounter& stat_counter(const char* name);
+
+/// Value of one counter
+struct StatValue
+{
+    std::string name;
+    uint64_t value = 0;
+};
+
+/// Totals of all the counters, sorted by name
+std::vector<StatValue> stat_counters_total();
+/// Counts of the calling thread, sorted by name
+std::vector<StatValue> stat_counters_local();
+
+/// Adds n to the named counter
+#define STAT_ADD(name, n) do { \
+    static StatCounter& stat_counter_ = stat_counter(name); \
+    stat_counter_.add(n); \
+} while(0)
+
+#endif /* _STATS_COUNTERS_H_ */
@@ -0,0 +1,52 @@
+#include "symbols.h"
+#include <cstdio> // for snprintf
+#include <cstdlib> // for free
+#include <cstring> // for strrchr
+#include <cxxabi.h> // for __cxa_demangle
+#include <dlfcn.h> // for dladdr
+
+using namespace std;
+
+string symbol_name(void* address)
+{
+    Dl_info info;
+    if(!dladdr(address, &info))
+        return "?";
+    if(!info.dli_sname)
+    {
+        const char* module = info.dli_fname ? strrchr(info.dli_fname, '/') : nullptr;
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "%s+%#lx", module ? module + 1 : "?",
+            (unsigned long)(reinterpret_cast<char*>(address) - static_cast<char*>(info.dli_fbase)));
+        return buffer;
+    }
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    string name = status == 0 ? demangled : info.dli_sname;
+    free(demangled);
+    if(name.compare(0, 8, "operator") == 0)
+        return name.substr(0, name.find('('));
+    // Keep what is between the last space and the first parenthesis
+    // outside template arguments, e.g. "void f<int>(int)" gives "f<int>"
+    size_t begin = 0;
+    int depth = 0;
+    for(size_t i = 0; i < name.size(); ++i)
+    {
+        if(name[i] == '<')
+            ++depth;
+        else if(name[i] == '>')
+            --depth;
+        else if(name[i] == ' ' && depth == 0)
+            begin = i + 1;
+        else if(name[i] == '(' && depth == 0 && i > begin)
+            return name.substr(begin, i - begin);
+    }
+    return name.substr(begin);
+}
+
+bool is_library_symbol(const string& name)
+{
+    return name.compare(0, 5, "std::") == 0
+        || name.compare(0, 11, "__gnu_cxx::") == 0
+        || name.compare(0, 12, "operator new") == 0;
+}
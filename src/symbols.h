@@ -0,0 +1,18 @@
+#ifndef _SYMBOLS_H_
+#define _SYMBOLS_H_
+
+#include <string>
+
+// Names of the code addresses found in call stacks (backtrace).
+// Only the symbols exported by the modules are known: the program is
+// linked with -rdynamic, but static functions still show as module+offset.
+
+/// Demangled name of the function containing the address, without its
+/// return type and parameter list, e.g. "count_in_list<unsigned int>";
+/// its module and offset if it has no symbol, e.g. "DemoCpp11+0x1f2a"
+std::string symbol_name(void* address);
+
+/// True for the functions of the standard library and for operator new
+bool is_library_symbol(const std::string& name);
+
+#endif /* _SYMBOLS_H_ */
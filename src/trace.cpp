@@ -0,0 +1,135 @@
+#include "trace.h"
+#include <algorithm> // for min
+#include <cstdlib> // for malloc
+#include <iomanip> // for setprecision
+#include <new> // for placement new
+
+using namespace std;
+
+atomic<bool> tracing_on(false);
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Spans of one thread. Only the owner appends; it publishes each event
+// by incrementing count, which write_trace reads.
+static const size_t events_per_thread = 1 << 16;
+
+struct ThreadTrace
+{
+    atomic<size_t> count;
+    atomic<uint64_t> dropped;
+    TraceEvent events[events_per_thread];
+};
+
+// Buffers of the threads, in the order they recorded their first span.
+// They are allocated with malloc, not operator new, so that they do not
+// show in the allocations of the demos (see alloc_tracker.h); they are
+// never freed since write_trace may read them after the thread ended.
+static const size_t max_threads = 256;
+static atomic<ThreadTrace*> thread_traces[max_threads];
+static atomic<size_t> registered_threads(0);
+static atomic<uint64_t> untraced_spans(0); // from threads beyond max_threads
+
+static thread_local ThreadTrace* this_thread_trace = nullptr;
+static thread_local bool this_thread_untraced = false;
+
+// Time of reference for the conversion of the ticks: the program start
+static const chrono::steady_clock::time_point origin_time = chrono::steady_clock::now();
+static const uint64_t origin_ticks = trace_ticks();
+
+double trace_ns_per_tick()
+{
+    uint64_t elapsed_ticks = trace_ticks() - origin_ticks;
+    if(elapsed_ticks == 0)
+        return 0.0;
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - origin_time).count()
+        / elapsed_ticks;
+}
+
+void enable_tracing()
+{
+    tracing_on = true;
+}
+
+static ThreadTrace* register_thread()
+{
+    size_t index = registered_threads.fetch_add(1);
+    if(index >= max_threads)
+    {
+        this_thread_untraced = true;
+        return nullptr;
+    }
+    void* memory = malloc(sizeof(ThreadTrace));
+    if(!memory)
+    {
+        this_thread_untraced = true;
+        return nullptr;
+    }
+    ThreadTrace* trace = new (memory) ThreadTrace;
+    trace->count.store(0, memory_order_relaxed);
+    trace->dropped.store(0, memory_order_relaxed);
+    thread_traces[index].store(trace, memory_order_release);
+    this_thread_trace = trace;
+    return trace;
+}
+
+void trace_record(const char* name, uint64_t start_ticks, uint64_t end_ticks)
+{
+    ThreadTrace* trace = this_thread_trace;
+    if(!trace)
+    {
+        if(this_thread_untraced || !(trace = register_thread()))
+        {
+            untraced_spans.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+    }
+    size_t n = trace->count.load(memory_order_relaxed);
+    if(n == events_per_thread)
+    {
+        trace->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    trace->events[n] = {name, start_ticks, end_ticks};
+    trace->count.store(n + 1, memory_order_release);
+}
+
+uint64_t write_trace(ostream& out)
+{
+    double us_per_tick = trace_ns_per_tick() / 1000;
+    auto to_us = [us_per_tick](uint64_t ticks) {
+        return ticks > origin_ticks ? (ticks - origin_ticks) * us_per_tick : 0.0;
+    };
+
+    uint64_t dropped = untraced_spans.load(memory_order_relaxed);
+    ios format(nullptr);
+    format.copyfmt(out);
+    out << fixed << setprecision(3) << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    size_t threads = min(registered_threads.load(), max_threads);
+    for(size_t t = 0; t < threads; ++t)
+    {
+        const ThreadTrace* trace = thread_traces[t].load(memory_order_acquire);
+        if(!trace)
+            continue;
+        out << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+            << t + 1 << ", \"args\": {\"name\": \"thread " << t + 1 << "\"}}";
+        first = false;
+        size_t count = trace->count.load(memory_order_acquire);
+        for(size_t i = 0; i < count; ++i)
+        {
+            const TraceEvent& e = trace->events[i];
+            out << ",\n{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t + 1
+                << ", \"ts\": " << to_us(e.start) << ", \"dur\": " << to_us(e.end) - to_us(e.start) << "}";
+        }
+        dropped += trace->dropped.load(memory_order_relaxed);
+    }
+    out << "\n]}\n";
+    out.copyfmt(format);
+    return dropped;
+}
@@ -0,0 +1,74 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint> // for uint64_t
+#include <ostream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // for __rdtsc
+#endif
+
+// Timeline of the spans executed by all the threads, exported in the
+// Chrome trace format (chrome://tracing, https://ui.perfetto.dev).
+// Each thread appends to its own fixed-size buffer, without locking;
+// the spans of a full buffer are dropped and counted.
+
+/// Set by enable_tracing; read by every span
+extern std::atomic<bool> tracing_on;
+
+/// Switches tracing on for the whole program. Off by default, in which
+/// case a TRACE_SPAN costs a predictable branch on entry and on exit.
+void enable_tracing();
+inline bool tracing_enabled() { return tracing_on.load(std::memory_order_relaxed); }
+
+/// Clock of the spans: the time stamp counter where there is one,
+/// converted to time when the trace is written
+inline uint64_t trace_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// Duration of a tick of trace_ticks, calibrated against std::chrono::steady_clock
+/// since the program started (the time stamp counter is assumed invariant)
+double trace_ns_per_tick();
+
+/// Adds a complete span to the buffer of the calling thread
+void trace_record(const char* name, uint64_t start_ticks, uint64_t end_ticks);
+
+/// Spans from construction to destruction of the object.
+/// The name must outlive the program, e.g. a literal.
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name)
+    :_name(name), _start(tracing_enabled() ? trace_ticks() : 0)
+    {}
+    ~TraceSpan()
+    {
+        if(_start)
+            trace_record(_name, _start, trace_ticks());
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+private:
+    const char* _name;
+    uint64_t _start;
+};
+
+/// Writes the spans recorded so far as Chrome trace JSON, one event per
+/// line. Call it once the traced threads are done. Returns the number
+/// of spans dropped because a thread buffer was full.
+uint64_t write_trace(std::ostream& out);
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+/// Marks the rest of the enclosing scope as a span of the trace
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+
+#endif /* _TRACE_H_ */